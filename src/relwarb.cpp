@@ -1,6 +1,8 @@
 #include "relwarb.h"
 
 #include <ctime>
+#include <new>
+#include <type_traits>
 
 #include "relwarb_math.h"
 #include "relwarb_renderer.h"
@@ -8,16 +10,48 @@
 #include "relwarb_debug.h"
 #include "relwarb_parser.h"
 #include "relwarb_editor.h"
+#include "relwarb_snapshot.h"
+#include "relwarb_profiler.h"
+#include "relwarb_trace.h"
 
 // TODO(Charly): This should go somewhere else.
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// NOTE(Charly): When the machine can not keep up, drop time instead of spiraling
+#define MAX_TICKS_PER_FRAME 8
+
 internal void ConfigureControllers(GameState* state);
 
+// NOTE(Charly): The world is saved / restored with plain memcpys, keep it that way
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be memcpy-able");
+
+GameState* InitGameMemory(GameMemory* memory)
+{
+	size_t gameStateSize = (sizeof(GameState) + 63) & ~(size_t)63;
+	Assert(gameStateSize <= memory->permanentStorageSize);
+
+	// NOTE(Charly): Platform memory comes zeroed, default initialization only touches the members
+	//               that have an initializer, and leaves the pages of the big arrays uncommitted.
+	GameState* result = new (memory->permanentStorage) GameState;
+	InitializeArena(&result->worldArena,
+	                (uint8*)memory->permanentStorage + gameStateSize,
+	                memory->permanentStorageSize - gameStateSize);
+
+	InitializeFrameMemory(memory->transientStorage, memory->transientStorageSize);
+
+	return result;
+}
+
 void InitGame(GameState* gameState)
 {
-	z::SeedRNG((unsigned)time(nullptr));
+	TIMED_FUNCTION();
+
+	if (!gameState->deterministic && !gameState->seeded)
+	{
+		gameState->seed = (uint32)time(nullptr);
+	}
+	gameState->rng = z::SeedRandomSeries(gameState->seed);
 	LoadBitmapData("assets/sprites/health_full.png", &gameState->hudHealth[0]);
 	LoadBitmapData("assets/sprites/health_mid.png", &gameState->hudHealth[1]);
 	LoadBitmapData("assets/sprites/health_none.png", &gameState->hudHealth[2]);
@@ -26,7 +60,9 @@ void InitGame(GameState* gameState)
 	// LoadBitmapData("assets/sprites/smiley.png", &gameState->particleBitmap);
 	LoadBitmapData("assets/sprites/particle.png", &gameState->particleBitmap);
 
+#if !defined(RELWARB_HEADLESS)
 	InitializeRenderer(gameState);
+#endif
 	gameState->projMatrix = z::Ortho(-gameState->viewportSize.x / 2,
 	                                 gameState->viewportSize.x / 2,
 	                                 -gameState->viewportSize.y / 2,
@@ -88,19 +124,42 @@ void InitGame(GameState* gameState)
 
 void UpdateGame(GameState* gameState, real32 dt)
 {
+	TIMED_FUNCTION();
+
 	// NOTE(Charly): Toggle game mode on presses
 	if (IsKeyRisingEdge(gameState, Key_F1))
 	{
 		gameState->mode = gameState->mode == GameMode_Game ? GameMode_Editor : GameMode_Game;
 	}
 
-	local_persist bool32 slowDownTime = false;
 	if (IsKeyRisingEdge(gameState, Key_T))
 	{
-		slowDownTime ^= true;
+		gameState->slowDownTime ^= true;
+	}
+
+	if (IsKeyRisingEdge(gameState, Key_P))
+	{
+		gameState->showProfiler ^= true;
+	}
+
+	if (IsKeyRisingEdge(gameState, Key_F2))
+	{
+		ToggleTraceCapture();
+	}
+
+	if (IsKeyRisingEdge(gameState, Key_F3))
+	{
+		gameState->showRenderStats ^= true;
 	}
 
-	if (slowDownTime)
+	if (IsKeyRisingEdge(gameState, Key_F4))
+	{
+		gameState->showLatency ^= true;
+	}
+
+	PROFILE_COUNTER("Entities", gameState->nbEntities);
+
+	if (gameState->slowDownTime)
 		dt *= 0.1f;
 
 	switch (gameState->mode)
@@ -112,6 +171,7 @@ void UpdateGame(GameState* gameState, real32 dt)
 				SpawnParticleSystem(gameState, GetCursorWorldPosition(gameState));
 			}
 
+			UpdateControllers(gameState);
 			UpdateGameLogic(gameState, dt);
 			UpdateWorld(gameState, dt);
 
@@ -125,8 +185,8 @@ void UpdateGame(GameState* gameState, real32 dt)
                     gameState->nextParticle = 0;
                 }
 
-                particle->p = z::vec2(z::GenerateRandBetween(-0.5, 0.5), 3);
-                particle->dp = z::vec2(z::GenerateRandBetween(-2.5, 2.5), z::GenerateRandBetween(9, 11));
+                particle->p = z::vec2(z::GenerateRandBetween(&gameState->rng, -0.5, 0.5), 3);
+                particle->dp = z::vec2(z::GenerateRandBetween(&gameState->rng, -2.5, 2.5), z::GenerateRandBetween(&gameState->rng, 9, 11));
                 particle->color = z::vec4(1, 1, 1, 1);
                 particle->dcolor = z::vec4(0, 0, 0, -0.5);
             }
@@ -156,141 +216,68 @@ void UpdateGame(GameState* gameState, real32 dt)
 	}
 }
 
-// TODO(Charly): Move this in renderer ?
-void RenderGame(GameState* gameState, real32 dt)
+void StepGame(GameState* gameState, const InputState* input, real32 dt)
 {
-	switch (gameState->mode)
+	if (!gameState->deterministic)
 	{
-		case GameMode_Game:
-		{
-			for (uint32 elementIdx = 0; elementIdx < gameState->nbEntities; ++elementIdx)
-			{
-				Entity* entity = &gameState->entities[elementIdx];
-				if (EntityHasComponent(entity, ComponentFlag_Renderable))
-				{
-					RenderingPattern* pattern = entity->pattern;
-					z::vec2           pos(entity->p);
-
-					Transform transform = GetWorldTransform(entity->p);
-
-					// TODO(Thomas): Handle drawing size with a drawing size
-					if (EntityHasComponent(entity, ComponentFlag_Collidable))
-					{
-						transform.size = entity->shape->size;
-						transform.origin += entity->shape->offset;
-					}
-
-					if (entity->entityType == EntityType_Player)
-					{
-						transform.orientation = entity->orientation < 0.f ? -1 : 1;
-					}
-
-					RenderPattern(pattern, &transform, entity->shape->size);
-				}
-			}
+		gameState->lastInputState = gameState->inputState;
+		gameState->inputState     = *input;
 
-			RenderHUD(gameState);
-			RenderText("Hello, World",
-			           z::Vec2(0.0, 0.0),
-			           z::Vec4(1, 0, 0, 1),
-			           gameState,
-			           ObjectType_Debug);
-			RenderText("I am another test text !",
-			           z::Vec2(0.0, 0.1),
-			           z::Vec4(0, 1, 0, 1),
-			           gameState,
-			           ObjectType_Debug);
-			RenderText("abcdefghijklmnopqrstuvwxyz 0123456789",
-			           z::Vec2(0.0, 0.2),
-			           z::Vec4(0, 0, 1, 1),
-			           gameState,
-			           ObjectType_Debug);
-
-			char fps[128];
-			snprintf(fps, 128, "dt: %.3f, fps: %.3f", dt, 1 / dt);
-			RenderText(fps, z::Vec2(0.8, 0), z::Vec4(0, 0, 0, 1), gameState, ObjectType_Debug);
-
-			FlushRenderQueue(gameState);
-		}
-		break;
-
-		case GameMode_Editor:
-		{
-			RenderEditor(gameState);
-		}
-		break;
+		UpdateGame(gameState, dt);
+		++gameState->tick;
+		gameState->inputPressTimes = {};
 
-		default:
-		{
-			Assert(!"Wrong code path");
-		}
+		return;
 	}
-}
-
-void RenderHUD(GameState* gameState)
-{
-	real32 ratio = gameState->viewportSize.x / gameState->viewportSize.y;
-
-	Transform transform;
 
-	z::vec2 onScreenPos = z::Vec2(0.04, 0.04);
-	for (uint32 i = 0; i < gameState->nbPlayers; ++i)
+	gameState->accumulatedTime += dt;
+	if (gameState->accumulatedTime > MAX_TICKS_PER_FRAME * gameState->fixedDt)
 	{
-		Entity* player = gameState->players[i];
+		gameState->accumulatedTime = MAX_TICKS_PER_FRAME * gameState->fixedDt;
+	}
 
-		transform.size = z::Vec2(0.0625, 0.0625 * ratio);
+	while (gameState->accumulatedTime >= gameState->fixedDt)
+	{
+		gameState->lastInputState = gameState->inputState;
+		gameState->inputState     = *input;
 
-		// Avatar
-		transform.position = onScreenPos;
-		RenderBitmap(player->avatar, RenderMode_ScreenRelative, &transform);
+		UpdateGame(gameState, gameState->fixedDt);
+		gameState->checksum = ComputeSimulationChecksum(gameState);
+		++gameState->tick;
 
-		// Health
-		transform.size    = z::Vec2(0.025f, 0.025f * ratio);
-		z::vec2 healthPos = onScreenPos + z::Vec2(0.075f, 0.f);
-		for (uint32 hp = 0; hp < player->max_health; hp += 2)
-		{
-			transform.position = healthPos;
-			if (hp < player->health)
-			{
-				if (hp + 1 < player->health)
-				{
-					RenderBitmap(&gameState->hudHealth[0], RenderMode_ScreenRelative, &transform);
-				}
-				else
-				{
-					RenderBitmap(&gameState->hudHealth[1], RenderMode_ScreenRelative, &transform);
-				}
-			}
-			else
-			{
-				RenderBitmap(&gameState->hudHealth[2], RenderMode_ScreenRelative, &transform);
-			}
+		// NOTE(Charly): The presses of the frame belong to its first tick only
+		gameState->inputPressTimes = {};
 
-			healthPos.x += 0.0255f;
-		}
+		gameState->accumulatedTime -= gameState->fixedDt;
+	}
+}
 
-		// Mana
-		z::vec2 manaPos = onScreenPos + z::Vec2(0.075f, 0.0375f * ratio);
-		for (uint32 mp = 0; mp < player->max_mana; ++mp)
-		{
-			transform.position = manaPos;
-			if (mp < player->mana)
-			{
-				RenderBitmap(&gameState->hudMana[0], RenderMode_ScreenRelative, &transform);
-			}
-			else
-			{
-				RenderBitmap(&gameState->hudMana[1], RenderMode_ScreenRelative, &transform);
-			}
-			manaPos.x += 0.0255f;
-		}
+bool32 WillStepGame(const GameState* gameState, real32 dt)
+{
+	if (!gameState->deterministic)
+	{
+		return true;
+	}
 
-		onScreenPos.x += 0.24;
+	// NOTE(Charly): Same operations as StepGame, same result
+	real32 accumulatedTime = gameState->accumulatedTime + dt;
+	if (accumulatedTime > MAX_TICKS_PER_FRAME * gameState->fixedDt)
+	{
+		accumulatedTime = MAX_TICKS_PER_FRAME * gameState->fixedDt;
 	}
+
+	bool32 result = accumulatedTime >= gameState->fixedDt;
+	return result;
 }
 
 void LoadBitmapData(const char* filename, Bitmap* bitmap)
 {
+	TIMED_FUNCTION();
+
+#if defined(RELWARB_HEADLESS)
+	// NOTE(Charly): Nothing is ever drawn, do not even decode the image
+	bitmap->data = nullptr;
+#else
 	// NOTE(Charly): Get images bottom-up
 	stbi_set_flip_vertically_on_load(true);
 	int n;
@@ -298,11 +285,14 @@ void LoadBitmapData(const char* filename, Bitmap* bitmap)
 	Assert(bitmap->data);
 
 	LoadTexture(bitmap);
+#endif
 }
 
 void ReleaseBitmapData(Bitmap* bitmap)
 {
+#if !defined(RELWARB_HEADLESS)
 	ReleaseTexture(bitmap);
+#endif
 	stbi_image_free(bitmap->data);
 }
 
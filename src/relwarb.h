@@ -2,18 +2,23 @@
 #define RELWARB_H
 
 #include "relwarb_defines.h"
+#include "relwarb_memory.h"
 #include "relwarb_world_sim.h"
 #include "relwarb_renderer.h"
 #include "relwarb_input.h"
 #include "relwarb_controller.h"
+#include "relwarb_editor.h"
+#include "relwarb_latency.h"
 
-#define WORLD_SIZE 1024
+#define WORLD_SIZE 16384
 
 // NOTE(Charly): This is garbage code
 //               controller0 -> keyboard
 //               controller{1 - 4} -> xbox controllers
-#define MAX_CONTROLLERS 4
-#define MAX_PLAYERS 4
+//               the others -> bots of the stress scenes (see relwarb_stress_scene.h)
+#define MAX_CONTROLLERS 64
+#define MAX_PLAYERS 64
+#define MAX_HUD_PLAYERS 4 // NOTE(Charly): Only the first players show in the HUD
 
 #define MAX_PARTICLE_SYSTEMS 1024
 
@@ -27,6 +32,20 @@ struct Bitmap
 	int height;
 };
 
+// NOTE(Charly): Memory given to the game by the platform layer, once, at startup.
+//               - The permanent storage holds the GameState itself, followed by the world arena
+//               (everything the GameState points to), so that the whole world is one
+//               contiguous, self contained block.
+//               - The transient storage holds the frame memory.
+struct GameMemory
+{
+	size_t permanentStorageSize;
+	void*  permanentStorage;
+
+	size_t transientStorageSize;
+	void*  transientStorage;
+};
+
 enum GameMode
 {
 	GameMode_Game = 0,
@@ -81,13 +100,44 @@ struct GameState
 
 	z::vec2 gravity;
 
-	GameMode mode = GameMode_Game;
+	GameMode    mode            = GameMode_Game;
+	bool32      slowDownTime    = false;
+	bool32      showProfiler    = false;
+	bool32      showRenderStats = false;
+	bool32      showLatency     = false;
+	EditorState editor;
+
+	// NOTE(Charly): Sprite steps, fill patterns, particles... Never freed.
+	MemoryArena worldArena;
 
 	// NOTE(Charly): Windows coordinates
 	InputState inputState;
 	InputState lastInputState;
+
+	// NOTE(Charly): Not part of the simulation, see relwarb_latency.h. The platform layer sets
+	//               the press times of the frame before stepping (only when it ticks, see
+	//               WillStepGame), StepGame clears them once the first tick has seen them.
+	InputPressTimes inputPressTimes;
+	LatencyEvent    jumpLatency;
+
+	// NOTE(Charly): Simulation clock and randomness. In deterministic mode, the simulation is
+	//               stepped with fixedDt, the generator is seeded with seed, and a checksum of
+	//               the simulation state is computed after every tick. Outside deterministic
+	//               mode, InitGame seeds from the time unless a seed was given (seeded).
+	z::RandomSeries rng;
+	bool32          deterministic = false;
+	bool32          seeded        = false;
+	uint32          seed          = 0;
+	real32          fixedDt       = 1.f / 60.f;
+	real32          accumulatedTime;
+	uint32          tick;
+	uint64          checksum;
 };
 
+// NOTE(Charly): Place a fresh GameState at the start of the permanent storage and set up
+//               the world arena and the frame memory.
+GameState* InitGameMemory(GameMemory* memory);
+
 // NOTE(Charly): Initialize all the game logic related stuff here
 // TODO(Charly): This should probably be exposed to the scripting
 void InitGame(GameState* gameState);
@@ -96,13 +146,23 @@ void InitGame(GameState* gameState);
 // TODO(Charly): This should probably be exposed to the scripting
 void UpdateGame(GameState* gameState, real32 dt);
 
-// NOTE(Charly): Render the current state of the game
+// NOTE(Charly): Feed the frame's input and advance the game by dt. In deterministic mode, this
+//               runs as many fixed ticks as fit in the accumulated time (possibly none).
+void StepGame(GameState* gameState, const InputState* input, real32 dt);
+
+// NOTE(Charly): Whether StepGame with that dt runs at least one tick. Input events must only be
+//               applied to frames that do, a press applied to a frame without tick is never seen.
+bool32 WillStepGame(const GameState* gameState, real32 dt);
+
+// NOTE(Charly): Render a snapshot of the game (see relwarb_render_snapshot.h). The game state is
+//               only used for what does not change after loading (bitmaps, viewport...), the
+//               simulation may be running on another thread.
 // TODO(Charly): Maybe we need to pass the delta time for some
 //               time dependent effects ?
-void RenderGame(GameState* gameState, real32 dt);
+void RenderGame(GameState* gameState, const RenderSnapshot* snapshot, real32 dt);
 
 // NOTE(Thomas): Render HUD (atm only in GameMode_Game)
-void RenderHUD(GameState* gameState);
+void RenderHUD(GameState* gameState, const RenderSnapshot* snapshot);
 
 // TODO(Charly): This should go somewhere else
 // NOTE(Charly): bitmap must not be null, otherwise UB
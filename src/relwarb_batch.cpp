@@ -0,0 +1,326 @@
+#include "relwarb_batch.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "relwarb_debug.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+
+// NOTE(Charly): Sprites, patterns, particle pools... 16MB is plenty for the base map
+#define BATCH_WORLD_ARENA_SIZE Megabytes(16)
+#define BATCH_THREAD_MEMORY_SIZE Megabytes(16)
+
+// NOTE(Charly): Each worker owns a range of worlds [begin, end). The owner pops from the front,
+//               thieves take the back half. The range is packed with a modification tag in a
+//               single word so that both sides only ever CAS it:
+//               begin (24 bits) | end (24 bits) | tag (16 bits)
+#define RANGE_BITS 24
+#define RANGE_MASK ((1u << RANGE_BITS) - 1)
+#define MAX_BATCH_WORLDS RANGE_MASK
+
+struct WorkQueue
+{
+	std::atomic<uint64> range;
+
+	// NOTE(Charly): One queue per cache line, workers hammer their own
+	uint8 padding[64 - sizeof(std::atomic<uint64>)];
+};
+
+struct WorkerStats
+{
+	uint64 nbWorldTicks;
+	uint32 nbSteals;
+};
+
+inline uint64 PackRange(uint32 begin, uint32 end, uint32 tag)
+{
+	uint64 result = (uint64)begin | ((uint64)end << RANGE_BITS) | ((uint64)(tag & 0xFFFF) << 48);
+	return result;
+}
+
+inline uint32 GetRangeBegin(uint64 range)
+{
+	uint32 result = (uint32)(range & RANGE_MASK);
+	return result;
+}
+
+inline uint32 GetRangeEnd(uint64 range)
+{
+	uint32 result = (uint32)((range >> RANGE_BITS) & RANGE_MASK);
+	return result;
+}
+
+inline uint32 GetRangeTag(uint64 range)
+{
+	uint32 result = (uint32)(range >> 48);
+	return result;
+}
+
+internal bool32 PopWork(WorkQueue* queue, uint32* worldIdx)
+{
+	uint64 range = queue->range.load(std::memory_order_acquire);
+	while (true)
+	{
+		uint32 begin = GetRangeBegin(range);
+		uint32 end   = GetRangeEnd(range);
+		if (begin >= end)
+		{
+			return false;
+		}
+
+		uint64 popped = PackRange(begin + 1, end, GetRangeTag(range) + 1);
+		if (queue->range.compare_exchange_weak(range, popped, std::memory_order_acq_rel))
+		{
+			*worldIdx = begin;
+			return true;
+		}
+	}
+}
+
+// NOTE(Charly): Takes the back half of a victim's range, keeps the first world for itself and
+//               queues the rest in its own (empty) queue.
+internal bool32 StealWork(WorkQueue*       queues,
+                          uint32           nbQueues,
+                          uint32           thiefIdx,
+                          z::RandomSeries* series,
+                          uint32*          worldIdx)
+{
+	uint32 firstVictim = z::NextRandom(series) % nbQueues;
+	for (uint32 victimOffset = 0; victimOffset < nbQueues; ++victimOffset)
+	{
+		uint32 victimIdx = (firstVictim + victimOffset) % nbQueues;
+		if (victimIdx == thiefIdx)
+		{
+			continue;
+		}
+
+		WorkQueue* victim = queues + victimIdx;
+		uint64     range  = victim->range.load(std::memory_order_acquire);
+		while (true)
+		{
+			uint32 begin = GetRangeBegin(range);
+			uint32 end   = GetRangeEnd(range);
+			if (begin >= end)
+			{
+				break;
+			}
+
+			uint32 middle = end - (end - begin + 1) / 2;
+			uint64 left   = PackRange(begin, middle, GetRangeTag(range) + 1);
+			if (victim->range.compare_exchange_weak(range, left, std::memory_order_acq_rel))
+			{
+				WorkQueue* thief     = queues + thiefIdx;
+				uint64     thiefRange = thief->range.load(std::memory_order_relaxed);
+				thief->range.store(PackRange(middle + 1, end, GetRangeTag(thiefRange) + 1),
+				                   std::memory_order_release);
+
+				*worldIdx = middle;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+internal void StepWorld(WorldBatch* batch, uint32 worldIdx, uint32 nbTicks, uint8* frameMemory)
+{
+	BatchWorld* world = batch->worlds + worldIdx;
+	if (!world->gameState)
+	{
+		// NOTE(Charly): Frame memory is per thread, the world borrows the one of the worker
+		//               that initializes it, and does not keep it.
+		world->memory.transientStorage     = frameMemory;
+		world->memory.transientStorageSize = batch->threadMemorySize;
+
+		GameState* gameState     = InitGameMemory(&world->memory);
+		gameState->viewportSize  = z::Vec2(1440, 720);
+		gameState->deterministic = true;
+		gameState->seed          = batch->baseSeed + worldIdx;
+
+		InitGame(gameState);
+		EndFrameMemory();
+
+		world->memory.transientStorage     = nullptr;
+		world->memory.transientStorageSize = 0;
+
+		world->gameState = gameState;
+		world->script    = z::SeedRandomSeries(gameState->seed ^ 0x5c71b07u);
+	}
+
+	GameState* gameState = world->gameState;
+	for (uint32 tickIdx = 0; tickIdx < nbTicks; ++tickIdx)
+	{
+		InputState input = gameState->inputState;
+		ScriptInput(&world->script, gameState->tick, gameState->viewportSize, &input);
+
+		StepGame(gameState, &input, gameState->fixedDt);
+
+		EndFrameMemory();
+	}
+}
+
+internal void RunWorker(WorldBatch*  batch,
+                        WorkQueue*   queues,
+                        uint32       workerIdx,
+                        uint32       nbTicks,
+                        WorkerStats* stats)
+{
+	uint8* frameMemory = batch->threadMemory + workerIdx * batch->threadMemorySize;
+	InitializeFrameMemory(frameMemory, batch->threadMemorySize);
+
+	z::RandomSeries victims = z::SeedRandomSeries(workerIdx);
+
+	*stats = {};
+	while (true)
+	{
+		uint32 worldIdx;
+		if (!PopWork(queues + workerIdx, &worldIdx))
+		{
+			if (!StealWork(queues, batch->nbThreads, workerIdx, &victims, &worldIdx))
+			{
+				// NOTE(Charly): Nothing is ever queued again, empty queues mean we are done
+				break;
+			}
+
+			++stats->nbSteals;
+		}
+
+		StepWorld(batch, worldIdx, nbTicks, frameMemory);
+		stats->nbWorldTicks += nbTicks;
+	}
+}
+
+bool32 InitWorldBatch(WorldBatch* batch, uint32 nbWorlds, uint32 baseSeed, uint32 nbThreads)
+{
+	Assert(nbWorlds > 0 && nbWorlds <= MAX_BATCH_WORLDS);
+
+	if (nbThreads == 0)
+	{
+		nbThreads = std::thread::hardware_concurrency();
+		nbThreads = nbThreads ? nbThreads : 1;
+	}
+
+	*batch                  = {};
+	batch->nbWorlds         = nbWorlds;
+	batch->baseSeed         = baseSeed;
+	batch->nbThreads        = nbThreads;
+	batch->threadMemorySize = BATCH_THREAD_MEMORY_SIZE;
+
+	batch->threadMemory = (uint8*)PlatformAllocateMemory(nbThreads * batch->threadMemorySize);
+	batch->worlds = (BatchWorld*)PlatformAllocateMemory(nbWorlds * sizeof(BatchWorld));
+	if (!batch->threadMemory || !batch->worlds)
+	{
+		FreeWorldBatch(batch);
+		return false;
+	}
+
+	// NOTE(Charly): Pages are only committed when touched, untouched entity slots cost nothing
+	size_t permanentStorageSize = ((sizeof(GameState) + 63) & ~(size_t)63) + BATCH_WORLD_ARENA_SIZE;
+	for (uint32 worldIdx = 0; worldIdx < nbWorlds; ++worldIdx)
+	{
+		BatchWorld* world                  = batch->worlds + worldIdx;
+		world->memory.permanentStorageSize = permanentStorageSize;
+		world->memory.permanentStorage     = PlatformAllocateMemory(permanentStorageSize);
+		if (!world->memory.permanentStorage)
+		{
+			Log(Log_Error, "Could not allocate world %u / %u", worldIdx, nbWorlds);
+			FreeWorldBatch(batch);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void StepWorldBatch(WorldBatch* batch, uint32 nbTicks)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<WorkQueue>   queues(batch->nbThreads);
+	std::vector<WorkerStats> stats(batch->nbThreads);
+	for (uint32 workerIdx = 0; workerIdx < batch->nbThreads; ++workerIdx)
+	{
+		uint32 begin = (uint32)((uint64)batch->nbWorlds * workerIdx / batch->nbThreads);
+		uint32 end   = (uint32)((uint64)batch->nbWorlds * (workerIdx + 1) / batch->nbThreads);
+		queues[workerIdx].range.store(PackRange(begin, end, 0), std::memory_order_relaxed);
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(batch->nbThreads);
+	for (uint32 workerIdx = 0; workerIdx < batch->nbThreads; ++workerIdx)
+	{
+		workers.emplace_back(RunWorker, batch, queues.data(), workerIdx, nbTicks, &stats[workerIdx]);
+	}
+
+	batch->nbWorldTicks = 0;
+	batch->nbSteals     = 0;
+	for (uint32 workerIdx = 0; workerIdx < batch->nbThreads; ++workerIdx)
+	{
+		workers[workerIdx].join();
+
+		batch->nbWorldTicks += stats[workerIdx].nbWorldTicks;
+		batch->nbSteals += stats[workerIdx].nbSteals;
+	}
+
+	std::chrono::duration<real64> elapsed = std::chrono::steady_clock::now() - start;
+	batch->elapsed                        = elapsed.count();
+}
+
+void FreeWorldBatch(WorldBatch* batch)
+{
+	if (batch->worlds)
+	{
+		for (uint32 worldIdx = 0; worldIdx < batch->nbWorlds; ++worldIdx)
+		{
+			BatchWorld* world = batch->worlds + worldIdx;
+			if (world->memory.permanentStorage)
+			{
+				PlatformFreeMemory(world->memory.permanentStorage,
+				                   world->memory.permanentStorageSize);
+			}
+		}
+
+		PlatformFreeMemory(batch->worlds, batch->nbWorlds * sizeof(BatchWorld));
+	}
+
+	if (batch->threadMemory)
+	{
+		PlatformFreeMemory(batch->threadMemory, batch->nbThreads * batch->threadMemorySize);
+	}
+
+	*batch = {};
+}
+
+void ScriptInput(z::RandomSeries* series, uint32 tick, z::vec2 viewportSize, InputState* input)
+{
+	// NOTE(Charly): Each player picks a new set of actions every 30 ticks
+	if (tick % 30 != 0)
+	{
+		return;
+	}
+
+	uint32 actions = z::NextRandom(series);
+
+	KeyboardState* keyboard    = &input->keyboard;
+	keyboard->keys[Key_Left]   = (actions & 1) != 0;
+	keyboard->keys[Key_Right]  = (actions & 2) != 0 && !keyboard->keys[Key_Left];
+	keyboard->keys[Key_Up]     = (actions & 4) != 0;
+	keyboard->keys[Key_Space]  = (actions & 8) != 0;
+	keyboard->keys[Key_LShift] = (actions & 16) != 0;
+
+	GamepadState* gamepad                    = &input->gamepads[0];
+	gamepad->buttons[GamepadButton_PadLeft]  = (actions & (1 << 8)) != 0;
+	gamepad->buttons[GamepadButton_PadRight] = (actions & (2 << 8)) != 0;
+	gamepad->buttons[GamepadButton_A]        = (actions & (4 << 8)) != 0;
+	gamepad->buttons[GamepadButton_X]        = (actions & (8 << 8)) != 0;
+	gamepad->buttons[GamepadButton_Y]        = (actions & (16 << 8)) != 0;
+
+	MouseState* mouse                = &input->mouse;
+	mouse->buttons[MouseButton_Left] = (actions & 0xF0000) == 0;
+	mouse->cursor.x                  = z::GenerateRandBetween(series, 0, viewportSize.x);
+	mouse->cursor.y                  = z::GenerateRandBetween(series, 0, viewportSize.y);
+}
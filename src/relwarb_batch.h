@@ -0,0 +1,48 @@
+#ifndef RELWARB_BATCH_H
+#define RELWARB_BATCH_H
+
+#include "relwarb_defines.h"
+#include "relwarb_math.h"
+#include "relwarb.h"
+
+// NOTE(Charly): One independent match: its own memory, seed and scripted controllers
+struct BatchWorld
+{
+	GameMemory      memory;
+	GameState*      gameState;
+	z::RandomSeries script;
+};
+
+// NOTE(Charly): Many worlds stepped concurrently, for bots and balancing. Worlds share nothing
+//               but the read-only config on disk, so the only synchronization is the work
+//               stealing between the worker threads.
+struct WorldBatch
+{
+	uint32      nbWorlds;
+	BatchWorld* worlds;
+	uint32      baseSeed;
+
+	uint32 nbThreads;
+	size_t threadMemorySize;
+	uint8* threadMemory; // NOTE(Charly): Frame memory of each worker
+
+	// NOTE(Charly): Stats of the last StepWorldBatch
+	uint64 nbWorldTicks;
+	uint32 nbSteals;
+	real64 elapsed; // Seconds
+};
+
+// NOTE(Charly): World i is seeded with baseSeed + i. nbThreads = 0 uses all the cores.
+//               Worlds are initialized lazily, by the first StepWorldBatch.
+bool32 InitWorldBatch(WorldBatch* batch, uint32 nbWorlds, uint32 baseSeed, uint32 nbThreads = 0);
+
+// NOTE(Charly): Advance every world by nbTicks fixed ticks. Returns once they are all done.
+void StepWorldBatch(WorldBatch* batch, uint32 nbTicks);
+
+void FreeWorldBatch(WorldBatch* batch);
+
+// NOTE(Charly): Bots mashing the controls of both players (see ConfigureControllers), and once in
+//               a while spawning a particle system somewhere in the viewport.
+void ScriptInput(z::RandomSeries* series, uint32 tick, z::vec2 viewportSize, InputState* input);
+
+#endif // RELWARB_BATCH_H
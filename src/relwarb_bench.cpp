@@ -0,0 +1,1024 @@
+#include "relwarb_defines.h"
+#include "relwarb_debug.h"
+#include "relwarb_entity.h"
+#include "relwarb_jobs.h"
+#include "relwarb_math.h"
+#include "relwarb_memory.h"
+#include "relwarb_parser.h"
+#include "relwarb_platform.h"
+#include "relwarb_render_queue.h"
+#include "relwarb_renderer.h"
+#include "relwarb_snapshot.h"
+#include "relwarb_stress_scene.h"
+#include "relwarb_utils.h"
+#include "relwarb_world_sim.h"
+#include "relwarb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE(Charly): Micro-benchmarks of the hot paths of the simulation and of the CPU side of the
+//               renderer. Every benchmark is warmed up, then timed over a number of repetitions,
+//               and reported as nanoseconds per operation (median and percentiles over the
+//               repetitions). Benchmarks that scale with the world run once per --sizes entry.
+//
+//               --json writes the results, --compare diffs two of those files and fails when a
+//               median got slower than the threshold.
+
+#define MAX_BENCH_RESULTS 256
+#define MAX_BENCH_REPETITIONS 1024
+#define MAX_BENCH_SIZES 16
+#define MAX_BENCH_NAME 64
+
+// NOTE(Charly): Repetitions of benchmarks without setup are grown to last at least that long,
+//               the clock and the call overhead then do not show in the results
+#define MIN_REPETITION_NS 500000.0
+
+// NOTE(Charly): Sizes are entities, particles, meshes or matrices depending on the benchmark
+global_variable const uint32 defaultBenchSizes[] = {100, 1000, 10000};
+
+typedef void BenchFunction(void* data);
+
+struct BenchConfig
+{
+	const char* filter;
+	uint32      nbWarmups;
+	uint32      nbRepetitions;
+
+	uint32 sizes[MAX_BENCH_SIZES];
+	uint32 nbSizes;
+};
+
+struct BenchResult
+{
+	char   name[MAX_BENCH_NAME];
+	uint32 size;
+	uint64 nbOps; // NOTE(Charly): Per repetition
+	uint32 nbRepetitions;
+
+	// NOTE(Charly): Nanoseconds per operation
+	real64 min;
+	real64 p10;
+	real64 median;
+	real64 p90;
+	real64 max;
+};
+
+struct BenchSuite
+{
+	BenchConfig config;
+
+	BenchResult results[MAX_BENCH_RESULTS];
+	uint32      nbResults;
+};
+
+// NOTE(Charly): Benchmarks write their results here so that the compiler keeps the work
+global_variable volatile real32 benchSink;
+
+using BenchClock = std::chrono::steady_clock;
+
+internal real64 GetElapsedNs(BenchClock::time_point start)
+{
+	real64 result = std::chrono::duration<real64, std::nano>(BenchClock::now() - start).count();
+	return result;
+}
+
+internal void EndBenchFrame()
+{
+	EndFrameMemory();
+	EndJobsFrame();
+}
+
+// NOTE(Charly): run does nbOps operations. setup runs before every repetition and is not timed,
+//               benchmarks with a setup are timed one run per repetition.
+internal void RunBenchmark(BenchSuite*    suite,
+                           const char*    name,
+                           uint32         size,
+                           uint64         nbOps,
+                           BenchFunction* run,
+                           BenchFunction* setup,
+                           void*          data)
+{
+	if (suite->nbResults >= MAX_BENCH_RESULTS)
+	{
+		return;
+	}
+
+	uint32 nbRunsPerRepetition = 1;
+	for (uint32 warmupIdx = 0; warmupIdx < suite->config.nbWarmups; ++warmupIdx)
+	{
+		if (setup)
+		{
+			setup(data);
+		}
+
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32 runIdx = 0; runIdx < nbRunsPerRepetition; ++runIdx)
+		{
+			run(data);
+		}
+		real64 elapsed = GetElapsedNs(start);
+
+		EndBenchFrame();
+
+		if (!setup && elapsed < MIN_REPETITION_NS)
+		{
+			real64 scale        = elapsed > 0.0 ? MIN_REPETITION_NS / elapsed : 1024.0;
+			nbRunsPerRepetition = (uint32)(nbRunsPerRepetition * (scale < 1024.0 ? scale : 1024.0)) + 1;
+		}
+	}
+
+	real64 samples[MAX_BENCH_REPETITIONS];
+	uint32 nbSamples = suite->config.nbRepetitions;
+	for (uint32 sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+	{
+		if (setup)
+		{
+			setup(data);
+		}
+
+		BenchClock::time_point start = BenchClock::now();
+		for (uint32 runIdx = 0; runIdx < nbRunsPerRepetition; ++runIdx)
+		{
+			run(data);
+		}
+		samples[sampleIdx] = GetElapsedNs(start) / ((real64)nbOps * nbRunsPerRepetition);
+
+		EndBenchFrame();
+	}
+	std::sort(samples, samples + nbSamples);
+
+	BenchResult* result = suite->results + suite->nbResults++;
+	snprintf(result->name, MAX_BENCH_NAME, "%s", name);
+	result->size          = size;
+	result->nbOps         = nbOps * nbRunsPerRepetition;
+	result->nbRepetitions = nbSamples;
+	result->min           = samples[0];
+	result->p10           = GetPercentile(samples, nbSamples, 0.1);
+	result->median        = GetPercentile(samples, nbSamples, 0.5);
+	result->p90           = GetPercentile(samples, nbSamples, 0.9);
+	result->max           = samples[nbSamples - 1];
+
+	printf("%-24s %8u %12.2f %12.2f %12.2f %12.2f %12.2f\n",
+	       result->name,
+	       result->size,
+	       result->min,
+	       result->p10,
+	       result->median,
+	       result->p90,
+	       result->max);
+	fflush(stdout);
+}
+
+internal bool32 IsBenchmarkEnabled(BenchSuite* suite, const char* name)
+{
+	bool32 result = !suite->config.filter || strstr(name, suite->config.filter);
+	return result;
+}
+
+//
+// NOTE(Charly): Worlds
+//
+
+struct BenchWorld
+{
+	GameMemory memory;
+	GameState* gameState;
+};
+
+// NOTE(Charly): The base map and its two players, the benchmarks add their load on top
+internal GameState* ResetBenchWorld(BenchWorld* world)
+{
+	// NOTE(Charly): InitGameMemory expects zeroed memory, particle pools in particular
+	memset(world->memory.permanentStorage, 0, sizeof(GameState));
+
+	GameState* result    = InitGameMemory(&world->memory);
+	result->viewportSize = z::Vec2(1440, 720);
+	result->deterministic = true;
+	InitGame(result);
+	EndBenchFrame();
+
+	world->gameState = result;
+	return result;
+}
+
+// NOTE(Charly): A grid of walls above the map, far enough from each other never to collide
+internal void AddBenchWalls(GameState* gameState, uint32 nbWalls)
+{
+	Shape* shape = CreateShape(gameState, z::Vec2(1.f));
+	for (uint32 wallIdx = 0; wallIdx < nbWalls && gameState->nbEntities < WORLD_SIZE; ++wallIdx)
+	{
+		z::vec2 p = z::Vec2(-48.f + 1.5f * (wallIdx % 64), 16.f + 1.5f * (wallIdx / 64));
+		CreateWallEntity(gameState, p, nullptr, shape);
+	}
+}
+
+// NOTE(Charly): Systems full of particles that never die, and that do not spawn new ones
+internal void AddBenchParticles(GameState* gameState, uint32 nbParticles, z::RandomSeries* series)
+{
+	// NOTE(Charly): Systems stay alive until they are all spawned, a dead slot would be reused
+	ParticleSystem* systems[MAX_PARTICLE_SYSTEMS];
+	uint32          nbSystems = 0;
+	for (uint32 nbSpawned = 0; nbSpawned < nbParticles && nbSystems < MAX_PARTICLE_SYSTEMS;)
+	{
+		systems[nbSystems] = SpawnParticleSystem(gameState, z::Vec2(0.f));
+		nbSpawned += systems[nbSystems++]->maxParticles;
+	}
+
+	for (uint32 systemIdx = 0; systemIdx < nbSystems; ++systemIdx)
+	{
+		ParticleSystem* system = systems[systemIdx];
+		system->alive          = false;
+
+		uint32 count = nbParticles < system->maxParticles ? nbParticles : system->maxParticles;
+		for (uint32 particleIdx = 0; particleIdx < count; ++particleIdx)
+		{
+			Particle* particle  = system->particles + particleIdx;
+			particle->p         = z::Vec2(z::GenerateRandBetween(series, -24.f, 24.f),
+                                          z::GenerateRandBetween(series, -12.f, 12.f));
+			particle->dp        = z::Vec2(z::GenerateRandBetween(series, -1.f, 1.f), 0.f);
+			particle->color     = system->startColor;
+			particle->totalLife = 1e9f;
+			particle->life      = particle->totalLife;
+		}
+		system->nbParticles = count;
+		nbParticles -= count;
+	}
+}
+
+internal void StepBenchWorld(void* data)
+{
+	BenchWorld* world = (BenchWorld*)data;
+	UpdateWorld(world->gameState, world->gameState->fixedDt);
+}
+
+// NOTE(Charly): Whole game ticks, bots and game logic included
+internal void StepBenchGame(void* data)
+{
+	BenchWorld* world = (BenchWorld*)data;
+	UpdateGame(world->gameState, world->gameState->fixedDt);
+	++world->gameState->tick;
+}
+
+//
+// NOTE(Charly): Shapes
+//
+
+struct IntersectBench
+{
+	Entity* entities;
+	uint32  nbPairs; // NOTE(Charly): Entities 2i and 2i + 1
+};
+
+internal void InitIntersectBench(IntersectBench* bench, MemoryArena* arena, uint32 nbPairs, z::RandomSeries* series)
+{
+	bench->nbPairs  = nbPairs;
+	bench->entities = PushArray(arena, 2 * nbPairs, Entity);
+
+	Shape* shapes = PushArray(arena, 2 * nbPairs, Shape);
+	for (uint32 entityIdx = 0; entityIdx < 2 * nbPairs; ++entityIdx)
+	{
+		shapes[entityIdx].size   = z::Vec2(z::GenerateRandBetween(series, 0.5f, 4.f),
+                                           z::GenerateRandBetween(series, 0.5f, 4.f));
+		shapes[entityIdx].offset = z::Vec2(0.f);
+
+		Entity* entity = bench->entities + entityIdx;
+		*entity        = {};
+		entity->p      = z::Vec2(z::GenerateRandBetween(series, -8.f, 8.f),
+                                 z::GenerateRandBetween(series, -8.f, 8.f));
+		entity->shape  = shapes + entityIdx;
+	}
+}
+
+internal void RunIntersectBench(void* data)
+{
+	IntersectBench* bench = (IntersectBench*)data;
+
+	uint32 nbIntersections = 0;
+	for (uint32 pairIdx = 0; pairIdx < bench->nbPairs; ++pairIdx)
+	{
+		nbIntersections += Intersect(bench->entities + 2 * pairIdx, bench->entities + 2 * pairIdx + 1);
+	}
+	benchSink = (real32)nbIntersections;
+}
+
+internal void RunOverlapBench(void* data)
+{
+	IntersectBench* bench = (IntersectBench*)data;
+
+	z::vec2 total = z::Vec2(0.f);
+	for (uint32 pairIdx = 0; pairIdx < bench->nbPairs; ++pairIdx)
+	{
+		total += Overlap(bench->entities + 2 * pairIdx, bench->entities + 2 * pairIdx + 1);
+	}
+	benchSink = total.x + total.y;
+}
+
+//
+// NOTE(Charly): Transforms
+//
+
+struct TransformBench
+{
+	Transform*  transforms;
+	z::affine2* affines;
+	z::affine2* affineResults;
+	z::mat3*    matrices;
+	z::mat3*    results;
+	uint32      count;
+
+	// NOTE(Charly): A quad per transform, the way FlushRenderQueue transforms the meshes
+	Vertex* vertices;
+};
+
+global_variable const Vertex benchQuad[4] = {
+	{{0, 0}, {0, 0}}, {{1, 0}, {1, 0}}, {{1, 1}, {1, 1}}, {{0, 1}, {0, 1}}};
+
+internal void InitTransformBench(TransformBench* bench, MemoryArena* arena, uint32 count, z::RandomSeries* series)
+{
+	bench->count         = count;
+	bench->transforms    = PushArray(arena, count, Transform);
+	bench->affines       = PushArray(arena, 2 * count, z::affine2);
+	bench->affineResults = PushArray(arena, count, z::affine2);
+	bench->matrices      = PushArray(arena, 2 * count, z::mat3);
+	bench->results       = PushArray(arena, count, z::mat3);
+	bench->vertices      = PushArray(arena, 4 * count, Vertex);
+	for (uint32 transformIdx = 0; transformIdx < count; ++transformIdx)
+	{
+		Transform* transform   = new (bench->transforms + transformIdx) Transform;
+		transform->position    = z::Vec2(z::GenerateRandBetween(series, -24.f, 24.f),
+                                         z::GenerateRandBetween(series, -12.f, 12.f));
+		transform->size        = z::Vec2(z::GenerateRandBetween(series, 0.5f, 4.f));
+		transform->origin      = z::Vec2(0.5f);
+		transform->rotation    = z::GenerateRandBetween(series, -z::Pi, z::Pi);
+		transform->orientation = transformIdx & 1 ? 1 : -1;
+	}
+	for (uint32 matrixIdx = 0; matrixIdx < 2 * count; ++matrixIdx)
+	{
+		bench->affines[matrixIdx]  = GetTransformMatrix(RenderMode_World, bench->transforms + matrixIdx / 2);
+		bench->matrices[matrixIdx] = z::Mat3(bench->affines[matrixIdx]);
+	}
+}
+
+internal void RunTransformMatrixBench(void* data)
+{
+	TransformBench* bench = (TransformBench*)data;
+	for (uint32 transformIdx = 0; transformIdx < bench->count; ++transformIdx)
+	{
+		bench->affineResults[transformIdx] = GetTransformMatrix(RenderMode_World, bench->transforms + transformIdx);
+	}
+	benchSink = bench->affineResults[bench->count - 1].tx;
+}
+
+internal void RunMat3MultiplyBench(void* data)
+{
+	TransformBench* bench = (TransformBench*)data;
+	for (uint32 matrixIdx = 0; matrixIdx < bench->count; ++matrixIdx)
+	{
+		bench->results[matrixIdx] = bench->matrices[2 * matrixIdx] * bench->matrices[2 * matrixIdx + 1];
+	}
+	benchSink = bench->results[bench->count - 1][0][2];
+}
+
+internal void RunAffine2MultiplyBench(void* data)
+{
+	TransformBench* bench = (TransformBench*)data;
+	for (uint32 matrixIdx = 0; matrixIdx < bench->count; ++matrixIdx)
+	{
+		bench->affineResults[matrixIdx] = bench->affines[2 * matrixIdx] * bench->affines[2 * matrixIdx + 1];
+	}
+	benchSink = bench->affineResults[bench->count - 1].tx;
+}
+
+// NOTE(Charly): The first matrix of every pair stands for the projection
+internal void RunTransformVerticesBench(void* data)
+{
+	TransformBench* bench    = (TransformBench*)data;
+	Vertex*         vertices = bench->vertices;
+	for (uint32 transformIdx = 0; transformIdx < bench->count; ++transformIdx)
+	{
+		z::affine2 transform = bench->affines[2 * transformIdx] * bench->affines[2 * transformIdx + 1];
+		std::copy(benchQuad, benchQuad + 4, vertices);
+		z::TransformPoints(transform, &vertices->position, &vertices->position, 4, sizeof(Vertex));
+		vertices += 4;
+	}
+	benchSink = bench->vertices[4 * bench->count - 1].position.x;
+}
+
+//
+// NOTE(Charly): Render queue
+//
+
+// NOTE(Charly): The first mesh of every eight is queued on its own, the others go in buckets,
+//               the way RenderEntities splits them
+#define BENCH_RENDER_BUCKETS 8
+
+struct RenderQueueBench
+{
+	Mesh*  meshes; // NOTE(Charly): Random state, copied in the queue before every merge
+	uint32 count;
+
+	RenderQueue queue;
+	Mesh*       merged;
+};
+
+internal void InitRenderQueueBench(RenderQueueBench* bench, MemoryArena* arena, uint32 count, z::RandomSeries* series)
+{
+	bench->count  = count;
+	bench->meshes = PushArray(arena, count, Mesh);
+	for (uint32 meshIdx = 0; meshIdx < count; ++meshIdx)
+	{
+		Mesh* mesh           = bench->meshes + meshIdx;
+		mesh->renderMode     = (RenderMode)(z::NextRandom(series) % 3);
+		mesh->program        = 1 + z::NextRandom(series) % 3;
+		mesh->texture        = 1 + z::NextRandom(series) % 16;
+		mesh->vertices       = nullptr;
+		mesh->nbVertices     = 0;
+		mesh->indices        = nullptr;
+		mesh->nbIndices      = 0;
+		mesh->worldTransform = z::Affine2(1);
+		mesh->color          = z::Vec4(1);
+		mesh->order          = meshIdx;
+	}
+}
+
+internal void SetupRenderQueueBench(void* data)
+{
+	RenderQueueBench* bench = (RenderQueueBench*)data;
+	RenderQueue*      queue = &bench->queue;
+
+	FrameVector<Mesh>().swap(queue->meshes);
+	queue->nbBuckets = 0;
+	queue->nbOrders  = 0;
+	ReserveRenderOrders(queue, bench->count);
+
+	uint32 bucketSize = (bench->count + BENCH_RENDER_BUCKETS - 1) / BENCH_RENDER_BUCKETS;
+	for (uint32 first = 0; first < bench->count; first += bucketSize)
+	{
+		uint32 last = first + bucketSize < bench->count ? first + bucketSize : bench->count;
+
+		RenderBucket bucket = {PushArray(GetFrameArena(), last - first, Mesh), 0};
+		for (uint32 meshIdx = first; meshIdx < last; ++meshIdx)
+		{
+			if (meshIdx % 8 == 0)
+			{
+				queue->meshes.push_back(bench->meshes[meshIdx]);
+			}
+			else
+			{
+				bucket.meshes[bucket.nbMeshes++] = bench->meshes[meshIdx];
+			}
+		}
+		std::sort(bucket.meshes, bucket.meshes + bucket.nbMeshes, MeshLess);
+		PushRenderBucket(queue, bucket);
+	}
+}
+
+internal void RunRenderQueueBench(void* data)
+{
+	RenderQueueBench* bench = (RenderQueueBench*)data;
+
+	uint32 nbMeshes = MergeRenderQueue(&bench->queue, &bench->merged);
+	benchSink       = (real32)bench->merged[nbMeshes - 1].order;
+}
+
+//
+// NOTE(Charly): Snapshots
+//
+
+#define BENCH_SNAPSHOTS 4
+
+struct SnapshotBench
+{
+	BenchWorld*  world;
+	SnapshotRing ring;
+	uint32       frame;
+};
+
+internal void RunSaveSnapshotBench(void* data)
+{
+	SnapshotBench* bench = (SnapshotBench*)data;
+	SaveSnapshot(&bench->ring, bench->world->gameState, bench->frame++);
+}
+
+internal void RunRestoreSnapshotBench(void* data)
+{
+	SnapshotBench* bench = (SnapshotBench*)data;
+	RestoreSnapshot(&bench->ring, bench->world->gameState, bench->frame - 1);
+}
+
+//
+// NOTE(Charly): Logging
+//
+
+// NOTE(Charly): Below the size of the log ring, a run never drops records
+#define BENCH_LOG_RECORDS 1024
+
+#if defined(OS_WINDOWS)
+#define BENCH_LOG_FILE "NUL"
+#else
+#define BENCH_LOG_FILE "/dev/null"
+#endif
+
+// NOTE(Charly): The writer thread empties the ring between runs
+internal void SetupLogRecordBench(void* data)
+{
+	FlushLog();
+}
+
+internal void RunLogRecordBench(void* data)
+{
+	for (uint32 recordIdx = 0; recordIdx < BENCH_LOG_RECORDS; ++recordIdx)
+	{
+		Log(Log_Info, "Bench record %u of %u (%f, %s)", recordIdx, BENCH_LOG_RECORDS, 0.5f, "string");
+	}
+}
+
+// NOTE(Charly): A single call site, all but the first LOG_RATE_LIMIT calls of every second are
+//               suppressed
+internal void RunLogSuppressedBench(void* data)
+{
+	for (uint32 recordIdx = 0; recordIdx < BENCH_LOG_RECORDS; ++recordIdx)
+	{
+		Log(Log_Info, "Bench suppressed record %u", recordIdx);
+	}
+}
+
+//
+// NOTE(Charly): Map loading
+//
+
+internal void SetupLoadMapBench(void* data)
+{
+	BenchWorld* world = (BenchWorld*)data;
+
+	memset(world->memory.permanentStorage, 0, sizeof(GameState));
+	world->gameState = InitGameMemory(&world->memory);
+}
+
+internal void RunLoadMapBench(void* data)
+{
+	BenchWorld* world = (BenchWorld*)data;
+	LoadMapFile(world->gameState, "config/base_map.ini");
+
+	// NOTE(Charly): The parser works on std::strings
+	AllowFrameHeapAllocations();
+}
+
+internal void RunBenchmarks(BenchSuite* suite, MemoryArena* arena, BenchWorld* world)
+{
+	printf("%-24s %8s %12s %12s %12s %12s %12s\n", "ns/op", "size", "min", "p10", "median", "p90", "max");
+
+	for (uint32 sizeIdx = 0; sizeIdx < suite->config.nbSizes; ++sizeIdx)
+	{
+		uint32          size   = suite->config.sizes[sizeIdx];
+		z::RandomSeries series = z::SeedRandomSeries(size);
+
+		// NOTE(Charly): The arena only holds the data of the current size
+		ResetArena(arena);
+
+		if (IsBenchmarkEnabled(suite, "Intersect") || IsBenchmarkEnabled(suite, "Overlap"))
+		{
+			IntersectBench bench;
+			InitIntersectBench(&bench, arena, size, &series);
+			if (IsBenchmarkEnabled(suite, "Intersect"))
+			{
+				RunBenchmark(suite, "Intersect", size, size, RunIntersectBench, nullptr, &bench);
+			}
+			if (IsBenchmarkEnabled(suite, "Overlap"))
+			{
+				RunBenchmark(suite, "Overlap", size, size, RunOverlapBench, nullptr, &bench);
+			}
+		}
+
+		if (IsBenchmarkEnabled(suite, "GetTransformMatrix") || IsBenchmarkEnabled(suite, "Mat3Multiply") ||
+		    IsBenchmarkEnabled(suite, "Affine2Multiply") || IsBenchmarkEnabled(suite, "TransformVertices"))
+		{
+			TransformBench bench;
+			InitTransformBench(&bench, arena, size, &series);
+			if (IsBenchmarkEnabled(suite, "GetTransformMatrix"))
+			{
+				RunBenchmark(suite, "GetTransformMatrix", size, size, RunTransformMatrixBench, nullptr, &bench);
+			}
+			if (IsBenchmarkEnabled(suite, "Mat3Multiply"))
+			{
+				RunBenchmark(suite, "Mat3Multiply", size, size, RunMat3MultiplyBench, nullptr, &bench);
+			}
+			if (IsBenchmarkEnabled(suite, "Affine2Multiply"))
+			{
+				RunBenchmark(suite, "Affine2Multiply", size, size, RunAffine2MultiplyBench, nullptr, &bench);
+			}
+			if (IsBenchmarkEnabled(suite, "TransformVertices"))
+			{
+				RunBenchmark(suite, "TransformVertices", size, 4 * size, RunTransformVerticesBench, nullptr, &bench);
+			}
+		}
+
+		if (IsBenchmarkEnabled(suite, "MergeRenderQueue"))
+		{
+			RenderQueueBench bench;
+			InitRenderQueueBench(&bench, arena, size, &series);
+			RunBenchmark(suite,
+			             "MergeRenderQueue",
+			             size,
+			             size,
+			             RunRenderQueueBench,
+			             SetupRenderQueueBench,
+			             &bench);
+			FrameVector<Mesh>().swap(bench.queue.meshes);
+		}
+
+		// NOTE(Charly): A tick of the whole world, timed per entity: the broadphase tests every
+		//               pair, expect it to grow linearly
+		if (IsBenchmarkEnabled(suite, "UpdateWorldCollisions"))
+		{
+			GameState* gameState = ResetBenchWorld(world);
+			AddBenchWalls(gameState, size);
+			RunBenchmark(suite,
+			             "UpdateWorldCollisions",
+			             size,
+			             gameState->nbEntities,
+			             StepBenchWorld,
+			             nullptr,
+			             world);
+		}
+
+		// NOTE(Charly): A tick of the base map, timed per particle
+		if (IsBenchmarkEnabled(suite, "UpdateWorldParticles"))
+		{
+			GameState* gameState = ResetBenchWorld(world);
+			AddBenchParticles(gameState, size, &series);
+			RunBenchmark(suite, "UpdateWorldParticles", size, size, StepBenchWorld, nullptr, world);
+		}
+
+		// NOTE(Charly): A game tick of a procedural scene of that many platforms, with a fixed
+		//               load of bots and particle systems on top, timed per tick
+		if (IsBenchmarkEnabled(suite, "UpdateStressScene"))
+		{
+			GameState*        gameState = ResetBenchWorld(world);
+			StressSceneParams params    = {size, size, 16, 8, BotBehavior_Random};
+			GenerateStressScene(gameState, &params);
+			RunBenchmark(suite, "UpdateStressScene", size, 1, StepBenchGame, nullptr, world);
+		}
+
+		if (IsBenchmarkEnabled(suite, "SaveSnapshot") || IsBenchmarkEnabled(suite, "RestoreSnapshot"))
+		{
+			GameState* gameState = ResetBenchWorld(world);
+			AddBenchWalls(gameState, size);
+			AddBenchParticles(gameState, 1000, &series);
+
+			SnapshotBench bench;
+			bench.world       = world;
+			bench.frame       = 0;
+			// NOTE(Charly): Room for the slot descriptors and the alignment of the slots
+			size_t ringSize   = BENCH_SNAPSHOTS * (GetSnapshotSize(gameState) + Kilobytes(1));
+			void*  ringMemory = PushSize(arena, ringSize);
+			InitSnapshotRing(&bench.ring, ringMemory, ringSize, BENCH_SNAPSHOTS);
+			if (!SaveSnapshot(&bench.ring, gameState, bench.frame++))
+			{
+				Log(Log_Error, "Snapshot benchmarks skipped, the world does not fit in the ring");
+			}
+			else
+			{
+				if (IsBenchmarkEnabled(suite, "SaveSnapshot"))
+				{
+					RunBenchmark(suite, "SaveSnapshot", size, 1, RunSaveSnapshotBench, nullptr, &bench);
+				}
+				if (IsBenchmarkEnabled(suite, "RestoreSnapshot"))
+				{
+					RunBenchmark(suite, "RestoreSnapshot", size, 1, RunRestoreSnapshotBench, nullptr, &bench);
+				}
+			}
+		}
+	}
+
+	// NOTE(Charly): The map format indexes objects on a byte, it does not scale, only the base
+	//               map is measured
+	if (IsBenchmarkEnabled(suite, "LoadMapFile"))
+	{
+		RunBenchmark(suite, "LoadMapFile", 0, 1, RunLoadMapBench, SetupLoadMapBench, world);
+	}
+
+	// NOTE(Charly): Cost on the logging thread, the records are formatted and written out of the
+	//               terminal's way. LogRecord goes through the ring every time.
+	if (IsBenchmarkEnabled(suite, "LogRecord") || IsBenchmarkEnabled(suite, "LogSuppressed"))
+	{
+		SetLogFile(BENCH_LOG_FILE);
+
+		if (IsBenchmarkEnabled(suite, "LogRecord"))
+		{
+			SetLogRateLimit(false);
+			RunBenchmark(suite, "LogRecord", 0, BENCH_LOG_RECORDS, RunLogRecordBench, SetupLogRecordBench, nullptr);
+			SetLogRateLimit(true);
+		}
+		if (IsBenchmarkEnabled(suite, "LogSuppressed"))
+		{
+			RunBenchmark(suite, "LogSuppressed", 0, BENCH_LOG_RECORDS, RunLogSuppressedBench, nullptr, nullptr);
+		}
+
+		SetLogFile(nullptr);
+	}
+}
+
+//
+// NOTE(Charly): Results
+//
+
+internal bool32 WriteBenchResults(BenchSuite* suite, const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (!file)
+	{
+		Log(Log_Error, "Could not open %s", filename);
+		return false;
+	}
+
+	// NOTE(Charly): One result per line, ReadBenchResults relies on it
+	fprintf(file, "{\"benchmarks\":[\n");
+	for (uint32 resultIdx = 0; resultIdx < suite->nbResults; ++resultIdx)
+	{
+		const BenchResult* result = suite->results + resultIdx;
+		fprintf(file,
+		        "{\"name\":\"%s\",\"size\":%u,\"ops\":%llu,\"repetitions\":%u,\"min_ns\":%.4f,"
+		        "\"p10_ns\":%.4f,\"median_ns\":%.4f,\"p90_ns\":%.4f,\"max_ns\":%.4f}%s\n",
+		        result->name,
+		        result->size,
+		        (unsigned long long)result->nbOps,
+		        result->nbRepetitions,
+		        result->min,
+		        result->p10,
+		        result->median,
+		        result->p90,
+		        result->max,
+		        resultIdx + 1 < suite->nbResults ? "," : "");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+
+	return true;
+}
+
+// NOTE(Charly): Only reads files written by WriteBenchResults
+internal bool32 ReadBenchResults(BenchSuite* suite, const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (!file)
+	{
+		Log(Log_Error, "Could not open %s", filename);
+		return false;
+	}
+
+	suite->nbResults = 0;
+
+	char line[1024];
+	while (fgets(line, sizeof(line), file) && suite->nbResults < MAX_BENCH_RESULTS)
+	{
+		BenchResult*       result = suite->results + suite->nbResults;
+		unsigned long long nbOps;
+		int                nbFields = sscanf(line,
+                                      "{\"name\":\"%63[^\"]\",\"size\":%u,\"ops\":%llu,\"repetitions\":%u,"
+                                      "\"min_ns\":%lf,\"p10_ns\":%lf,\"median_ns\":%lf,\"p90_ns\":%lf,"
+                                      "\"max_ns\":%lf",
+                                      result->name,
+                                      &result->size,
+                                      &nbOps,
+                                      &result->nbRepetitions,
+                                      &result->min,
+                                      &result->p10,
+                                      &result->median,
+                                      &result->p90,
+                                      &result->max);
+		if (nbFields == 9)
+		{
+			result->nbOps = nbOps;
+			++suite->nbResults;
+		}
+	}
+	fclose(file);
+
+	return true;
+}
+
+// NOTE(Charly): Medians are compared, threshold is a fraction (0.1 fails on 10% slower)
+internal int CompareBenchResults(const char* baseFilename, const char* newFilename, real64 threshold)
+{
+	BenchSuite* base    = (BenchSuite*)PlatformAllocateMemory(2 * sizeof(BenchSuite));
+	BenchSuite* current = base + 1;
+	if (!base)
+	{
+		return 1;
+	}
+	if (!ReadBenchResults(base, baseFilename) || !ReadBenchResults(current, newFilename))
+	{
+		PlatformFreeMemory(base, 2 * sizeof(BenchSuite));
+		return 1;
+	}
+
+	printf("%-24s %8s %12s %12s %8s\n", "median ns/op", "size", "base", "new", "change");
+
+	uint32 nbRegressions = 0;
+	for (uint32 resultIdx = 0; resultIdx < current->nbResults; ++resultIdx)
+	{
+		const BenchResult* result = current->results + resultIdx;
+
+		const BenchResult* baseResult = nullptr;
+		for (uint32 baseIdx = 0; baseIdx < base->nbResults && !baseResult; ++baseIdx)
+		{
+			if (strcmp(base->results[baseIdx].name, result->name) == 0 &&
+			    base->results[baseIdx].size == result->size)
+			{
+				baseResult = base->results + baseIdx;
+			}
+		}
+
+		if (!baseResult)
+		{
+			printf("%-24s %8u %12s %12.2f %8s\n", result->name, result->size, "-", result->median, "new");
+			continue;
+		}
+
+		real64      change = baseResult->median > 0.0 ? result->median / baseResult->median - 1.0 : 0.0;
+		const char* flag   = "";
+		if (change > threshold)
+		{
+			flag = "  REGRESSION";
+			++nbRegressions;
+		}
+		else if (change < -threshold)
+		{
+			flag = "  improvement";
+		}
+
+		printf("%-24s %8u %12.2f %12.2f %+7.1f%%%s\n",
+		       result->name,
+		       result->size,
+		       baseResult->median,
+		       result->median,
+		       100.0 * change,
+		       flag);
+	}
+
+	// NOTE(Charly): Benchmarks gone from the new run, they would otherwise hide a removed or renamed one
+	uint32 nbMissing = 0;
+	for (uint32 baseIdx = 0; baseIdx < base->nbResults; ++baseIdx)
+	{
+		const BenchResult* baseResult = base->results + baseIdx;
+
+		bool32 found = false;
+		for (uint32 resultIdx = 0; resultIdx < current->nbResults && !found; ++resultIdx)
+		{
+			found = strcmp(current->results[resultIdx].name, baseResult->name) == 0 &&
+			        current->results[resultIdx].size == baseResult->size;
+		}
+
+		if (!found)
+		{
+			printf("%-24s %8u %12.2f %12s %8s\n", baseResult->name, baseResult->size, baseResult->median, "-", "missing");
+			++nbMissing;
+		}
+	}
+
+	printf("%u regressions over %.0f%%, %u missing\n", nbRegressions, 100.0 * threshold, nbMissing);
+
+	PlatformFreeMemory(base, 2 * sizeof(BenchSuite));
+
+	return nbRegressions > 0 ? 1 : 0;
+}
+
+internal uint32 ParseBenchSizes(const char* list, uint32* sizes)
+{
+	uint32 result = 0;
+	for (const char* c = list; *c && result < MAX_BENCH_SIZES;)
+	{
+		char*  end  = nullptr;
+		uint32 size = (uint32)strtoul(c, &end, 10);
+		if (end == c)
+		{
+			break;
+		}
+
+		// NOTE(Charly): Worlds can not hold more
+		if (size > 0 && size <= WORLD_SIZE - 64)
+		{
+			sizes[result++] = size;
+		}
+
+		c = *end == ',' ? end + 1 : end;
+	}
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config   = {};
+	config.nbWarmups     = 3;
+	config.nbRepetitions = 15;
+	config.nbSizes       = sizeof(defaultBenchSizes) / sizeof(defaultBenchSizes[0]);
+	memcpy(config.sizes, defaultBenchSizes, sizeof(defaultBenchSizes));
+
+	const char* jsonFilename    = nullptr;
+	const char* compareBase     = nullptr;
+	const char* compareNew      = nullptr;
+	real64      threshold       = 0.1;
+	uint32      nbThreads       = 0;
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		if (strcmp(argv[argIdx], "--filter") == 0 && argIdx + 1 < argc)
+		{
+			config.filter = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--sizes") == 0 && argIdx + 1 < argc)
+		{
+			config.nbSizes = ParseBenchSizes(argv[++argIdx], config.sizes);
+		}
+		else if (strcmp(argv[argIdx], "--reps") == 0 && argIdx + 1 < argc)
+		{
+			config.nbRepetitions = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--warmup") == 0 && argIdx + 1 < argc)
+		{
+			config.nbWarmups = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--threads") == 0 && argIdx + 1 < argc)
+		{
+			nbThreads = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--json") == 0 && argIdx + 1 < argc)
+		{
+			jsonFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--compare") == 0 && argIdx + 2 < argc)
+		{
+			compareBase = argv[++argIdx];
+			compareNew  = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--threshold") == 0 && argIdx + 1 < argc)
+		{
+			threshold = strtod(argv[++argIdx], nullptr) / 100.0;
+		}
+		else
+		{
+			fprintf(stderr,
+			        "usage: %s [--filter name] [--sizes N,N,...] [--reps N] [--warmup N] [--threads N] [--json file]\n"
+			        "       %s --compare base.json new.json [--threshold percent]\n",
+			        argv[0],
+			        argv[0]);
+			return 1;
+		}
+	}
+
+	if (compareBase)
+	{
+		return CompareBenchResults(compareBase, compareNew, threshold);
+	}
+
+	if (config.nbRepetitions == 0 || config.nbRepetitions > MAX_BENCH_REPETITIONS)
+	{
+		config.nbRepetitions = config.nbRepetitions == 0 ? 1 : MAX_BENCH_REPETITIONS;
+	}
+
+	BenchWorld world                       = {};
+	world.memory.permanentStorageSize      = Megabytes(256);
+	world.memory.transientStorageSize      = Megabytes(128);
+
+	size_t benchMemorySize = Megabytes(256);
+	size_t totalSize       = world.memory.permanentStorageSize + world.memory.transientStorageSize + benchMemorySize;
+	uint8* memory          = (uint8*)PlatformAllocateMemory(totalSize);
+	BenchSuite* suite      = (BenchSuite*)PlatformAllocateMemory(sizeof(BenchSuite));
+	if (!memory || !suite)
+	{
+		return 1;
+	}
+	world.memory.permanentStorage = memory;
+	world.memory.transientStorage = memory + world.memory.permanentStorageSize;
+
+	MemoryArena benchArena;
+	InitializeArena(&benchArena,
+	                memory + world.memory.permanentStorageSize + world.memory.transientStorageSize,
+	                benchMemorySize);
+
+	suite->config    = config;
+	suite->nbResults = 0;
+
+	InitJobSystem(nbThreads);
+	ResetBenchWorld(&world);
+
+	RunBenchmarks(suite, &benchArena, &world);
+
+	int result = 0;
+	if (jsonFilename && !WriteBenchResults(suite, jsonFilename))
+	{
+		result = 1;
+	}
+
+	ShutdownJobSystem();
+	PlatformFreeMemory(suite, sizeof(BenchSuite));
+	PlatformFreeMemory(memory, totalSize);
+
+	return result;
+}
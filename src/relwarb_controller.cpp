@@ -2,6 +2,7 @@
 
 #include "relwarb.h"
 #include "relwarb_input.h"
+#include "relwarb_math.h"
 
 #include <assert.h>
 #include <string.h>
@@ -47,98 +48,176 @@ void MapActionToInput(GameState* state, int32 id, int32 action, int32 input)
 	controller->actionToInput[action] = input;
 }
 
-bool32 IsActionPressed(GameState* state, int32 id, int32 action)
+void ConfigureBotController(GameState* state, int32 id, BotBehavior behavior, uint32 seed)
 {
-	assert(id >= 0 && id < MAX_CONTROLLERS);
-	assert(action >= 0 && action < Action_Count);
+	ConfigureController(state, id, ControllerType_Bot);
 
-	Controller* controller = state->controllers + id;
-	int32       input      = controller->actionToInput[action];
+	Controller* controller     = state->controllers + id;
+	controller->botBehavior    = behavior;
+	controller->botSeed        = seed;
+}
 
-	bool32 result;
+internal uint32 GetBotActions(const Controller* controller, uint32 tick)
+{
+	uint32 result = 0;
 
-	switch (controller->controllerType)
+	switch (controller->botBehavior)
 	{
-		case ControllerType_Keyboard:
+		case BotBehavior_Random:
 		{
-			result = IsKeyPressed(state, input);
+			z::RandomSeries series  = z::SeedRandomSeries(controller->botSeed ^ (tick / 30) * 0x9E3779B9u);
+			uint32          actions = z::NextRandom(&series);
+
+			if (actions & 1)
+			{
+				result |= 1 << Action_Left;
+			}
+			else if (actions & 2)
+			{
+				result |= 1 << Action_Right;
+			}
+
+			if (actions & 4)
+			{
+				result |= 1 << Action_Jump;
+			}
+
+			// NOTE(Charly): Skills now and then, they lock the player for a while
+			if ((actions & 0xF0) == 0)
+			{
+				result |= 1 << Action_Skill1;
+			}
+			else if ((actions & 0xF0) == 0x10)
+			{
+				result |= 1 << Action_Skill2;
+			}
 		}
 		break;
 
-		case ControllerType_Gamepad:
+		case BotBehavior_Patrol:
 		{
-			int32 gid = controller->gamepadId;
-			result    = IsGamepadButtonPressed(state, gid, input);
+			uint32 beat = tick + controller->botSeed % 240;
+			result |= (beat / 120) & 1 ? 1 << Action_Left : 1 << Action_Right;
+			if (beat % 45 < 10)
+			{
+				result |= 1 << Action_Jump;
+			}
 		}
 		break;
-
-		default:
-			result = false;
 	}
 
 	return result;
 }
 
-bool32 IsActionRisingEdge(GameState* state, int32 id, int32 action)
+// NOTE(Charly): Unmapped actions are never pressed
+internal uint32 GetMappedActions(const Controller* controller, const InputState* input)
 {
-	assert(id >= 0 && id < MAX_CONTROLLERS);
-	assert(action >= 0 && action < Action_Count);
-
-	Controller* controller = state->controllers + id;
-	int32       input      = controller->actionToInput[action];
+	uint32 result = 0;
 
-	bool32 result;
-
-	switch (controller->controllerType)
+	for (int32 action = 0; action < Action_Count; ++action)
 	{
-		case ControllerType_Keyboard:
+		int32 mapped = controller->actionToInput[action];
+		if (mapped < 0)
 		{
-			result = IsKeyRisingEdge(state, input);
+			continue;
 		}
-		break;
 
-		case ControllerType_Gamepad:
+		bool32 pressed = false;
+		if (controller->controllerType == ControllerType_Keyboard)
 		{
-			int32 gid = controller->gamepadId;
-			result    = IsGamepadButtonRisingEdge(state, gid, input);
+			pressed = mapped < Key_Count && input->keyboard.keys[mapped];
+		}
+		else
+		{
+			pressed = mapped < GamepadButton_Count && input->gamepads[controller->gamepadId].buttons[mapped];
 		}
-		break;
 
-		default:
-			result = false;
+		result |= (pressed ? 1u : 0u) << action;
 	}
 
 	return result;
 }
 
+void UpdateControllers(GameState* state)
+{
+	for (int32 id = 0; id < MAX_CONTROLLERS; ++id)
+	{
+		Controller* controller = state->controllers + id;
+
+		uint32 actions     = 0;
+		uint32 lastActions = 0;
+		switch (controller->controllerType)
+		{
+			case ControllerType_Keyboard:
+			case ControllerType_Gamepad:
+			{
+				actions     = GetMappedActions(controller, &state->inputState);
+				lastActions = GetMappedActions(controller, &state->lastInputState);
+			}
+			break;
+
+			case ControllerType_Bot:
+			{
+				actions     = GetBotActions(controller, state->tick);
+				lastActions = state->tick > 0 ? GetBotActions(controller, state->tick - 1) : 0;
+			}
+			break;
+		}
+
+		controller->pressedActions = actions;
+		controller->risingActions  = actions & ~lastActions;
+		controller->fallingActions = ~actions & lastActions;
+	}
+}
+
+bool32 IsActionPressed(GameState* state, int32 id, int32 action)
+{
+	assert(id >= 0 && id < MAX_CONTROLLERS);
+	assert(action >= 0 && action < Action_Count);
+
+	bool32 result = (state->controllers[id].pressedActions >> action) & 1;
+	return result;
+}
+
+bool32 IsActionRisingEdge(GameState* state, int32 id, int32 action)
+{
+	assert(id >= 0 && id < MAX_CONTROLLERS);
+	assert(action >= 0 && action < Action_Count);
+
+	bool32 result = (state->controllers[id].risingActions >> action) & 1;
+	return result;
+}
+
 bool32 IsActionFallingEdge(GameState* state, int32 id, int32 action)
 {
 	assert(id >= 0 && id < MAX_CONTROLLERS);
 	assert(action >= 0 && action < Action_Count);
 
-	Controller* controller = state->controllers + id;
-	int32       input      = controller->actionToInput[action];
+	bool32 result = (state->controllers[id].fallingActions >> action) & 1;
+	return result;
+}
 
-	bool32 result;
+int64 GetActionPressTime(GameState* state, int32 id, int32 action)
+{
+	assert(id >= 0 && id < MAX_CONTROLLERS);
+	assert(action >= 0 && action < Action_Count);
 
-	switch (controller->controllerType)
+	int64             result     = 0;
+	const Controller* controller = state->controllers + id;
+	int32             mapped     = controller->actionToInput[action];
+	if (mapped < 0)
 	{
-		case ControllerType_Keyboard:
-		{
-			result = IsKeyFallingEdge(state, input);
-		}
-		break;
-
-		case ControllerType_Gamepad:
-		{
-			int32 gid = controller->gamepadId;
-			result    = IsGamepadButtonFallingEdge(state, gid, input);
-		}
-		break;
+		return result;
+	}
 
-		default:
-			result = false;
+	if (controller->controllerType == ControllerType_Keyboard)
+	{
+		result = mapped < Key_Count ? state->inputPressTimes.keys[mapped] : 0;
+	}
+	else if (controller->controllerType == ControllerType_Gamepad)
+	{
+		result = mapped < GamepadButton_Count ? state->inputPressTimes.gamepadButtons[controller->gamepadId][mapped] : 0;
 	}
 
 	return result;
-}
\ No newline at end of file
+}
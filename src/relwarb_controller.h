@@ -7,6 +7,14 @@ enum ControllerType
 {
 	ControllerType_Keyboard = 0,
 	ControllerType_Gamepad,
+	ControllerType_Bot,
+};
+
+// NOTE(Charly): What drives a bot controller, see GetBotActions
+enum BotBehavior
+{
+	BotBehavior_Random = 0, // NOTE(Charly): New random actions every 30 ticks
+	BotBehavior_Patrol,     // NOTE(Charly): Runs back and forth, jumps on a fixed beat
 };
 
 enum Action
@@ -30,6 +38,16 @@ struct Controller
 
 	// Used only for gamepad controller
 	int32 gamepadId;
+
+	// NOTE(Charly): Used only for bot controllers
+	BotBehavior botBehavior;
+	uint32      botSeed;
+
+	// NOTE(Charly): Bit masks (1 << Action_XXX), resolved from the mappings (or the bot) by
+	//               UpdateControllers at the start of every tick
+	uint32 pressedActions;
+	uint32 risingActions;
+	uint32 fallingActions;
 };
 
 struct GameState;
@@ -43,8 +61,18 @@ void           ConfigureController(GameState* state, int32 id, ControllerType ty
 
 void MapActionToInput(GameState* state, int32 id, int32 action, int32 input);
 
+void ConfigureBotController(GameState* state, int32 id, BotBehavior behavior, uint32 seed);
+
+// NOTE(Charly): Bot actions only depend on the tick and the seed of the bot, so that a restored
+//               snapshot or a replay sees the same bots
+void UpdateControllers(GameState* state);
+
 bool32 IsActionPressed(GameState* state, int32 id, int32 action);
 bool32 IsActionRisingEdge(GameState* state, int32 id, int32 action);
 bool32 IsActionFallingEdge(GameState* state, int32 id, int32 action);
 
+// NOTE(Charly): When the input mapped to action was pressed during the step (see
+//               GameState::inputPressTimes), 0 if it was not, for bots and unmapped actions
+int64 GetActionPressTime(GameState* state, int32 id, int32 action);
+
 #endif // RELWARB_CONTROLLER_H
\ No newline at end of file
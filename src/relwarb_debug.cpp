@@ -1,9 +1,84 @@
 #include "relwarb_debug.h"
 
-#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
 
-#include "relwarb_defines.h"
+#include "relwarb_memory.h"
+
+// NOTE(Charly): Power of two, the positions wrap
+#define LOG_RING_SIZE 4096
+#define LOG_STRINGS_SIZE 152
+#define LOG_LINE_SIZE 1024
+#define LOG_RATE_SLOTS 256
+#define LOG_IDLE_WAIT_MS 10
+
+// NOTE(Charly): Strings are copied in the record, their args hold an offset in strings
+struct LogRecord
+{
+    const char* format;
+    uint32      nbSuppressed;
+    uint8       level;
+    uint8       nbArgs;
+    uint8       argTypes[MAX_LOG_ARGS];
+    uint64      args[MAX_LOG_ARGS];
+    char        strings[LOG_STRINGS_SIZE];
+};
+
+// NOTE(Charly): Bounded MPSC queue (after D. Vyukov). The sequence of a slot says whether it
+//               can be written for a given position, or read. It is stored relative to the
+//               index of the slot, so that a zeroed ring is a valid empty ring.
+struct LogSlot
+{
+    std::atomic<uint32> sequence;
+    LogRecord           record;
+};
+
+struct LogRateLimit
+{
+    std::atomic<uint64> state; // NOTE(Charly): Second (high bits) and count in that second
+    std::atomic<uint32> nbSuppressed;
+};
+
+enum LogThreadState
+{
+    LogThread_Idle,
+    LogThread_Starting,
+    LogThread_Running,
+    LogThread_Stopped,
+};
+
+struct LogBackend
+{
+    LogSlot             ring[LOG_RING_SIZE];
+    std::atomic<uint32> enqueuePos;
+    std::atomic<uint32> dequeuePos;
+    std::atomic<uint32> nbDropped;
+
+    LogRateLimit        rateLimits[LOG_RATE_SLOTS];
+    std::atomic<uint32> second; // NOTE(Charly): Updated by the writer thread, coarse is enough
+    std::atomic<bool32> rateLimitDisabled;
+
+    std::atomic<uint32>     state;
+    std::atomic<uint32>     nbPushing; // NOTE(Charly): Producers between reading state and publishing
+    std::thread             writer;
+    std::mutex              wakeMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable flushed;
+    bool32                  wakeRequested;
+    bool32                  stopRequested;
+
+    // NOTE(Charly): Guards the output, the synchronous path may write from any thread
+    std::mutex outputMutex;
+    FILE*      file;
+};
+
+global_variable LogBackend g_log;
 
 internal const char* GetLogLevelMessage(LogLevel level)
 {
@@ -18,32 +93,523 @@ internal const char* GetLogLevelMessage(LogLevel level)
     return "";
 }
 
-internal void VarLog(LogLevel level, const char* format, va_list args)
+internal int64 GetLogArgInt(const LogRecord* record, uint32 argIdx)
+{
+    int64 result = 0;
+    if (argIdx < record->nbArgs)
+    {
+        uint64 value = record->args[argIdx];
+        switch (record->argTypes[argIdx])
+        {
+            case LogArg_Int:
+            case LogArg_Uint:
+            case LogArg_Pointer: result = (int64)value; break;
+            case LogArg_Real:
+            {
+                real64 real;
+                memcpy(&real, &value, sizeof(real));
+                result = (int64)real;
+            } break;
+            case LogArg_String: break;
+        }
+    }
+    return result;
+}
+
+internal real64 GetLogArgReal(const LogRecord* record, uint32 argIdx)
 {
-    local_persist FILE* logFile = fopen("log.txt", "w");
+    real64 result = 0.0;
+    if (argIdx < record->nbArgs)
+    {
+        uint64 value = record->args[argIdx];
+        switch (record->argTypes[argIdx])
+        {
+            case LogArg_Int: result = (real64)(int64)value; break;
+            case LogArg_Uint:
+            case LogArg_Pointer: result = (real64)value; break;
+            case LogArg_Real: memcpy(&result, &value, sizeof(result)); break;
+            case LogArg_String: break;
+        }
+    }
+    return result;
+}
+
+internal const char* GetLogArgString(const LogRecord* record, uint32 argIdx)
+{
+    const char* result = "(?)";
+    if (argIdx < record->nbArgs && record->argTypes[argIdx] == LogArg_String)
+    {
+        uint64 offset = record->args[argIdx];
+        if (offset < LOG_STRINGS_SIZE)
+        {
+            result = record->strings + offset;
+        }
+        else
+        {
+            result = offset == LOG_STRINGS_SIZE ? "(null)" : "";
+        }
+    }
+    return result;
+}
+
+// NOTE(Charly): printf on one conversion at a time, each with the argument type its conversion
+//               expects: length modifiers are dropped and integers all go through long long
+internal uint32 FormatLogRecord(const LogRecord* record, char* buffer, uint32 size)
+{
+    uint32      used   = 0;
+    uint32      argIdx = 0;
+    const char* c      = record->format;
+    while (*c && used + 1 < size)
+    {
+        if (*c != '%' || c[1] == '%')
+        {
+            buffer[used++] = *c;
+            c += *c == '%' ? 2 : 1;
+            continue;
+        }
+
+        // NOTE(Charly): Room for a '*' replaced by a number and for the conversion
+        char   spec[48];
+        uint32 specLength = 0;
+        spec[specLength++] = *c++;
+        while (*c && strchr("-+ #0123456789.*", *c) && specLength + 16 < sizeof(spec))
+        {
+            if (*c == '*')
+            {
+                specLength += snprintf(spec + specLength,
+                                       sizeof(spec) - specLength,
+                                       "%d",
+                                       (int)GetLogArgInt(record, argIdx++));
+            }
+            else
+            {
+                spec[specLength++] = *c;
+            }
+            ++c;
+        }
+        while (*c && strchr("hljztL", *c))
+        {
+            ++c;
+        }
+
+        char conversion = *c;
+        if (!conversion)
+        {
+            break;
+        }
+        ++c;
+
+        uint32 remaining = size - used;
+        int    written   = 0;
+        switch (conversion)
+        {
+            case 'd':
+            case 'i':
+            {
+                memcpy(spec + specLength, "lld", 4);
+                written = snprintf(buffer + used, remaining, spec, (long long)GetLogArgInt(record, argIdx++));
+            } break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            {
+                char suffix[4] = {'l', 'l', conversion, 0};
+                memcpy(spec + specLength, suffix, 4);
+                written = snprintf(buffer + used,
+                                   remaining,
+                                   spec,
+                                   (unsigned long long)GetLogArgInt(record, argIdx++));
+            } break;
+
+            case 'c':
+            {
+                memcpy(spec + specLength, "c", 2);
+                written = snprintf(buffer + used, remaining, spec, (int)GetLogArgInt(record, argIdx++));
+            } break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+            {
+                char suffix[2] = {conversion, 0};
+                memcpy(spec + specLength, suffix, 2);
+                written = snprintf(buffer + used, remaining, spec, GetLogArgReal(record, argIdx++));
+            } break;
+
+            case 's':
+            {
+                memcpy(spec + specLength, "s", 2);
+                written = snprintf(buffer + used, remaining, spec, GetLogArgString(record, argIdx++));
+            } break;
+
+            case 'p':
+            {
+                memcpy(spec + specLength, "p", 2);
+                written = snprintf(buffer + used,
+                                   remaining,
+                                   spec,
+                                   (void*)(uintptr_t)GetLogArgInt(record, argIdx++));
+            } break;
 
-    char str[1024];
-    vsnprintf(str, 1024, format, args);
+            default:
+            {
+                written = snprintf(buffer + used, remaining, "%%%c", conversion);
+            } break;
+        }
+
+        if (written > 0)
+        {
+            used += (uint32)written < remaining ? (uint32)written : remaining - 1;
+        }
+    }
+
+    if (record->nbSuppressed > 0 && used + 1 < size)
+    {
+        int written = snprintf(buffer + used,
+                               size - used,
+                               " (%u similar messages suppressed)",
+                               record->nbSuppressed);
+        if (written > 0)
+        {
+            used += (uint32)written < size - used ? (uint32)written : size - used - 1;
+        }
+    }
+
+    buffer[used] = '\0';
+    return used;
+}
+
+internal void WriteLogLine(LogLevel level, const char* line)
+{
+    std::lock_guard<std::mutex> lock(g_log.outputMutex);
+
+    if (g_log.file)
+    {
+        fprintf(g_log.file, "%s%s\n", GetLogLevelMessage(level), line);
+        return;
+    }
 
-#if 1
 #ifdef OS_WINDOWS
     OutputDebugString(GetLogLevelMessage(level));
-    OutputDebugString(str);
+    OutputDebugString(line);
     OutputDebugString("\n");
 #else
-    fprintf(stderr, "%s", GetLogLevelMessage(level));
-    fprintf(stderr, "%s", str);
-    fprintf(stderr, "\n");
-#endif
-#else
-    fprintf(logFile, "%s%s\n", GetLogLevelMessage(level), str);
+    fprintf(stderr, "%s%s\n", GetLogLevelMessage(level), line);
 #endif
 }
 
-void Log(LogLevel level, const char* format, ...)
+internal void WriteLogRecord(const LogRecord* record)
+{
+    char line[LOG_LINE_SIZE];
+    FormatLogRecord(record, line, LOG_LINE_SIZE);
+    WriteLogLine((LogLevel)record->level, line);
+}
+
+internal void FillLogRecord(LogRecord*    record,
+                            LogLevel      level,
+                            const char*   format,
+                            const LogArg* args,
+                            uint32        nbArgs,
+                            uint32        nbSuppressed)
+{
+    record->format       = format;
+    record->nbSuppressed = nbSuppressed;
+    record->level        = (uint8)level;
+    record->nbArgs       = (uint8)nbArgs;
+
+    uint32 stringsUsed = 0;
+    for (uint32 argIdx = 0; argIdx < nbArgs; ++argIdx)
+    {
+        const LogArg* arg        = args + argIdx;
+        record->argTypes[argIdx] = (uint8)arg->type;
+
+        if (arg->type == LogArg_String)
+        {
+            // NOTE(Charly): Truncated when it does not fit, past the end offsets read as null or
+            //               as empty
+            record->args[argIdx] = arg->s ? LOG_STRINGS_SIZE + 1 : LOG_STRINGS_SIZE;
+            if (arg->s && stringsUsed < LOG_STRINGS_SIZE)
+            {
+                uint32 length = (uint32)strnlen(arg->s, LOG_STRINGS_SIZE - stringsUsed - 1);
+                memcpy(record->strings + stringsUsed, arg->s, length);
+                record->strings[stringsUsed + length] = '\0';
+
+                record->args[argIdx] = stringsUsed;
+                stringsUsed += length + 1;
+            }
+        }
+        else
+        {
+            memcpy(record->args + argIdx, &arg->u, sizeof(uint64));
+        }
+    }
+}
+
+// NOTE(Charly): Writes out everything published, returns false when the ring is empty
+internal bool32 DrainLogRing()
+{
+    bool32 result = false;
+
+    uint32 pos = g_log.dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        LogSlot* slot = g_log.ring + (pos & (LOG_RING_SIZE - 1));
+        uint32   seq  = slot->sequence.load(std::memory_order_acquire);
+        if (seq != pos - (pos & (LOG_RING_SIZE - 1)) + 1)
+        {
+            break;
+        }
+
+        WriteLogRecord(&slot->record);
+        slot->sequence.store(seq - 1 + LOG_RING_SIZE, std::memory_order_release);
+
+        ++pos;
+        g_log.dequeuePos.store(pos, std::memory_order_release);
+        result = true;
+    }
+
+    return result;
+}
+
+internal void RunLogWriter()
+{
+    using Clock = std::chrono::steady_clock;
+
+    for (;;)
+    {
+        g_log.second.store((uint32)std::chrono::duration_cast<std::chrono::seconds>(
+                               Clock::now().time_since_epoch()).count(),
+                           std::memory_order_relaxed);
+
+        bool32 wroteSomething = DrainLogRing();
+
+        uint32 nbDropped = g_log.nbDropped.exchange(0, std::memory_order_relaxed);
+        if (nbDropped > 0)
+        {
+            char line[64];
+            snprintf(line, sizeof(line), "Log: %u messages dropped, the ring was full", nbDropped);
+            WriteLogLine(Log_Warning, line);
+        }
+
+        // NOTE(Charly): SetLogFile may swap the file at any time
+        if (wroteSomething)
+        {
+            std::lock_guard<std::mutex> lock(g_log.outputMutex);
+            if (g_log.file)
+            {
+                fflush(g_log.file);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(g_log.wakeMutex);
+        g_log.flushed.notify_all();
+
+        if (g_log.stopRequested &&
+            g_log.dequeuePos.load(std::memory_order_relaxed) == g_log.enqueuePos.load(std::memory_order_acquire))
+        {
+            break;
+        }
+
+        // NOTE(Charly): Producers never wake the writer up, that would cost them a syscall
+        g_log.wakeUp.wait_for(lock, std::chrono::milliseconds(LOG_IDLE_WAIT_MS), [] {
+            return g_log.wakeRequested;
+        });
+        g_log.wakeRequested = false;
+    }
+}
+
+internal void StartLogWriter()
+{
+    uint32 expected = LogThread_Idle;
+    if (g_log.state.compare_exchange_strong(expected, LogThread_Starting, std::memory_order_acq_rel))
+    {
+        // NOTE(Charly): Starting a thread hits the heap, and may happen in the middle of a frame
+        AllowFrameHeapAllocations();
+        g_log.writer = std::thread(RunLogWriter);
+        atexit(ShutdownLog);
+
+        g_log.state.store(LogThread_Running, std::memory_order_release);
+    }
+}
+
+// NOTE(Charly): Returns the number of messages suppressed since the last one that went through,
+//               or -1 when this one must be suppressed. Call sites are told apart by their format
+//               pointer; two of them sharing a slot share the limit.
+internal int64 RateLimitLog(const char* format)
 {
-    va_list args;
-    va_start(args, format);
-    VarLog(level, format, args);
-    va_end(args);
+    if (g_log.rateLimitDisabled.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    uint64        hash  = (uint64)(uintptr_t)format * 0x9E3779B97F4A7C15ull;
+    LogRateLimit* limit = g_log.rateLimits + (hash >> 56) % LOG_RATE_SLOTS;
+
+    uint64 second = g_log.second.load(std::memory_order_relaxed);
+    uint64 state  = limit->state.load(std::memory_order_relaxed);
+    uint64 next;
+    do
+    {
+        next = (state >> 32) == second ? state + 1 : (second << 32) | 1;
+    } while (!limit->state.compare_exchange_weak(state, next, std::memory_order_relaxed));
+
+    if ((uint32)next > LOG_RATE_LIMIT)
+    {
+        limit->nbSuppressed.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    int64 result = 0;
+    if (limit->nbSuppressed.load(std::memory_order_relaxed) > 0)
+    {
+        result = limit->nbSuppressed.exchange(0, std::memory_order_relaxed);
+    }
+    return result;
+}
+
+internal void EnqueueLogRecord(LogLevel level, const char* format, const LogArg* args, uint32 nbArgs, uint32 nbSuppressed)
+{
+    uint32   pos = g_log.enqueuePos.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    for (;;)
+    {
+        slot       = g_log.ring + (pos & (LOG_RING_SIZE - 1));
+        uint32 seq = slot->sequence.load(std::memory_order_acquire);
+        int32  dif = (int32)(seq - (pos - (pos & (LOG_RING_SIZE - 1))));
+        if (dif == 0)
+        {
+            if (g_log.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            g_log.nbDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = g_log.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    FillLogRecord(&slot->record, level, format, args, nbArgs, nbSuppressed);
+    slot->sequence.store(pos - (pos & (LOG_RING_SIZE - 1)) + 1, std::memory_order_release);
+}
+
+void PushLogRecord(LogLevel level, const char* format, const LogArg* args, uint32 nbArgs)
+{
+    int64 nbSuppressed = RateLimitLog(format);
+    if (nbSuppressed < 0)
+    {
+        return;
+    }
+
+    // NOTE(Charly): Sequentially consistent with the stop of ShutdownLog: either the state is
+    //               seen stopped here, or ShutdownLog waits for the record before its last drain
+    g_log.nbPushing.fetch_add(1, std::memory_order_seq_cst);
+    uint32 state = g_log.state.load(std::memory_order_seq_cst);
+    if (state == LogThread_Stopped)
+    {
+        g_log.nbPushing.fetch_sub(1, std::memory_order_release);
+
+        LogRecord record;
+        FillLogRecord(&record, level, format, args, nbArgs, (uint32)nbSuppressed);
+        WriteLogRecord(&record);
+        return;
+    }
+
+    if (state == LogThread_Idle)
+    {
+        StartLogWriter();
+    }
+    EnqueueLogRecord(level, format, args, nbArgs, (uint32)nbSuppressed);
+    g_log.nbPushing.fetch_sub(1, std::memory_order_release);
+}
+
+void SetLogRateLimit(bool32 enabled)
+{
+    g_log.rateLimitDisabled.store(!enabled, std::memory_order_relaxed);
+}
+
+bool32 SetLogFile(const char* filename)
+{
+    FILE* file = nullptr;
+    if (filename)
+    {
+        file = fopen(filename, "w");
+        if (!file)
+        {
+            Log(Log_Error, "Could not open log file %s", filename);
+            return false;
+        }
+    }
+
+    FlushLog();
+
+    std::lock_guard<std::mutex> lock(g_log.outputMutex);
+    if (g_log.file)
+    {
+        fclose(g_log.file);
+    }
+    g_log.file = file;
+
+    return true;
+}
+
+void FlushLog()
+{
+    if (g_log.state.load(std::memory_order_acquire) != LogThread_Running)
+    {
+        return;
+    }
+
+    uint32 target = g_log.enqueuePos.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(g_log.wakeMutex);
+    g_log.wakeRequested = true;
+    g_log.wakeUp.notify_one();
+    g_log.flushed.wait(lock, [target] {
+        return (int32)(g_log.dequeuePos.load(std::memory_order_acquire) - target) >= 0;
+    });
+}
+
+void ShutdownLog()
+{
+    uint32 expected = LogThread_Running;
+    if (!g_log.state.compare_exchange_strong(expected, LogThread_Stopped, std::memory_order_seq_cst))
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_log.wakeMutex);
+        g_log.stopRequested = true;
+        g_log.wakeRequested = true;
+    }
+    g_log.wakeUp.notify_one();
+    g_log.writer.join();
+
+    // NOTE(Charly): Producers that saw the writer running may still be enqueueing, nobody else
+    //               drains their records now
+    while (g_log.nbPushing.load(std::memory_order_seq_cst) != 0)
+    {
+        std::this_thread::yield();
+    }
+    DrainLogRing();
+
+    std::lock_guard<std::mutex> lock(g_log.outputMutex);
+    if (g_log.file)
+    {
+        fclose(g_log.file);
+        g_log.file = nullptr;
+    }
 }
@@ -1,14 +1,135 @@
 #ifndef RELWARB_DEBUG_H
 #define RELWARB_DEBUG_H
 
+#include <type_traits>
+
+#include "relwarb_defines.h"
+
+// NOTE(Charly): Ordered by severity
 enum LogLevel
 {
     Log_Debug,
-    Log_Error,
     Log_Info,
     Log_Warning,
+    Log_Error,
+};
+
+// NOTE(Charly): Messages below that level are compiled out (at least at call sites that pass a
+//               constant level, which is all of them)
+#if !defined(RELWARB_MIN_LOG_LEVEL)
+# if defined(RELWARB_DEBUG)
+#  define RELWARB_MIN_LOG_LEVEL Log_Debug
+# else
+#  define RELWARB_MIN_LOG_LEVEL Log_Info
+# endif
+#endif
+
+// NOTE(Charly): Logging is asynchronous. Log only copies the format pointer and the arguments
+//               (strings included) in a record of a lock-free ring, a background thread formats
+//               the records and writes them out. The format must then be a string literal, or at
+//               least outlive the record.
+//
+//               Every call site may log LOG_RATE_LIMIT messages per second, the next ones are
+//               counted and reported with the next message that goes through. Records that do not
+//               fit in the ring are dropped and counted, never waited for.
+#define MAX_LOG_ARGS 8
+#define LOG_RATE_LIMIT 32
+
+enum LogArgType
+{
+    LogArg_Int,
+    LogArg_Uint,
+    LogArg_Real,
+    LogArg_String,
+    LogArg_Pointer,
+};
+
+struct LogArg
+{
+    LogArgType type;
+    union
+    {
+        int64       i;
+        uint64      u;
+        real64      r;
+        const char* s;
+        const void* p;
+    };
 };
 
-void Log(LogLevel level, const char* format, ...);
+// NOTE(Charly): Integers and enums
+template <typename T>
+inline LogArg MakeLogArg(T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Unsupported log argument");
+
+    LogArg result;
+    result.type = std::is_signed<T>::value ? LogArg_Int : LogArg_Uint;
+    result.i    = (int64)value;
+    return result;
+}
+
+template <typename T>
+inline LogArg MakeLogArg(T* value)
+{
+    LogArg result;
+    result.type = LogArg_Pointer;
+    result.p    = value;
+    return result;
+}
+
+inline LogArg MakeLogArg(const char* value)
+{
+    LogArg result;
+    result.type = LogArg_String;
+    result.s    = value;
+    return result;
+}
+
+inline LogArg MakeLogArg(char* value)
+{
+    return MakeLogArg((const char*)value);
+}
+
+inline LogArg MakeLogArg(real64 value)
+{
+    LogArg result;
+    result.type = LogArg_Real;
+    result.r    = value;
+    return result;
+}
+
+inline LogArg MakeLogArg(real32 value)
+{
+    return MakeLogArg((real64)value);
+}
+
+void PushLogRecord(LogLevel level, const char* format, const LogArg* args, uint32 nbArgs);
+
+template <typename... Args>
+inline void Log(LogLevel level, const char* format, Args... args)
+{
+    static_assert(sizeof...(Args) <= MAX_LOG_ARGS, "Too many log arguments");
+
+    if (level >= RELWARB_MIN_LOG_LEVEL)
+    {
+        // NOTE(Charly): One more, no zero sized arrays
+        LogArg logArgs[sizeof...(Args) + 1] = {MakeLogArg(args)...};
+        PushLogRecord(level, format, logArgs, sizeof...(Args));
+    }
+}
+
+// NOTE(Charly): On by default, benchmarks turn it off to time the records that go through
+void SetLogRateLimit(bool32 enabled);
+
+// NOTE(Charly): Log to a file instead of stderr, nullptr goes back to stderr
+bool32 SetLogFile(const char* filename);
+
+// NOTE(Charly): Blocks until everything logged so far is written out
+void FlushLog();
+
+// NOTE(Charly): Flushes and stops the background thread, called at exit. Messages logged after
+//               that are written synchronously.
+void ShutdownLog();
 
-#endif
\ No newline at end of file
+#endif
@@ -4,51 +4,36 @@
 #include "relwarb_opengl.h"
 #include "relwarb_debug.h"
 #include "relwarb.h"
+#include "relwarb_render_snapshot.h"
 
-#include <malloc.h>
-
-enum SnapMode
+internal int GetTileIndex(EditorState* editor, z::vec2 worldPos)
 {
-	SnapMode_Corner = 0,
-	SnapMode_Center,
-	SnapMode_Count
-};
-
-global_variable SnapMode snapMode;
-global_variable int      selectedBitmap;
+	int x = z::Clamp(z::Floor(worldPos.x) + editor->width / 2, 0, editor->width - 1);
+	int y = z::Clamp(z::Floor(worldPos.y) + editor->height / 2, 0, editor->height - 1);
 
-global_variable int  width;
-global_variable int  height;
-global_variable int* tiles;
-
-internal int GetTileIndex(z::vec2 worldPos)
-{
-	int x = z::Clamp(z::Floor(worldPos.x) + width / 2, 0, width - 1);
-	int y = z::Clamp(z::Floor(worldPos.y) + height / 2, 0, height - 1);
-
-	int result = y * width + x;
+	int result = y * editor->width + x;
 	return result;
 }
 
-internal int GetTileValue(z::vec2 worldPos)
+internal int GetTileValue(EditorState* editor, z::vec2 worldPos)
 {
-	int result = tiles[GetTileIndex(worldPos)];
+	int result = editor->tiles[GetTileIndex(editor, worldPos)];
 	return result;
 }
 
-internal void AddBitmap(GameState* state, z::vec2 worldPos)
+internal void AddBitmap(EditorState* editor, z::vec2 worldPos)
 {
-	int* tile = tiles + GetTileIndex(worldPos);
+	int* tile = editor->tiles + GetTileIndex(editor, worldPos);
 	Log(Log_Debug, "%d", *tile);
-	if (*tile != selectedBitmap)
+	if (*tile != editor->selectedBitmap)
 	{
-		*tile = selectedBitmap;
+		*tile = editor->selectedBitmap;
 	}
 }
 
-internal void RemoveBitmap(GameState* state, z::vec2 worldPos)
+internal void RemoveBitmap(EditorState* editor, z::vec2 worldPos)
 {
-	int* tile = tiles + GetTileIndex(worldPos);
+	int* tile = editor->tiles + GetTileIndex(editor, worldPos);
 	if (*tile != -1)
 	{
 		*tile = -1;
@@ -57,58 +42,57 @@ internal void RemoveBitmap(GameState* state, z::vec2 worldPos)
 
 void UpdateEditor(GameState* state)
 {
-	if (tiles == nullptr)
+	EditorState* editor = &state->editor;
+	if (editor->tiles == nullptr)
 	{
-		width  = (int)state->worldSize.x;
-		height = (int)state->worldSize.y;
-		tiles  = (int*)malloc(width * height * sizeof(int));
-		Assert(tiles);
+		editor->width  = (int)state->worldSize.x;
+		editor->height = (int)state->worldSize.y;
+		editor->tiles  = PushArray(&state->worldArena, editor->width * editor->height, int);
+		Assert(editor->tiles);
 
-		for (int i = 0; i < width * height; ++i)
+		for (int i = 0; i < editor->width * editor->height; ++i)
 		{
-			tiles[i] = -1;
+			editor->tiles[i] = -1;
 		}
 	}
 
 	if (IsKeyRisingEdge(state, Key_C))
 	{
-		snapMode = (SnapMode)((snapMode + 1) % SnapMode_Count);
+		editor->snapMode = (SnapMode)((editor->snapMode + 1) % SnapMode_Count);
 	}
 
 	if (IsKeyRisingEdge(state, Key_Tab))
 	{
-		selectedBitmap = (selectedBitmap + 1) % state->nbBitmaps;
+		editor->selectedBitmap = (editor->selectedBitmap + 1) % state->nbBitmaps;
 	}
 
 	if (IsMouseButtonPressed(state, MouseButton_Left))
 	{
-		AddBitmap(state, GetCursorWorldPosition(state));
+		AddBitmap(editor, GetCursorWorldPosition(state));
 	}
 
 	if (IsMouseButtonPressed(state, MouseButton_Right))
 	{
-		RemoveBitmap(state, GetCursorWorldPosition(state));
+		RemoveBitmap(editor, GetCursorWorldPosition(state));
 	}
 }
 
-void RenderEditor(GameState* gameState)
+#if !defined(RELWARB_HEADLESS)
+void RenderEditor(GameState* gameState, const RenderSnapshot* snapshot)
 {
-	glViewport(0, 0, gameState->viewportSize.x, gameState->viewportSize.y);
-
-	glClearColor(0.3f, 0.8f, 0.7f, 0.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const EditorState* editor = &snapshot->editor;
 
 	Transform t;
 	t.origin = z::Vec2(0.5, 0.5);
 
-	for (int i = 0; i < width; ++i)
+	for (int i = 0; i < editor->width; ++i)
 	{
-		for (int j = 0; j < height; ++j)
+		for (int j = 0; j < editor->height; ++j)
 		{
-			int tile = tiles[j * width + i];
+			int tile = editor->tiles[j * editor->width + i];
 			if (tile != -1)
 			{
-				t.position = z::Vec2((i - width / 2) + 0.5, (j - height / 2) + 0.5);
+				t.position = z::Vec2((i - editor->width / 2) + 0.5, (j - editor->height / 2) + 0.5);
 				RenderBitmap(&gameState->bitmaps[tile], RenderMode_World, &t);
 			}
 			++tile;
@@ -117,9 +101,9 @@ void RenderEditor(GameState* gameState)
 
 	// NOTE(Charly): Render attached bitmap
 	{
-		z::vec2 cursor = GetCursorWorldPosition(gameState);
+		z::vec2 cursor = snapshot->cursorWorldPosition;
 		t.position     = z::Vec2(z::Floor(cursor.x) + 0.5, z::Floor(cursor.y) + 0.5);
-		RenderBitmap(&gameState->bitmaps[selectedBitmap], RenderMode_World, &t);
+		RenderBitmap(&gameState->bitmaps[editor->selectedBitmap], RenderMode_World, &t);
 	}
 	/*
 	    {
@@ -127,4 +111,8 @@ void RenderEditor(GameState* gameState)
 	        t.position = z::vec2(cursor.x, cursor.y);
 	        RenderBitmap(&gameState->bitmaps[selectedBitmap], &t);
 	    }*/
+
+	// NOTE(Charly): Queued meshes live in frame memory, they must be drawn this frame
+	FlushRenderQueue(gameState, snapshot);
 }
+#endif
@@ -1,9 +1,31 @@
 #ifndef RELWARB_EDITOR_H
 #define RELWARB_EDITOR_H
 
+#include "relwarb_defines.h"
+
 struct GameState;
+struct RenderSnapshot;
+
+enum SnapMode
+{
+	SnapMode_Corner = 0,
+	SnapMode_Center,
+	SnapMode_Count
+};
+
+// NOTE(Charly): Lives in the GameState, so that each world has its own
+struct EditorState
+{
+	SnapMode snapMode;
+	int      selectedBitmap;
+
+	// NOTE(Charly): Allocated in the world arena the first time the editor is opened
+	int  width;
+	int  height;
+	int* tiles;
+};
 
 void UpdateEditor(GameState* state);
-void RenderEditor(GameState* state);
+void RenderEditor(GameState* state, const RenderSnapshot* snapshot);
 
 #endif // RELWARB_EDITOR_H
@@ -20,7 +20,13 @@ Entity* CreatePlayerEntity(GameState*        state,
 	SetEntityComponent(result, ComponentFlag_Orientable);
 
     // FIXME(Charly): Load this from files
-    result->avatar = CreateBitmap(state);
+    // NOTE(Charly): Only the players shown in the HUD have an avatar, the others (bots of the
+    //               stress scene) have none
+    result->avatar = nullptr;
+    if (state->nbPlayers <= MAX_HUD_PLAYERS)
+    {
+        result->avatar = CreateBitmap(state);
+    }
     switch (state->nbPlayers)
     {
         case 1:
@@ -39,8 +45,6 @@ Entity* CreatePlayerEntity(GameState*        state,
         {
             //LoadBitmapData("assets/sprites/p4_avatar.png", result->avatar);
         }break;
-        default:
-            Log(Log_Error, "Invalid number of players");
     }
     result->max_health = 10;
     result->health = 1;
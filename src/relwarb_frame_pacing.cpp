@@ -0,0 +1,190 @@
+#include "relwarb_frame_pacing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+#include "relwarb_debug.h"
+#include "relwarb_math.h"
+#include "relwarb_profiler.h"
+
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define CpuRelax() _mm_pause()
+#else
+#define CpuRelax() std::this_thread::yield()
+#endif
+
+// NOTE(Charly): Linux oversleeps by tens of microseconds, Windows by up to a scheduler tick
+//               (1 to 15 ms). Past the maximum we would rather miss the deadline than spin.
+#define MIN_SPIN_MARGIN 100000   // NOTE(Charly): 0.1 ms
+#define MAX_SPIN_MARGIN 4000000  // NOTE(Charly): 4 ms
+#define INITIAL_SPIN_MARGIN 1000000
+
+#define DEFAULT_CAP_RATE 60.0
+
+global_variable const char* framePacingModeNames[] = {"off", "vsync", "adaptive", "cap"};
+
+internal int64 GetPacingTime()
+{
+	int64 result = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                   std::chrono::steady_clock::now().time_since_epoch())
+	                   .count();
+	return result;
+}
+
+void InitFramePacer(FramePacer* pacer, FramePacingMode mode, real64 capRate)
+{
+	*pacer      = {};
+	pacer->mode = mode;
+
+	if (mode == FramePacing_Cap && capRate <= 0.0)
+	{
+		Log(Log_Warning, "Frame pacing: invalid cap, using %.0f fps", DEFAULT_CAP_RATE);
+		capRate = DEFAULT_CAP_RATE;
+	}
+	pacer->targetInterval = capRate > 0.0 ? (int64)(1e9 / capRate) : 0;
+
+	int64 now          = GetPacingTime();
+	pacer->deadline    = now;
+	pacer->frameStart  = now;
+	pacer->lastPresent = now;
+	pacer->spinMargin  = INITIAL_SPIN_MARGIN;
+}
+
+int32 GetFramePacingSwapInterval(FramePacingMode mode)
+{
+	int32 result = mode == FramePacing_VSync ? 1 : mode == FramePacing_Adaptive ? -1 : 0;
+	return result;
+}
+
+void BeginPacedFrame(FramePacer* pacer)
+{
+	int64 now    = GetPacingTime();
+	pacer->sleep = 0;
+	pacer->spin  = 0;
+
+	if (pacer->mode == FramePacing_Cap)
+	{
+		// NOTE(Charly): Never try to catch up, a late frame just pushes the next ones
+		if (pacer->deadline < now)
+		{
+			pacer->deadline = now;
+		}
+
+		int64 remaining = pacer->deadline - now;
+		if (remaining > pacer->spinMargin)
+		{
+			int64 requested = remaining - pacer->spinMargin;
+			std::this_thread::sleep_for(std::chrono::nanoseconds(requested));
+
+			int64 woken     = GetPacingTime();
+			int64 overshoot = (woken - now) - requested;
+
+			// NOTE(Charly): Grows right away, shrinks slowly: a missed deadline costs more than
+			//               a bit of spinning
+			int64 margin = overshoot + overshoot / 4;
+			if (margin > pacer->spinMargin)
+			{
+				pacer->spinMargin = margin;
+			}
+			else
+			{
+				pacer->spinMargin -= (pacer->spinMargin - margin) / 16;
+			}
+			pacer->spinMargin = z::Clamp(pacer->spinMargin, (int64)MIN_SPIN_MARGIN, (int64)MAX_SPIN_MARGIN);
+
+			pacer->sleep = woken - now;
+			now          = woken;
+		}
+
+		int64 spinStart = now;
+		while (now < pacer->deadline)
+		{
+			CpuRelax();
+			now = GetPacingTime();
+		}
+		pacer->spin = now - spinStart;
+
+		// NOTE(Charly): From when the frame actually starts, after an oversleep the next frame
+		//               would start right away otherwise
+		pacer->deadline = std::max(pacer->deadline, now) + pacer->targetInterval;
+	}
+
+	pacer->frameStart = now;
+}
+
+void EndPacedFrame(FramePacer* pacer)
+{
+	int64 now = GetPacingTime();
+
+	FramePacingSample* sample = &pacer->history[pacer->nbFrames % FRAME_PACING_HISTORY];
+	sample->presentInterval   = now - pacer->lastPresent;
+	sample->work              = now - pacer->frameStart;
+	sample->sleep             = pacer->sleep;
+	sample->spin              = pacer->spin;
+
+	++pacer->nbFrames;
+	pacer->lastPresent = now;
+
+	PROFILE_COUNTER("PresentMs", sample->presentInterval / 1e6);
+	PROFILE_COUNTER("WaitMs", (sample->sleep + sample->spin) / 1e6);
+}
+
+void GetFramePacingStats(const FramePacer* pacer, FramePacingStats* stats)
+{
+	*stats          = {};
+	stats->nbFrames = pacer->nbFrames < FRAME_PACING_HISTORY ? pacer->nbFrames : FRAME_PACING_HISTORY;
+	if (stats->nbFrames == 0)
+	{
+		return;
+	}
+
+	stats->minPresentInterval = 1e30;
+	for (uint32 sampleIdx = 0; sampleIdx < stats->nbFrames; ++sampleIdx)
+	{
+		const FramePacingSample* sample   = &pacer->history[sampleIdx];
+		real64                   interval = sample->presentInterval / 1e6;
+
+		stats->meanPresentInterval += interval;
+		stats->minPresentInterval = std::min(stats->minPresentInterval, interval);
+		stats->maxPresentInterval = std::max(stats->maxPresentInterval, interval);
+		stats->meanWork += sample->work / 1e6;
+		stats->meanSleep += sample->sleep / 1e6;
+		stats->meanSpin += sample->spin / 1e6;
+	}
+	stats->meanPresentInterval /= stats->nbFrames;
+	stats->meanWork /= stats->nbFrames;
+	stats->meanSleep /= stats->nbFrames;
+	stats->meanSpin /= stats->nbFrames;
+
+	real64 variance = 0.0;
+	for (uint32 sampleIdx = 0; sampleIdx < stats->nbFrames; ++sampleIdx)
+	{
+		real64 delta = pacer->history[sampleIdx].presentInterval / 1e6 - stats->meanPresentInterval;
+		variance += delta * delta;
+	}
+	stats->presentIntervalStdDev = sqrt(variance / stats->nbFrames);
+}
+
+bool32 ParseFramePacingMode(const char* string, FramePacingMode* mode)
+{
+	for (uint32 modeIdx = 0; modeIdx < sizeof(framePacingModeNames) / sizeof(framePacingModeNames[0]); ++modeIdx)
+	{
+		if (strcmp(string, framePacingModeNames[modeIdx]) == 0)
+		{
+			*mode = (FramePacingMode)modeIdx;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* GetFramePacingModeName(FramePacingMode mode)
+{
+	const char* result = framePacingModeNames[mode];
+	return result;
+}
@@ -0,0 +1,84 @@
+#ifndef RELWARB_FRAME_PACING_H
+#define RELWARB_FRAME_PACING_H
+
+#include "relwarb_defines.h"
+
+// NOTE(Charly): Decides when the platform layer starts a frame.
+//               - Off: as fast as possible, no swap interval (benchmarks only, burns a core)
+//               - VSync: the swap waits for the vertical blank
+//               - Adaptive: vsync, but a late frame is presented right away (tears) instead of
+//               waiting for the next blank. Needs *_EXT_swap_control_tear, vsync otherwise.
+//               - Cap: no swap interval, frames start on a fixed schedule. The wait sleeps
+//               until shortly before the deadline then spins, the margin follows how much the
+//               sleeps of this machine overshoot.
+//
+//               The wait happens at the start of the frame, before the input is read, so that
+//               waiting does not add to the latency of the frame.
+enum FramePacingMode
+{
+	FramePacing_Off,
+	FramePacing_VSync,
+	FramePacing_Adaptive,
+	FramePacing_Cap,
+};
+
+#define FRAME_PACING_HISTORY 128
+
+struct FramePacingSample
+{
+	int64 presentInterval; // NOTE(Charly): Since the previous present, in ns
+	int64 work;            // NOTE(Charly): From the end of the wait to the present
+	int64 sleep;
+	int64 spin;
+};
+
+struct FramePacer
+{
+	FramePacingMode mode;
+	int64           targetInterval; // NOTE(Charly): Cap only, in ns
+
+	int64 deadline;
+	int64 frameStart;
+	int64 lastPresent;
+	int64 spinMargin;
+
+	// NOTE(Charly): Wait of the current frame, committed with its present
+	int64 sleep;
+	int64 spin;
+
+	uint32            nbFrames;
+	FramePacingSample history[FRAME_PACING_HISTORY];
+};
+
+// NOTE(Charly): Over the frames of the history, in ms
+struct FramePacingStats
+{
+	uint32 nbFrames;
+
+	real64 meanPresentInterval;
+	real64 presentIntervalStdDev;
+	real64 minPresentInterval;
+	real64 maxPresentInterval;
+
+	real64 meanWork;
+	real64 meanSleep;
+	real64 meanSpin;
+};
+
+// NOTE(Charly): capRate in frames per second, only used by FramePacing_Cap
+void InitFramePacer(FramePacer* pacer, FramePacingMode mode, real64 capRate);
+
+// NOTE(Charly): What to give to glfwSwapInterval (or its equivalent)
+int32 GetFramePacingSwapInterval(FramePacingMode mode);
+
+// NOTE(Charly): Right before reading the input, waits when the frames are capped
+void BeginPacedFrame(FramePacer* pacer);
+// NOTE(Charly): Right after the swap (or glFinish) returned
+void EndPacedFrame(FramePacer* pacer);
+
+void GetFramePacingStats(const FramePacer* pacer, FramePacingStats* stats);
+
+bool32      ParseFramePacingMode(const char* string, FramePacingMode* mode);
+const char* GetFramePacingModeName(FramePacingMode mode);
+
+#endif // RELWARB_FRAME_PACING_H
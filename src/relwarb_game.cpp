@@ -5,6 +5,7 @@
 #include "relwarb.h"
 
 #include "relwarb_debug.h"
+#include "relwarb_profiler.h"
 
 bool CreateDashSkill(Skill* skill, Entity* entity)
 {
@@ -137,20 +138,6 @@ bool DashApply(GameState* gameState, Skill* skill, Entity* executive, real32 dt)
 		executive->p.x += skill->dash.direction * ratio * skill->dash.horizDistance;
 		executive->dp = z::vec2{0.0, 0.0};
 
-		// Post effects
-		real32    interpolate = skill->dash.elapsed * 5.0;
-		z::vec4   currentColor{1.f - interpolate, interpolate, 0.f, 1.f};
-		Transform transform   = {};
-		transform.origin      = z::vec2{0.5, 0.0};
-		auto worldToNormalize = GetProjectionMatrix(RenderMode_World, gameState) *
-		                        GetTransformMatrix(RenderMode_World, &transform);
-		auto normalizePos = worldToNormalize * skill->dash.initialPos;
-		RenderText("Dash !",
-		           normalizePos * z::vec2{0.5, 0.5} + z::vec2{0.5, 0.5},
-		           currentColor,
-		           gameState,
-		           ObjectType::ObjectType_UI);
-
 		return true;
 	}
 	return false;
@@ -186,24 +173,6 @@ bool ManaApply(GameState* gameState, Skill* skill, Entity* executive, real32 dt)
 			}
 		}
 
-		// Post effects
-		z::vec4   indigo{0.3f, 0.0f, 0.51f, 1.0f};
-		z::vec4   turquoise{0.0f, 0.8f, 0.81f, 1.0f};
-		real32    elapsed2     = skill->mana.elapsed * 2.f;
-		real32    interpolate  = (elapsed2 < 1.f) ? (elapsed2) : (2.f - elapsed2);
-		z::vec4   currentColor = indigo * interpolate + turquoise * (1.f - interpolate);
-		Transform transform    = {};
-		transform.origin       = z::vec2{0.5, 0.0};
-		auto worldToNormalize  = GetProjectionMatrix(RenderMode_World, gameState) *
-		                        GetTransformMatrix(RenderMode_World, &transform);
-		auto normalizePos = worldToNormalize *
-		                    (executive->p + executive->shape->size * z::vec2{0.0, 1.0});
-		RenderText("Mana !",
-		           normalizePos * z::vec2{0.5, 0.5} + z::vec2{0.5, 0.5},
-		           currentColor,
-		           gameState,
-		           ObjectType::ObjectType_UI);
-
 		return true;
 	}
 	return false;
@@ -242,6 +211,8 @@ bool PassiveRegenerationApply(GameState* gameState, Skill* skill, Entity* execut
 
 void UpdateGameLogic(GameState* gameState, real32 dt)
 {
+	TIMED_FUNCTION();
+
 	for (uint32 playerIdx = 0; playerIdx < gameState->nbPlayers; ++playerIdx)
 	{
 		Entity*     player     = gameState->players[playerIdx];
@@ -2,18 +2,38 @@
 #include "relwarb_opengl.h"
 #include "relwarb_utils.h"
 #include "relwarb_debug.h"
+#include "relwarb_frame_pacing.h"
 #include "relwarb_input.h"
+#include "relwarb_input_events.h"
+#include "relwarb_latency.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+#include "relwarb_replay.h"
+#include "relwarb_jobs.h"
+#include "relwarb_profiler.h"
+#include "relwarb_trace.h"
+#include "relwarb_stress_scene.h"
+#include "relwarb_render_snapshot.h"
+#include "relwarb_renderer.h"
 #include "relwarb.h"
 
 #include <GLFW/glfw3.h>
 
 #include <assert.h>
+#include <atomic>
 #include <chrono>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
 
 global_variable uint32 worldWindowWidth  = 1440;
 global_variable uint32 worldWindowHeight = 720;
 
+// NOTE(Charly): Frame memory of the simulation thread, the main thread uses the transient storage
+#define SIMULATION_FRAME_MEMORY_SIZE Megabytes(64)
+#define RENDER_SNAPSHOTS_MEMORY_SIZE Megabytes(48)
+
 global_variable const int keys[Key_Count] = {
     GLFW_KEY_A,
     GLFW_KEY_B,
@@ -85,120 +105,449 @@ global_variable const int mouseButtons[MouseButton_Count] = {
     GLFW_MOUSE_BUTTON_3,
 };
 
-internal void ProcessKeyboard(GLFWwindow* window, InputState* state)
+// NOTE(Charly): The callbacks push events, joysticks have no callback for their buttons and axes
+//               and are polled (only the connected ones), their changes pushed as events
+struct PlatformInput
+{
+	InputEventQueue* events;
+
+	int8 keys[GLFW_KEY_LAST + 1]; // NOTE(Charly): GLFW key to Key
+
+	bool32       joystickConnected[GLFW_JOYSTICK_LAST + 1];
+	uint32       nbGamepads;
+	GamepadState gamepads[MAX_GAMEPADS]; // NOTE(Charly): As last pushed
+};
+
+global_variable PlatformInput platformInput;
+
+internal void PushButtonEvent(InputEventType type, int32 code, bool32 pressed, uint8 gamepad = 0)
 {
+	InputEvent event = {};
+	event.time       = GetInputEventTime();
+	event.type       = (uint8)type;
+	event.gamepad    = gamepad;
+	event.code       = (int16)code;
+	event.pressed    = pressed;
+	PushInputEvent(platformInput.events, event);
+}
+
+internal void PushValueEvent(InputEventType type, int32 code, z::vec2 value, uint8 gamepad = 0)
+{
+	InputEvent event = {};
+	event.time       = GetInputEventTime();
+	event.type       = (uint8)type;
+	event.gamepad    = gamepad;
+	event.code       = (int16)code;
+	event.values[0]  = value.x;
+	event.values[1]  = value.y;
+	PushInputEvent(platformInput.events, event);
+}
+
+internal void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	(void)scancode;
+	(void)mods;
+
+	if (action == GLFW_REPEAT || key < 0 || key > GLFW_KEY_LAST)
+	{
+		return;
+	}
+
 	// TODO(charly): Handle esc for real (transition between screens, etc)
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(window, true);
 	}
 
-	KeyboardState* kstate = &state->keyboard;
+	if (platformInput.keys[key] != Key_Unknown)
+	{
+		PushButtonEvent(InputEvent_Key, platformInput.keys[key], action == GLFW_PRESS);
+	}
+}
 
-	for (int k = 0; k < Key_Count; ++k)
+// NOTE(Charly): Replays do not read the devices, ESC still quits
+internal void ReplayKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	(void)scancode;
+	(void)mods;
+
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+	{
+		glfwSetWindowShouldClose(window, true);
+	}
+}
+
+internal void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+	(void)window;
+	(void)mods;
+
+	for (int b = 0; b < MouseButton_Count; ++b)
+	{
+		if (mouseButtons[b] == button)
+		{
+			PushButtonEvent(InputEvent_MouseButton, b, action == GLFW_PRESS);
+		}
+	}
+}
+
+internal void CursorPosCallback(GLFWwindow* window, double x, double y)
+{
+	(void)window;
+	PushValueEvent(InputEvent_Cursor, 0, z::Vec2(x, y));
+}
+
+internal void JoystickCallback(int jid, int event)
+{
+	if (jid >= 0 && jid <= GLFW_JOYSTICK_LAST)
 	{
-		kstate->keys[k] = (glfwGetKey(window, keys[k]) == GLFW_PRESS);
+		platformInput.joystickConnected[jid] = event == GLFW_CONNECTED;
 	}
 }
 
-internal void ProcessMouse(GLFWwindow* window, InputState* state)
+internal void InitPlatformInput(GLFWwindow* window, InputEventQueue* events)
 {
-	MouseState* mstate = &state->mouse;
+	platformInput.events = events;
+
+	for (int key = 0; key <= GLFW_KEY_LAST; ++key)
+	{
+		platformInput.keys[key] = Key_Unknown;
+	}
+	for (int k = 0; k < Key_Count; ++k)
+	{
+		platformInput.keys[keys[k]] = (int8)k;
+	}
 
+	// NOTE(Charly): Then kept up to date by the callback
+	for (int jid = 0; jid <= GLFW_JOYSTICK_LAST; ++jid)
+	{
+		platformInput.joystickConnected[jid] = glfwJoystickPresent(jid);
+	}
+
+	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
+	glfwSetCursorPosCallback(window, CursorPosCallback);
+	glfwSetJoystickCallback(JoystickCallback);
+
+	// NOTE(Charly): The cursor is only reported when it moves
 	double x, y;
 	glfwGetCursorPos(window, &x, &y);
+	CursorPosCallback(window, x, y);
+}
 
-	mstate->cursor.x = x;
-	mstate->cursor.y = y;
+// NOTE(Charly): X-Box controller:
+//               Axes:
+//                   - 0-1:  Left thumbstick (-1 left, 1 right, -1 up, 1 down)
+//                   - 2:    LT (1 fully pressed)
+//                   - 3-4:  Right thumbstick (-1 left, 1 right, -1 up, 1 down)
+//                   - 5:    RT (1 fully pressed)
+//               Buttons: see GamepadButton
+internal void ReadGamepad(int jid, GamepadState* gstate)
+{
+	int                  axisCount, buttonCount;
+	const float*         axes    = glfwGetJoystickAxes(jid, &axisCount);
+	const unsigned char* buttons = glfwGetJoystickButtons(jid, &buttonCount);
 
-	for (int b = 0; b < MouseButton_Count; ++b)
+	*gstate = {};
+	if (!axes || !buttons || axisCount < 6)
 	{
-		mstate->buttons[b] = (glfwGetMouseButton(window, mouseButtons[b]) == GLFW_PRESS);
+		return;
+	}
+
+	// TODO(charly): Maybe we should use constants instead of magic numbers ? ...
+	gstate->leftThumbStick  = z::Vec2(axes[0], axes[1]);
+	gstate->rightThumbStick = z::Vec2(axes[3], axes[4]);
+	gstate->leftTrigger     = axes[2];
+	gstate->rightTrigger    = axes[5];
+
+	for (int button = 0; button < GamepadButton_Count && button < buttonCount; ++button)
+	{
+		gstate->buttons[button] = (buttons[button] == GLFW_PRESS);
+	}
+
+	static const real32 DEAD_ZONE = 0.25;
+	// HACK(charly): Set the pad state to the same as the left thumbstick
+	if (axes[0] > DEAD_ZONE)
+	{
+		gstate->buttons[GamepadButton_PadRight] = true;
+	}
+	else if (axes[0] < -DEAD_ZONE)
+	{
+		gstate->buttons[GamepadButton_PadLeft] = true;
+	}
+
+	if (axes[1] > DEAD_ZONE)
+	{
+		gstate->buttons[GamepadButton_PadDown] = true;
+	}
+	else if (axes[1] < -DEAD_ZONE)
+	{
+		gstate->buttons[GamepadButton_PadUp] = true;
 	}
 }
 
-internal void ProcessJoystick(GLFWwindow* window, InputState* state)
+// NOTE(Charly): Connected joysticks take the gamepad slots in order
+internal void PollGamepads()
 {
-	(void)window;
-	// X-Box controller:
-	//  Axes:
-	//      - 0-1:  Left thumbstick (-1 left, 1 right, -1 up, 1 down)
-	//      - 2:    LT (1 fully pressed)
-	//      - 3-4:  Right thumbstick (-1 left, 1 right, -1 up, 1 down)
-	//      - 5:    RT (1 fully pressed)
-	//  Buttons:
-	//      - 0 : A
-	//      - 1 : B
-	//      - 2 : X
-	//      - 3 : Y
-	//      - 4 : LB
-	//      - 5 : RB
-	//      - 6 : back
-	//      - 7 : start
-	//      - 8 : menu
-	//      - 9 : Left stick click
-	//      - 10: Right stick click
-	//      - 11: Left joystick up
-	//      - 12: Left joystick right
-	//      - 13: Left joystick down
-	//      - 14: Left joystick left
-
-	int currentJoystick = 0;
-	for (int jid = 0; jid < GLFW_JOYSTICK_LAST && currentJoystick < MAX_GAMEPADS; ++jid)
-	{
-		if (glfwJoystickPresent(jid))
-		{
-			int                  axisCount, buttonCount;
-			const float*         axes    = glfwGetJoystickAxes(GLFW_JOYSTICK_1, &axisCount);
-			const unsigned char* buttons = glfwGetJoystickButtons(GLFW_JOYSTICK_1, &buttonCount);
-
-			GamepadState* gstate = state->gamepads + currentJoystick;
-
-			// TODO(charly): Maybe we should use constants instead of magic numbers ? ...
-			gstate->leftThumbStick  = z::Vec2(axes[0], axes[1]);
-			gstate->rightThumbStick = z::Vec2(axes[3], axes[4]);
-			gstate->leftTrigger     = axes[2];
-			gstate->rightTrigger    = axes[5];
-
-			for (int button = 0; button < GamepadButton_Count; ++button)
-			{
-				gstate->buttons[button] = (buttons[button] == GLFW_PRESS);
-			}
+	uint32 nbGamepads = 0;
+	for (int jid = 0; jid <= GLFW_JOYSTICK_LAST && nbGamepads < MAX_GAMEPADS; ++jid)
+	{
+		if (!platformInput.joystickConnected[jid])
+		{
+			continue;
+		}
 
-			static const real32 DEAD_ZONE = 0.25;
-			// HACK(charly): Set the pad state to the same as the left thumbstick
-			if (axes[0] > DEAD_ZONE)
-			{
-				gstate->buttons[GamepadButton_PadRight] = true;
-			}
-			else if (axes[0] < -DEAD_ZONE)
+		uint8         pad = (uint8)nbGamepads++;
+		GamepadState  gstate;
+		GamepadState* last = &platformInput.gamepads[pad];
+		ReadGamepad(jid, &gstate);
+
+		for (int button = 0; button < GamepadButton_Count; ++button)
+		{
+			if (gstate.buttons[button] != last->buttons[button])
 			{
-				gstate->buttons[GamepadButton_PadLeft] = true;
+				PushButtonEvent(InputEvent_GamepadButton, button, gstate.buttons[button], pad);
 			}
+		}
+
+		if (gstate.leftThumbStick != last->leftThumbStick)
+		{
+			PushValueEvent(InputEvent_GamepadAxis, GamepadAxis_LeftThumbStick, gstate.leftThumbStick, pad);
+		}
+		if (gstate.rightThumbStick != last->rightThumbStick)
+		{
+			PushValueEvent(InputEvent_GamepadAxis, GamepadAxis_RightThumbStick, gstate.rightThumbStick, pad);
+		}
+		if (gstate.leftTrigger != last->leftTrigger || gstate.rightTrigger != last->rightTrigger)
+		{
+			PushValueEvent(InputEvent_GamepadAxis,
+			               GamepadAxis_Triggers,
+			               z::Vec2(gstate.leftTrigger, gstate.rightTrigger),
+			               pad);
+		}
+
+		*last = gstate;
+	}
+
+	for (uint32 pad = nbGamepads; pad < platformInput.nbGamepads; ++pad)
+	{
+		InputEvent event = {};
+		event.time       = GetInputEventTime();
+		event.type       = InputEvent_GamepadDisconnected;
+		event.gamepad    = (uint8)pad;
+		PushInputEvent(platformInput.events, event);
+
+		platformInput.gamepads[pad] = {};
+	}
+	platformInput.nbGamepads = nbGamepads;
+}
+
+// NOTE(Charly): The simulation runs on its own thread, one step per fixed dt of real time. The
+//               main thread owns the window and GL: it polls the input, hands it over, and
+//               renders the latest snapshot the simulation published, as often as it can.
+struct SimulationThread
+{
+	GameState*            gameState;
+	RenderSnapshotBuffer* snapshots;
+	uint8*                frameMemory;
+	uint32                nbJobThreads;
+
+	InputPlayback* playback;
+	bool32         replayFixedDt;
+	InputRecorder* recorder;
+
+	// NOTE(Charly): Pushed by the main thread. Each step applies what happened before it started
+	//               to input, which only the simulation thread touches.
+	InputEventQueue events;
+	InputState      input;
+
+	std::atomic<bool32> quit; // NOTE(Charly): Set by the main thread
+	std::atomic<bool32> done; // NOTE(Charly): Set by the simulation at the end of a replay
+};
 
-			if (axes[1] > DEAD_ZONE)
+internal void RunSimulation(SimulationThread* sim)
+{
+	InitializeFrameMemory(sim->frameMemory, SIMULATION_FRAME_MEMORY_SIZE);
+	RegisterProfilerThread("Simulation");
+
+	// NOTE(Charly): The simulation is where the jobs are, it owns the pool
+	InitJobSystem(sim->nbJobThreads);
+
+	GameState* gameState = sim->gameState;
+
+	using Clock     = std::chrono::high_resolution_clock;
+	using TimePoint = std::chrono::time_point<Clock>;
+	using Seconds   = std::chrono::seconds::period;
+
+	TimePoint t0       = Clock::now();
+	TimePoint nextStep = t0;
+	TimePoint t1;
+
+	while (!sim->quit.load(std::memory_order_acquire))
+	{
+		t1        = Clock::now();
+		real32 dt = std::chrono::duration<float, Seconds>(t1 - t0).count();
+		t0        = t1;
+
+		BeginProfilerFrame();
+
+		int64      stepTime = GetInputEventTime();
+		InputState input    = gameState->inputState;
+		if (sim->playback->file)
+		{
+			real32 recordedDt;
+			if (!PlaybackInputFrame(sim->playback, &input, &recordedDt))
 			{
-				gstate->buttons[GamepadButton_PadDown] = true;
+				Log(Log_Info, "Replay done (%u frames)", sim->playback->frame);
+				sim->done.store(true, std::memory_order_release);
+				break;
 			}
-			else if (axes[1] < -DEAD_ZONE)
+
+			dt = sim->replayFixedDt ? gameState->fixedDt : recordedDt;
+		}
+		else
+		{
+			// NOTE(Charly): Without a tick, the events (and their press times) wait for the next
+			//               frame that has one
+			if (WillStepGame(gameState, dt))
 			{
-				gstate->buttons[GamepadButton_PadUp] = true;
+				ApplyInputEvents(&sim->events, &sim->input, stepTime, &gameState->inputPressTimes);
 			}
+			input = sim->input;
+		}
 
-			++currentJoystick;
+		RecordInputFrame(sim->recorder, &input, dt);
+
+		StepGame(gameState, &input, dt);
+
+		BuildRenderSnapshot(gameState, GetRenderSnapshotToWrite(sim->snapshots));
+		PublishRenderSnapshot(sim->snapshots);
+
+		EndProfilerFrame();
+
+		EndFrameMemory();
+		EndJobsFrame();
+
+		// NOTE(Charly): Never try to catch up, a late step just pushes the next ones
+		nextStep += std::chrono::duration_cast<Clock::duration>(
+		    std::chrono::duration<float, Seconds>(gameState->fixedDt));
+		TimePoint now = Clock::now();
+		if (nextStep < now)
+		{
+			nextStep = now;
 		}
+		std::this_thread::sleep_until(nextStep);
 	}
-}
 
-internal void ProcessInputState(GLFWwindow* window, InputState* state)
-{
-	ProcessKeyboard(window, state);
-	ProcessMouse(window, state);
-	ProcessJoystick(window, state);
+	// NOTE(Charly): At the end of a replay, the main thread may still be rendering with jobs. It
+	//               detaches from the pool before it asks us to quit.
+	while (!sim->quit.load(std::memory_order_acquire))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	ShutdownJobSystem();
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	bool32 useLargePages = false;
+	bool32 deterministic = false;
+	bool32 seeded        = false;
+	uint32 seed          = 0;
+
+	const char* recordFilename  = nullptr;
+	const char* replayFilename  = nullptr;
+	bool32      replayFixedDt   = false;
+	uint32      nbJobThreads    = 0;
+	const char* traceFilename   = nullptr;
+	uint32      nbTraceFrames   = 0;
+	bool32      stressScene     = false;
+	const char* statsFilename   = nullptr;
+	const char* latencyFilename = nullptr;
+
+	// NOTE(Charly): Off spins a core at 100% drawing frames nobody sees
+	FramePacingMode pacingMode = FramePacing_VSync;
+	real64          frameCap   = 0.0;
+
+	StressSceneParams stressParams = {};
+	stressParams.botBehavior       = BotBehavior_Random;
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		if (strcmp(argv[argIdx], "--large-pages") == 0)
+		{
+			useLargePages = true;
+		}
+		else if (strcmp(argv[argIdx], "--deterministic") == 0)
+		{
+			deterministic = true;
+		}
+		else if (strcmp(argv[argIdx], "--seed") == 0 && argIdx + 1 < argc)
+		{
+			seed   = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+			seeded = true;
+		}
+		else if (strcmp(argv[argIdx], "--record") == 0 && argIdx + 1 < argc)
+		{
+			recordFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--replay") == 0 && argIdx + 1 < argc)
+		{
+			replayFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--replay-fixed-dt") == 0)
+		{
+			// NOTE(Charly): Every frame is a single tick of the recorded fixed dt, the same
+			//               session then always does the same work, whatever the machine.
+			replayFixedDt = true;
+		}
+		else if (strcmp(argv[argIdx], "--job-threads") == 0 && argIdx + 1 < argc)
+		{
+			nbJobThreads = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--trace") == 0 && argIdx + 1 < argc)
+		{
+			traceFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--trace-frames") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): Rendered frames, the simulation may tick more or less often
+			nbTraceFrames = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--stress-scene") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): platforms,bots,systems
+			stressScene = ParseStressSceneParams(argv[++argIdx], &stressParams);
+		}
+		else if (strcmp(argv[argIdx], "--stress-patrol") == 0)
+		{
+			stressParams.botBehavior = BotBehavior_Patrol;
+		}
+		else if (strcmp(argv[argIdx], "--render-stats") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): CSV, a line per rendered frame
+			statsFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--latency") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): CSV of the input latency histograms, written at exit
+			latencyFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--frame-pacing") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): off, vsync, adaptive or cap
+			if (!ParseFramePacingMode(argv[++argIdx], &pacingMode))
+			{
+				Log(Log_Warning, "Unknown frame pacing mode %s", argv[argIdx]);
+			}
+		}
+		else if (strcmp(argv[argIdx], "--frame-cap") == 0 && argIdx + 1 < argc)
+		{
+			frameCap   = strtod(argv[++argIdx], nullptr);
+			pacingMode = FramePacing_Cap;
+		}
+	}
+
 	glfwInit();
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -214,10 +563,93 @@ int main()
 	glfwMakeContextCurrent(window);
 	gl3wInit();
 
-	GameState gameState    = {};
-	gameState.viewportSize = z::Vec2(worldWindowWidth, worldWindowHeight);
+	GameMemory gameMemory           = {};
+	gameMemory.permanentStorageSize = Megabytes(256);
+	gameMemory.transientStorageSize = Megabytes(128);
+
+	size_t totalSize = gameMemory.permanentStorageSize + gameMemory.transientStorageSize;
+	uint8* memory    = (uint8*)PlatformAllocateMemory(totalSize, useLargePages);
+	if (!memory)
+	{
+		return 1;
+	}
+	gameMemory.permanentStorage = memory;
+	gameMemory.transientStorage = memory + gameMemory.permanentStorageSize;
 
-	InitGame(&gameState);
+	GameState* gameState    = InitGameMemory(&gameMemory);
+	gameState->viewportSize  = z::Vec2(worldWindowWidth, worldWindowHeight);
+	gameState->deterministic = deterministic;
+	gameState->seeded        = seeded;
+	gameState->seed          = seed;
+
+	InputPlayback playback = {};
+	if (replayFilename)
+	{
+		if (!BeginInputPlayback(&playback, replayFilename, gameState))
+		{
+			return 1;
+		}
+
+		if (replayFixedDt)
+		{
+			gameState->deterministic = true;
+		}
+	}
+
+	RegisterProfilerThread("Render");
+
+	if (traceFilename)
+	{
+		BeginTraceCapture(traceFilename, nbTraceFrames);
+	}
+
+	if (statsFilename)
+	{
+		BeginRenderStatsCapture(statsFilename);
+	}
+
+	BeginProfilerFrame();
+	InitGame(gameState);
+	if (stressScene)
+	{
+		stressParams.seed = gameState->seed;
+		GenerateStressScene(gameState, &stressParams);
+	}
+	EndProfilerFrame();
+	EndFrameMemory();
+
+	InputRecorder recorder = {};
+	if (recordFilename)
+	{
+		BeginInputRecording(&recorder, recordFilename, gameState);
+	}
+
+	uint8* simulationMemory = (uint8*)PlatformAllocateMemory(SIMULATION_FRAME_MEMORY_SIZE);
+	uint8* snapshotsMemory  = (uint8*)PlatformAllocateMemory(RENDER_SNAPSHOTS_MEMORY_SIZE);
+	if (!simulationMemory || !snapshotsMemory)
+	{
+		return 1;
+	}
+
+	RenderSnapshotBuffer snapshots;
+	InitRenderSnapshotBuffer(&snapshots, snapshotsMemory, RENDER_SNAPSHOTS_MEMORY_SIZE);
+
+	SimulationThread sim;
+	sim.gameState     = gameState;
+	sim.snapshots     = &snapshots;
+	sim.frameMemory   = simulationMemory;
+	sim.nbJobThreads  = nbJobThreads;
+	sim.playback      = &playback;
+	sim.replayFixedDt = replayFixedDt;
+	sim.recorder      = &recorder;
+	sim.input         = gameState->inputState;
+	InitInputEventQueue(&sim.events);
+	sim.quit.store(false, std::memory_order_relaxed);
+	sim.done.store(false, std::memory_order_relaxed);
+
+	// NOTE(Charly): Starting a thread hits the heap
+	AllowFrameHeapAllocations();
+	std::thread simulationThread(RunSimulation, &sim);
 
 	using Clock     = std::chrono::high_resolution_clock;
 	using TimePoint = std::chrono::time_point<Clock>;
@@ -226,27 +658,120 @@ int main()
 	TimePoint t0 = Clock::now();
 	TimePoint t1;
 
-	glfwSwapInterval(0);
+	if (pacingMode == FramePacing_Adaptive && !glfwExtensionSupported("GLX_EXT_swap_control_tear") &&
+	    !glfwExtensionSupported("WGL_EXT_swap_control_tear"))
+	{
+		Log(Log_Warning, "Frame pacing: no swap_control_tear, adaptive falls back to vsync");
+		pacingMode = FramePacing_VSync;
+	}
+
+	FramePacer pacer;
+	InitFramePacer(&pacer, pacingMode, frameCap);
+	glfwSwapInterval(GetFramePacingSwapInterval(pacingMode));
 
-	while (!glfwWindowShouldClose(window))
+	if (!replayFilename)
 	{
+		InitPlatformInput(window, &sim.events);
+	}
+	else
+	{
+		glfwSetKeyCallback(window, ReplayKeyCallback);
+	}
+
+	bool32 attachedToJobs = false;
+	while (!glfwWindowShouldClose(window) && !sim.done.load(std::memory_order_acquire))
+	{
+		// NOTE(Charly): Before the input is read, waiting does not delay what the frame shows
+		BeginPacedFrame(&pacer);
+
 		t1        = Clock::now();
 		real32 dt = std::chrono::duration<float, Seconds>(t1 - t0).count();
 		t0        = t1;
 
+		BeginProfilerFrame();
+
 		glfwPollEvents();
+		if (!replayFilename)
+		{
+			PollGamepads();
+		}
 
-		gameState.lastInputState = gameState.inputState;
-		ProcessInputState(window, &gameState.inputState);
+		const RenderSnapshot* snapshot = AcquireRenderSnapshot(&snapshots);
+		if (snapshot)
+		{
+			// NOTE(Charly): The job system is up once the simulation published something, the
+			//               renderer can then generate its commands on the workers too
+			if (!attachedToJobs)
+			{
+				AttachJobThread();
+				attachedToJobs = true;
+			}
 
-		UpdateGame(&gameState, dt);
-		RenderGame(&gameState, dt);
+			RenderGame(gameState, snapshot, dt);
+			SubmitLatencyFrame(&snapshot->jumpLatency);
+		}
 
 		glfwSwapBuffers(window);
+		EndPacedFrame(&pacer);
+		PresentLatencyFrame();
+
+		EndProfilerFrame();
+
+		EndFrameMemory();
 	}
 
+	FramePacingStats pacing;
+	GetFramePacingStats(&pacer, &pacing);
+	Log(Log_Info,
+	    "Frame pacing (%s): present %.3f ms (std dev %.3f, min %.3f, max %.3f), work %.3f ms, "
+	    "sleep %.3f ms, spin %.3f ms",
+	    GetFramePacingModeName(pacingMode),
+	    pacing.meanPresentInterval,
+	    pacing.presentIntervalStdDev,
+	    pacing.minPresentInterval,
+	    pacing.maxPresentInterval,
+	    pacing.meanWork,
+	    pacing.meanSleep,
+	    pacing.meanSpin);
+
+	for (uint32 stage = 0; stage < LatencyStage_Count; ++stage)
+	{
+		const LatencyHistogram* histogram = GetLatencyHistogram((LatencyStage)stage);
+		if (histogram->count > 0)
+		{
+			Log(Log_Info,
+			    "Jump latency to %s: mean %.2f ms, p50 %.1f, p95 %.1f, p99 %.1f, max %.2f (%u presses)",
+			    GetLatencyStageName((LatencyStage)stage),
+			    histogram->total / 1e6 / histogram->count,
+			    GetLatencyPercentile(histogram, 0.5),
+			    GetLatencyPercentile(histogram, 0.95),
+			    GetLatencyPercentile(histogram, 0.99),
+			    histogram->max / 1e6,
+			    histogram->count);
+		}
+	}
+
+	if (latencyFilename)
+	{
+		SaveLatencyHistograms(latencyFilename);
+	}
+
+	DetachJobThread();
+	sim.quit.store(true, std::memory_order_release);
+	simulationThread.join();
+
+	EndTraceCapture();
+	EndRenderStatsCapture();
+
+	EndInputRecording(&recorder);
+	EndInputPlayback(&playback);
+
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
+	PlatformFreeMemory(snapshotsMemory, RENDER_SNAPSHOTS_MEMORY_SIZE);
+	PlatformFreeMemory(simulationMemory, SIMULATION_FRAME_MEMORY_SIZE);
+	PlatformFreeMemory(memory, totalSize);
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,736 @@
+#include "relwarb_defines.h"
+#include "relwarb_debug.h"
+#include "relwarb_input.h"
+#include "relwarb_input_events.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+#include "relwarb_replay.h"
+#include "relwarb_batch.h"
+#include "relwarb_jobs.h"
+#include "relwarb_profiler.h"
+#include "relwarb_trace.h"
+#include "relwarb_stress_scene.h"
+#include "relwarb.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// NOTE(Charly): Simulation only platform layer: no window, no GL. The game is stepped as fast as
+//               possible, one fixed tick per iteration, from a replay file or from scripted
+//               input, and the achieved tick rate is reported. With --worlds, many independent
+//               worlds are stepped on all the cores instead (see relwarb_batch.h).
+//               --job-test hammers the job system, build with RELWARB_TSAN to check it for
+//               data races. --math-test checks the SSE paths of zmath against the scalar
+//               code on random inputs. --input-test feeds short taps through the input event queue
+//               with jittered frame times, like the window does. --profile prints where the last ticks went, --trace writes a
+//               Chrome trace of the run (or of its first --trace-frames ticks).
+//               --stress-scene builds a procedural scene of platforms, bots and particle
+//               systems on top of the base map, to see how the simulation scales.
+
+// NOTE(Charly): The viewport only matters for cursor related input
+global_variable uint32 headlessViewportWidth  = 1440;
+global_variable uint32 headlessViewportHeight = 720;
+
+internal void PrintProfilerReport()
+{
+	for (uint32 threadIdx = 0; threadIdx < GetProfilerThreadCount(); ++threadIdx)
+	{
+		ProfilerReport report;
+		GetProfilerReport(threadIdx, &report);
+
+		printf("%s, last %u frames (min / avg / max ms): %.3f / %.3f / %.3f\n",
+		       report.threadName,
+		       report.nbFrames,
+		       report.frameMin,
+		       report.frameAvg,
+		       report.frameMax);
+		for (uint32 nodeIdx = 0; nodeIdx < report.nbNodes; ++nodeIdx)
+		{
+			const ProfileNode* node = report.nodes + nodeIdx;
+			printf("%*s%-*s x%-5.1f %8.3f %8.3f %8.3f\n",
+			       (int)(2 * node->depth + 2),
+			       "",
+			       (int)(32 - 2 * node->depth),
+			       node->name,
+			       node->calls,
+			       node->min,
+			       node->avg,
+			       node->max);
+		}
+	}
+}
+
+internal int RunBatch(uint32 nbWorlds, uint32 nbThreads, uint32 nbTicks, uint32 seed)
+{
+	WorldBatch batch;
+	if (!InitWorldBatch(&batch, nbWorlds, seed, nbThreads))
+	{
+		return 1;
+	}
+
+	// NOTE(Charly): Loads the worlds, so that only simulation is timed below
+	StepWorldBatch(&batch, 1);
+	printf("%u worlds loaded in %.3f s\n", nbWorlds, batch.elapsed);
+
+	StepWorldBatch(&batch, nbTicks);
+	printf("%u worlds x %u ticks on %u threads in %.3f s: %.0f world-ticks/s, %u steals\n",
+	       nbWorlds,
+	       nbTicks,
+	       batch.nbThreads,
+	       batch.elapsed,
+	       batch.nbWorldTicks / batch.elapsed,
+	       batch.nbSteals);
+
+	// NOTE(Charly): Must not depend on the number of threads
+	uint64 checksum = 0;
+	for (uint32 worldIdx = 0; worldIdx < nbWorlds; ++worldIdx)
+	{
+		checksum = checksum * 31 + batch.worlds[worldIdx].gameState->checksum;
+	}
+	printf("checksum: %016llx\n", (unsigned long long)checksum);
+
+	FreeWorldBatch(&batch);
+
+	return 0;
+}
+
+struct JobTestArray
+{
+	uint32* values;
+	uint32  count;
+};
+
+internal void FillJobTestArray(void* data, uint32 begin, uint32 end)
+{
+	JobTestArray* array = (JobTestArray*)data;
+	for (uint32 valueIdx = begin; valueIdx < end; ++valueIdx)
+	{
+		array->values[valueIdx] = valueIdx * 2 + 1;
+	}
+}
+
+// NOTE(Charly): Each outer element runs its own ParallelFor from inside a job
+internal void FillJobTestRows(void* data, uint32 begin, uint32 end)
+{
+	JobTestArray* rows = (JobTestArray*)data;
+	for (uint32 rowIdx = begin; rowIdx < end; ++rowIdx)
+	{
+		ParallelFor(rows[rowIdx].count, 64, FillJobTestArray, rows + rowIdx);
+	}
+}
+
+// NOTE(Charly): Results pushed in the frame arena of the worker must survive until the end of
+//               the frame
+internal void PushJobTestScratch(void* data, uint32 begin, uint32 end)
+{
+	uint32** scratch = (uint32**)data;
+	for (uint32 rowIdx = begin; rowIdx < end; ++rowIdx)
+	{
+		uint32* values = PushArray(GetFrameArena(), 256, uint32);
+		for (uint32 valueIdx = 0; valueIdx < 256; ++valueIdx)
+		{
+			values[valueIdx] = rowIdx ^ valueIdx;
+		}
+		scratch[rowIdx] = values;
+	}
+}
+
+internal void CountJobTestJob(void* data, uint32 begin, uint32 end)
+{
+	std::atomic<uint32>* nbRuns = (std::atomic<uint32>*)data;
+	nbRuns->fetch_add(end - begin, std::memory_order_relaxed);
+}
+
+// NOTE(Charly): Stands for the render thread: its own frame loop, attached to the pool
+struct AttachedJobTest
+{
+	uint32              nbIterations;
+	std::atomic<uint32> nbFails;
+};
+
+internal void RunAttachedJobTest(AttachedJobTest* test)
+{
+	size_t frameMemorySize = Megabytes(4);
+	uint8* frameMemory     = (uint8*)PlatformAllocateMemory(frameMemorySize);
+	InitializeFrameMemory(frameMemory, frameMemorySize);
+
+	if (!AttachJobThread())
+	{
+		test->nbFails.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const uint32 nbValues = 1 << 14;
+	for (uint32 iteration = 0; iteration < test->nbIterations; ++iteration)
+	{
+		JobTestArray array = {PushArray(GetFrameArena(), nbValues, uint32), nbValues};
+		ParallelFor(nbValues, 256, FillJobTestArray, &array);
+		for (uint32 valueIdx = 0; valueIdx < nbValues; ++valueIdx)
+		{
+			if (array.values[valueIdx] != valueIdx * 2 + 1)
+			{
+				test->nbFails.fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+		}
+
+		EndFrameMemory();
+	}
+
+	DetachJobThread();
+	PlatformFreeMemory(frameMemory, frameMemorySize);
+}
+
+internal int RunJobTest(uint32 nbThreads, uint32 nbIterations)
+{
+	InitJobSystem(nbThreads);
+
+	// NOTE(Charly): The frame memory of the main thread, workers have their own
+	size_t frameMemorySize = Megabytes(16);
+	uint8* frameMemory     = (uint8*)PlatformAllocateMemory(frameMemorySize);
+	InitializeFrameMemory(frameMemory, frameMemorySize);
+
+	const uint32 nbValues = 1 << 18;
+	const uint32 nbRows   = 64;
+	const uint32 nbJobs   = 3000; // NOTE(Charly): More than a deque holds
+
+	AttachedJobTest attachedTest;
+	attachedTest.nbIterations = nbIterations;
+	attachedTest.nbFails.store(0, std::memory_order_relaxed);
+	AllowFrameHeapAllocations();
+	std::thread attachedThread(RunAttachedJobTest, &attachedTest);
+
+	uint32* values  = (uint32*)PlatformAllocateMemory(nbValues * sizeof(uint32));
+	Job*    jobs    = (Job*)PlatformAllocateMemory(nbJobs * sizeof(Job));
+	uint32  nbFails = 0;
+	for (uint32 iteration = 0; iteration < nbIterations; ++iteration)
+	{
+		memset(values, 0, nbValues * sizeof(uint32));
+		JobTestArray array = {values, nbValues};
+		ParallelFor(nbValues, 1024, FillJobTestArray, &array);
+
+		JobTestArray rows[nbRows];
+		for (uint32 rowIdx = 0; rowIdx < nbRows; ++rowIdx)
+		{
+			rows[rowIdx].values = values + rowIdx * (nbValues / nbRows);
+			rows[rowIdx].count  = nbValues / nbRows;
+		}
+		ParallelFor(nbRows, 1, FillJobTestRows, rows);
+
+		for (uint32 valueIdx = 0; valueIdx < nbValues; ++valueIdx)
+		{
+			uint32 expected = (valueIdx % (nbValues / nbRows)) * 2 + 1;
+			if (values[valueIdx] != expected)
+			{
+				++nbFails;
+				break;
+			}
+		}
+
+		std::atomic<uint32> nbRuns(0);
+		for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+		{
+			jobs[jobIdx].function = CountJobTestJob;
+			jobs[jobIdx].data     = &nbRuns;
+			jobs[jobIdx].begin    = jobIdx;
+			jobs[jobIdx].end      = jobIdx + 1;
+		}
+		JobCounter counter = {};
+		RunJobs(jobs, nbJobs, &counter);
+		WaitForCounter(&counter);
+		if (nbRuns.load() != nbJobs)
+		{
+			++nbFails;
+		}
+
+		uint32* scratch[nbRows];
+		ParallelFor(nbRows, 1, PushJobTestScratch, scratch);
+		for (uint32 rowIdx = 0; rowIdx < nbRows; ++rowIdx)
+		{
+			if (scratch[rowIdx][255] != (rowIdx ^ 255))
+			{
+				++nbFails;
+				break;
+			}
+		}
+
+		EndFrameMemory();
+		EndJobsFrame();
+	}
+
+	attachedThread.join();
+	nbFails += attachedTest.nbFails.load(std::memory_order_relaxed);
+
+	printf("job test: %u iterations on %u workers, %u failures\n",
+	       nbIterations,
+	       GetJobWorkerCount(),
+	       nbFails);
+
+	PlatformFreeMemory(jobs, nbJobs * sizeof(Job));
+	PlatformFreeMemory(values, nbValues * sizeof(uint32));
+	ShutdownJobSystem();
+	PlatformFreeMemory(frameMemory, frameMemorySize);
+
+	return nbFails ? 1 : 0;
+}
+
+// NOTE(Charly): The scalar formulas are written out here so that both run in the same build.
+//               Everything but InvSqrt must give the same bits, InvSqrt is an estimate refined
+//               by a Newton step. Without SSE, the scalar code is checked against itself.
+#define MATH_TEST_INVSQRT_TOLERANCE 3e-7
+
+internal void ExpectSameBits(const char* name, const real32* value, const real32* expected, uint32 count, uint32* nbFails)
+{
+	if (memcmp(value, expected, count * sizeof(real32)) != 0)
+	{
+		Log(Log_Error, "Math test: %s differs from the scalar code", name);
+		++*nbFails;
+	}
+}
+
+internal int RunMathTest(uint32 seed, uint32 nbSamples)
+{
+	z::RandomSeries series          = z::SeedRandomSeries(seed);
+	uint32          nbFails         = 0;
+	real64          maxInvSqrtError = 0.0;
+	for (uint32 sampleIdx = 0; sampleIdx < nbSamples; ++sampleIdx)
+	{
+		real32 r[32];
+		for (uint32 idx = 0; idx < 32; ++idx)
+		{
+			r[idx] = z::GenerateRandBetween(&series, -100.f, 100.f);
+		}
+
+		z::vec4 a = z::Vec4(r[0], r[1], r[2], r[3]);
+		z::vec4 b = z::Vec4(r[4], r[5], r[6], r[7]);
+		real32  t = r[8] / 100.f;
+
+		z::vec4 sum      = z::Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+		z::vec4 diff     = z::Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w);
+		z::vec4 prod     = z::Vec4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w);
+		z::vec4 quot     = z::Vec4(a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w);
+		z::vec4 scaled   = z::Vec4(a.x * t, a.y * t, a.z * t, a.w * t);
+		z::vec4 divided  = z::Vec4(a.x / t, a.y / t, a.z / t, a.w / t);
+		z::vec4 inverted = z::Vec4(t / a.x, t / a.y, t / a.z, t / a.w);
+		real32  invT     = 1.f / t;
+
+		ExpectSameBits("vec4 + vec4", (a + b).data, sum.data, 4, &nbFails);
+		ExpectSameBits("vec4 - vec4", (a - b).data, diff.data, 4, &nbFails);
+		ExpectSameBits("vec4 * vec4", (a * b).data, prod.data, 4, &nbFails);
+		ExpectSameBits("vec4 / vec4", (a / b).data, quot.data, 4, &nbFails);
+		ExpectSameBits("vec4 * real", (a * t).data, scaled.data, 4, &nbFails);
+		ExpectSameBits("real * vec4", (t * a).data, scaled.data, 4, &nbFails);
+		ExpectSameBits("vec4 / real", (a / t).data, z::Vec4(a.x * invT, a.y * invT, a.z * invT, a.w * invT).data, 4, &nbFails);
+		ExpectSameBits("real / vec4", (t / a).data, inverted.data, 4, &nbFails);
+		ExpectSameBits("-vec4", (-a).data, z::Vec4(-a.x, -a.y, -a.z, -a.w).data, 4, &nbFails);
+		ExpectSameBits("Lerp vec4",
+		               z::Lerp(a, b, t).data,
+		               z::Vec4(t * b.x + (1 - t) * a.x,
+		                       t * b.y + (1 - t) * a.y,
+		                       t * b.z + (1 - t) * a.z,
+		                       t * b.w + (1 - t) * a.w)
+		                   .data,
+		               4,
+		               &nbFails);
+
+		z::vec4 c = a;
+		c += b;
+		ExpectSameBits("vec4 += vec4", c.data, sum.data, 4, &nbFails);
+		c = a;
+		c -= b;
+		ExpectSameBits("vec4 -= vec4", c.data, diff.data, 4, &nbFails);
+		c = a;
+		c *= b;
+		ExpectSameBits("vec4 *= vec4", c.data, prod.data, 4, &nbFails);
+		c = a;
+		c /= b;
+		ExpectSameBits("vec4 /= vec4", c.data, quot.data, 4, &nbFails);
+		c = a;
+		c *= t;
+		ExpectSameBits("vec4 *= real", c.data, scaled.data, 4, &nbFails);
+		c = a;
+		c /= t;
+		ExpectSameBits("vec4 /= real", c.data, divided.data, 4, &nbFails);
+
+		z::mat3 m(z::Vec3(r[9], r[10], r[11]), z::Vec3(r[12], r[13], r[14]), z::Vec3(r[15], r[16], r[17]));
+		z::mat3 n(z::Vec3(r[18], r[19], r[20]), z::Vec3(r[21], r[22], r[23]), z::Vec3(r[24], r[25], r[26]));
+		z::vec3 v = z::Vec3(r[27], r[28], r[29]);
+		z::vec2 p = z::Vec2(r[30], r[31]);
+
+		z::mat3 mn = m * n;
+		for (uint32 row = 0; row < 3; ++row)
+		{
+			real32 expected[3];
+			for (uint32 col = 0; col < 3; ++col)
+			{
+				expected[col] = m[row][0] * n[0][col] + m[row][1] * n[1][col] + m[row][2] * n[2][col];
+			}
+			ExpectSameBits("mat3 * mat3", mn[row].data, expected, 3, &nbFails);
+		}
+
+		real32 mv[3];
+		for (uint32 row = 0; row < 3; ++row)
+		{
+			mv[row] = m[row][0] * v.x + m[row][1] * v.y + m[row][2] * v.z;
+		}
+		ExpectSameBits("mat3 * vec3", (m * v).data, mv, 3, &nbFails);
+
+		real32 mp[3];
+		for (uint32 row = 0; row < 3; ++row)
+		{
+			mp[row] = m[row][0] * p.x + m[row][1] * p.y + m[row][2] * 1.f;
+		}
+		ExpectSameBits("mat3 * vec2", (m * p).data, z::Vec2(mp[0] / mp[2], mp[1] / mp[2]).data, 2, &nbFails);
+
+		real32 x     = z::Abs(r[0]) * 1000.f + 1e-3f;
+		real64 error = fabs(z::InvSqrt(x) * sqrt((real64)x) - 1.0);
+		if (error > maxInvSqrtError)
+		{
+			maxInvSqrtError = error;
+		}
+	}
+
+	if (maxInvSqrtError > MATH_TEST_INVSQRT_TOLERANCE)
+	{
+		Log(Log_Error, "Math test: InvSqrt is off by %.2g (relative)", maxInvSqrtError);
+		++nbFails;
+	}
+
+	printf("math test: %u samples, InvSqrt max relative error %.2g, %u failures\n",
+	       nbSamples,
+	       maxInvSqrtError,
+	       nbFails);
+
+	return nbFails ? 1 : 0;
+}
+
+// NOTE(Charly): Frames last between half and one and a half tick, so some run no tick and some
+//               run two. Every tap is shorter than a tick and must still be seen exactly once,
+//               and its press time must reach the jump latency.
+internal int RunInputTest(GameState* gameState, uint32 nbTaps)
+{
+	InputEventQueue* queue = (InputEventQueue*)PlatformAllocateMemory(sizeof(InputEventQueue));
+	if (!queue)
+	{
+		return 1;
+	}
+	InitInputEventQueue(queue);
+
+	z::RandomSeries series = z::SeedRandomSeries(gameState->seed ^ 0x7a95u);
+	InputState      input  = gameState->inputState;
+	int64           tickNs = (int64)(gameState->fixedDt * 1e9);
+	int64           time   = tickNs; // NOTE(Charly): A press time of 0 means none
+
+	uint32 nbRisingEdges = 0;
+	uint32 nbTimedTaps   = 0;
+	uint32 nbEmptyFrames = 0;
+	for (uint32 tapIdx = 0; tapIdx < nbTaps; ++tapIdx)
+	{
+		InputEvent event = {};
+		event.type       = InputEvent_Key;
+		event.code       = Key_Up;
+		event.time       = time + (int64)(z::GenerateRandBetween(&series) * tickNs);
+		event.pressed    = true;
+		int64 pressTime  = event.time;
+		PushInputEvent(queue, event);
+		event.time += tickNs / 16;
+		event.pressed = false;
+		PushInputEvent(queue, event);
+
+		// NOTE(Charly): Enough frames for the release to be applied too
+		for (uint32 frame = 0; frame < 8; ++frame)
+		{
+			real32 dt = gameState->fixedDt * z::GenerateRandBetween(&series, 0.5f, 1.5f);
+			time += (int64)(dt * 1e9);
+
+			if (WillStepGame(gameState, dt))
+			{
+				ApplyInputEvents(queue, &input, time, &gameState->inputPressTimes);
+			}
+			else
+			{
+				++nbEmptyFrames;
+			}
+
+			uint32 tick       = gameState->tick;
+			bool32 wasPressed = gameState->inputState.keyboard.keys[Key_Up];
+			StepGame(gameState, &input, dt);
+			if (gameState->tick != tick && !wasPressed && input.keyboard.keys[Key_Up])
+			{
+				++nbRisingEdges;
+			}
+
+			EndFrameMemory();
+			EndJobsFrame();
+		}
+
+		if (gameState->jumpLatency.input == pressTime)
+		{
+			++nbTimedTaps;
+		}
+	}
+
+	uint32 nbFails = (nbRisingEdges != nbTaps ? 1 : 0) + (nbTimedTaps != nbTaps ? 1 : 0);
+	printf("input test: %u taps, %u rising edges, %u timed, %u frames without tick, %u failures\n",
+	       nbTaps,
+	       nbRisingEdges,
+	       nbTimedTaps,
+	       nbEmptyFrames,
+	       nbFails);
+
+	PlatformFreeMemory(queue, sizeof(InputEventQueue));
+
+	return nbFails ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	uint32      nbTicks        = 100000;
+	uint32      seed           = 0;
+	const char* replayFilename = nullptr;
+	bool32      replayFixedDt  = false;
+	uint32      nbWorlds       = 0;
+	uint32      nbThreads      = 0;
+	bool32      jobTest        = false;
+	bool32      mathTest       = false;
+	bool32      inputTest      = false;
+	bool32      profile        = false;
+	const char* traceFilename  = nullptr;
+	uint32      nbTraceFrames  = 0;
+	bool32      stressScene    = false;
+
+	StressSceneParams stressParams = {};
+	stressParams.botBehavior       = BotBehavior_Random;
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		if (strcmp(argv[argIdx], "--ticks") == 0 && argIdx + 1 < argc)
+		{
+			nbTicks = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--seed") == 0 && argIdx + 1 < argc)
+		{
+			seed = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--replay") == 0 && argIdx + 1 < argc)
+		{
+			replayFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--replay-fixed-dt") == 0)
+		{
+			replayFixedDt = true;
+		}
+		else if (strcmp(argv[argIdx], "--worlds") == 0 && argIdx + 1 < argc)
+		{
+			nbWorlds = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--threads") == 0 && argIdx + 1 < argc)
+		{
+			nbThreads = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--job-test") == 0)
+		{
+			jobTest = true;
+		}
+		else if (strcmp(argv[argIdx], "--math-test") == 0)
+		{
+			mathTest = true;
+		}
+		else if (strcmp(argv[argIdx], "--input-test") == 0)
+		{
+			inputTest = true;
+		}
+		else if (strcmp(argv[argIdx], "--profile") == 0)
+		{
+			profile = true;
+		}
+		else if (strcmp(argv[argIdx], "--trace") == 0 && argIdx + 1 < argc)
+		{
+			traceFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--trace-frames") == 0 && argIdx + 1 < argc)
+		{
+			nbTraceFrames = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--stress-scene") == 0 && argIdx + 1 < argc &&
+		         ParseStressSceneParams(argv[argIdx + 1], &stressParams))
+		{
+			stressScene = true;
+			++argIdx;
+		}
+		else if (strcmp(argv[argIdx], "--stress-patrol") == 0)
+		{
+			stressParams.botBehavior = BotBehavior_Patrol;
+		}
+		else
+		{
+			fprintf(stderr,
+			        "usage: %s [--threads N] [--ticks N] [--seed N] [--replay file [--replay-fixed-dt]] [--profile]\n"
+			        "       %s [--ticks N] [--seed N] [--trace file [--trace-frames N]]\n"
+			        "       %s [--ticks N] [--seed N] --stress-scene platforms,bots,systems [--stress-patrol]\n"
+			        "       %s --worlds N [--threads N] [--ticks N] [--seed N]\n"
+			        "       %s --job-test [--threads N] [--ticks N]\n"
+			        "       %s --math-test [--ticks N] [--seed N]\n"
+			        "       %s --input-test [--ticks N] [--seed N]\n",
+			        argv[0],
+			        argv[0],
+			        argv[0],
+			        argv[0],
+			        argv[0],
+			        argv[0],
+			        argv[0]);
+			return 1;
+		}
+	}
+
+	if (jobTest)
+	{
+		return RunJobTest(nbThreads, nbTicks < 1000 ? nbTicks : 1000);
+	}
+
+	if (mathTest)
+	{
+		return RunMathTest(seed, nbTicks);
+	}
+
+	if (nbWorlds > 0)
+	{
+		return RunBatch(nbWorlds, nbThreads, nbTicks, seed);
+	}
+
+
+	GameMemory gameMemory           = {};
+	gameMemory.permanentStorageSize = Megabytes(256);
+	gameMemory.transientStorageSize = Megabytes(128);
+
+	size_t totalSize = gameMemory.permanentStorageSize + gameMemory.transientStorageSize;
+	uint8* memory    = (uint8*)PlatformAllocateMemory(totalSize);
+	if (!memory)
+	{
+		return 1;
+	}
+	gameMemory.permanentStorage = memory;
+	gameMemory.transientStorage = memory + gameMemory.permanentStorageSize;
+
+	GameState* gameState     = InitGameMemory(&gameMemory);
+	gameState->viewportSize  = z::Vec2(headlessViewportWidth, headlessViewportHeight);
+	gameState->deterministic = true;
+	gameState->seed          = seed;
+
+	InputPlayback playback = {};
+	if (replayFilename)
+	{
+		if (!BeginInputPlayback(&playback, replayFilename, gameState))
+		{
+			return 1;
+		}
+
+		if (replayFixedDt)
+		{
+			gameState->deterministic = true;
+		}
+	}
+
+	// NOTE(Charly): A single world uses the cores through the job system
+	InitJobSystem(nbThreads);
+
+	if (profile || traceFilename)
+	{
+		RegisterProfilerThread("Simulation");
+	}
+
+	if (traceFilename)
+	{
+		BeginTraceCapture(traceFilename, nbTraceFrames);
+	}
+
+	InitGame(gameState);
+	if (stressScene)
+	{
+		stressParams.seed = gameState->seed;
+		GenerateStressScene(gameState, &stressParams);
+		printf("stress scene: %u entities, %u players\n", gameState->nbEntities, gameState->nbPlayers);
+	}
+	EndFrameMemory();
+
+	if (inputTest)
+	{
+		// NOTE(Charly): --ticks is the number of taps
+		int result = RunInputTest(gameState, nbTicks);
+
+		EndTraceCapture();
+		ShutdownJobSystem();
+		PlatformFreeMemory(memory, totalSize);
+
+		return result;
+	}
+
+	z::RandomSeries script = z::SeedRandomSeries(gameState->seed ^ 0x5c71b07u);
+
+	using Clock   = std::chrono::steady_clock;
+	using Seconds = std::chrono::duration<real64>;
+
+	uint32            firstTick     = gameState->tick;
+	real64            simulatedTime = 0.0;
+	Clock::time_point start         = Clock::now();
+
+	for (uint32 frame = 0; replayFilename || frame < nbTicks; ++frame)
+	{
+		InputState input = gameState->inputState;
+		real32     dt    = gameState->fixedDt;
+		if (replayFilename)
+		{
+			real32 recordedDt;
+			if (!PlaybackInputFrame(&playback, &input, &recordedDt))
+			{
+				break;
+			}
+
+			if (!replayFixedDt)
+			{
+				dt = recordedDt;
+			}
+		}
+		else
+		{
+			ScriptInput(&script, gameState->tick, gameState->viewportSize, &input);
+		}
+
+		BeginProfilerFrame();
+		StepGame(gameState, &input, dt);
+		EndProfilerFrame();
+		simulatedTime += dt;
+
+		EndFrameMemory();
+		EndJobsFrame();
+	}
+
+	real64 elapsed = Seconds(Clock::now() - start).count();
+	uint32 ticks   = gameState->tick - firstTick;
+
+	printf("%u ticks in %.3f s: %.0f ticks/s, %.2f us/tick, %.1fx real time\n",
+	       ticks,
+	       elapsed,
+	       ticks / elapsed,
+	       elapsed * 1e6 / (ticks ? ticks : 1),
+	       simulatedTime / elapsed);
+	if (gameState->deterministic)
+	{
+		printf("checksum: %016llx\n", (unsigned long long)gameState->checksum);
+	}
+
+	EndTraceCapture();
+
+	if (profile)
+	{
+		PrintProfilerReport();
+	}
+
+	EndInputPlayback(&playback);
+	ShutdownJobSystem();
+	PlatformFreeMemory(memory, totalSize);
+
+	return 0;
+}
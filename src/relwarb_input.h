@@ -130,6 +130,14 @@ struct InputState
 	GamepadState  gamepads[MAX_GAMEPADS];
 };
 
+// NOTE(Charly): When each button was pressed during a step (GetInputEventTime, ns), 0 if it was not
+struct InputPressTimes
+{
+	int64 keys[Key_Count];
+	int64 mouseButtons[MouseButton_Count];
+	int64 gamepadButtons[MAX_GAMEPADS][GamepadButton_Count];
+};
+
 struct GameState;
 bool32 IsKeyPressed(GameState* state, int32 key);
 bool32 IsKeyRisingEdge(GameState* state, int32 key);
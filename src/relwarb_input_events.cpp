@@ -0,0 +1,262 @@
+#include "relwarb_input_events.h"
+
+#include <chrono>
+#include <string.h>
+
+#include "relwarb_debug.h"
+
+// NOTE(Charly): Buttons of every device, to know which ones already changed during a step
+#define KEYS_OFFSET 0
+#define MOUSE_BUTTONS_OFFSET (KEYS_OFFSET + Key_Count)
+#define GAMEPAD_BUTTONS_OFFSET (MOUSE_BUTTONS_OFFSET + MouseButton_Count)
+#define NB_INPUT_BUTTONS (GAMEPAD_BUTTONS_OFFSET + MAX_GAMEPADS * GamepadButton_Count)
+
+int64 GetInputEventTime()
+{
+	int64 result = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                   std::chrono::steady_clock::now().time_since_epoch())
+	                   .count();
+	return result;
+}
+
+void InitInputEventQueue(InputEventQueue* queue)
+{
+	queue->writeIndex.store(0, std::memory_order_relaxed);
+	queue->readIndex.store(0, std::memory_order_relaxed);
+	queue->nbDropped = 0;
+}
+
+// NOTE(Charly): Index in the changed flags, -1 for events that are not buttons
+internal int32 GetInputButtonIndex(const InputEvent* event)
+{
+	int32 result = -1;
+	switch (event->type)
+	{
+		case InputEvent_Key:
+		{
+			result = KEYS_OFFSET + event->code;
+		} break;
+
+		case InputEvent_MouseButton:
+		{
+			result = MOUSE_BUTTONS_OFFSET + event->code;
+		} break;
+
+		case InputEvent_GamepadButton:
+		{
+			result = GAMEPAD_BUTTONS_OFFSET + event->gamepad * GamepadButton_Count + event->code;
+		} break;
+	}
+
+	return result;
+}
+
+internal bool32 IsValidInputEvent(const InputEvent* event)
+{
+	bool32 result = false;
+	switch (event->type)
+	{
+		case InputEvent_Key:
+		{
+			result = event->code >= 0 && event->code < Key_Count;
+		} break;
+
+		case InputEvent_MouseButton:
+		{
+			result = event->code >= 0 && event->code < MouseButton_Count;
+		} break;
+
+		case InputEvent_Cursor:
+		{
+			result = true;
+		} break;
+
+		case InputEvent_GamepadButton:
+		{
+			result = event->gamepad < MAX_GAMEPADS && event->code >= 0 && event->code < GamepadButton_Count;
+		} break;
+
+		case InputEvent_GamepadAxis:
+		{
+			result = event->gamepad < MAX_GAMEPADS && event->code >= 0 && event->code <= GamepadAxis_Triggers;
+		} break;
+
+		case InputEvent_GamepadDisconnected:
+		{
+			result = event->gamepad < MAX_GAMEPADS;
+		} break;
+	}
+
+	return result;
+}
+
+// NOTE(Charly): Events are checked here, the simulation trusts them
+bool32 PushInputEvent(InputEventQueue* queue, const InputEvent& event)
+{
+	if (!IsValidInputEvent(&event))
+	{
+		Assert(!"Invalid input event");
+		return false;
+	}
+
+	uint32 writeIndex = queue->writeIndex.load(std::memory_order_relaxed);
+	uint32 readIndex  = queue->readIndex.load(std::memory_order_acquire);
+	if (writeIndex - readIndex >= INPUT_EVENT_QUEUE_SIZE)
+	{
+		// NOTE(Charly): Only the first one of a series is reported
+		if (queue->nbDropped++ == 0)
+		{
+			Log(Log_Warning, "Input event queue full, dropping events");
+		}
+		return false;
+	}
+	queue->nbDropped = 0;
+
+	queue->events[writeIndex & INPUT_EVENT_QUEUE_MASK] = event;
+	queue->writeIndex.store(writeIndex + 1, std::memory_order_release);
+
+	return true;
+}
+
+internal bool32* GetInputButton(InputState* state, const InputEvent* event)
+{
+	bool32* result = nullptr;
+	switch (event->type)
+	{
+		case InputEvent_Key:
+		{
+			result = &state->keyboard.keys[event->code];
+		} break;
+
+		case InputEvent_MouseButton:
+		{
+			result = &state->mouse.buttons[event->code];
+		} break;
+
+		case InputEvent_GamepadButton:
+		{
+			result = &state->gamepads[event->gamepad].buttons[event->code];
+		} break;
+	}
+
+	return result;
+}
+
+internal int64* GetInputPressTime(InputPressTimes* pressTimes, const InputEvent* event)
+{
+	int64* result = nullptr;
+	switch (event->type)
+	{
+		case InputEvent_Key:
+		{
+			result = &pressTimes->keys[event->code];
+		} break;
+
+		case InputEvent_MouseButton:
+		{
+			result = &pressTimes->mouseButtons[event->code];
+		} break;
+
+		case InputEvent_GamepadButton:
+		{
+			result = &pressTimes->gamepadButtons[event->gamepad][event->code];
+		} break;
+	}
+
+	return result;
+}
+
+internal void ApplyInputEvent(const InputEvent* event, InputState* state)
+{
+	switch (event->type)
+	{
+		case InputEvent_Key:
+		case InputEvent_MouseButton:
+		case InputEvent_GamepadButton:
+		{
+			*GetInputButton(state, event) = event->pressed;
+		} break;
+
+		case InputEvent_Cursor:
+		{
+			state->mouse.cursor = z::Vec2(event->values[0], event->values[1]);
+		} break;
+
+		case InputEvent_GamepadAxis:
+		{
+			GamepadState* gamepad = state->gamepads + event->gamepad;
+			z::vec2       value   = z::Vec2(event->values[0], event->values[1]);
+			switch (event->code)
+			{
+				case GamepadAxis_LeftThumbStick:
+				{
+					gamepad->leftThumbStick = value;
+				} break;
+
+				case GamepadAxis_RightThumbStick:
+				{
+					gamepad->rightThumbStick = value;
+				} break;
+
+				case GamepadAxis_Triggers:
+				{
+					gamepad->leftTrigger  = value.x;
+					gamepad->rightTrigger = value.y;
+				} break;
+			}
+		} break;
+
+		case InputEvent_GamepadDisconnected:
+		{
+			state->gamepads[event->gamepad] = {};
+		} break;
+	}
+}
+
+uint32 ApplyInputEvents(InputEventQueue* queue, InputState* state, int64 time, InputPressTimes* pressTimes)
+{
+	if (pressTimes)
+	{
+		*pressTimes = {};
+	}
+
+	uint8 changed[NB_INPUT_BUTTONS];
+	memset(changed, 0, sizeof(changed));
+
+	uint32 result     = 0;
+	uint32 readIndex  = queue->readIndex.load(std::memory_order_relaxed);
+	uint32 writeIndex = queue->writeIndex.load(std::memory_order_acquire);
+	while (readIndex != writeIndex)
+	{
+		const InputEvent* event = &queue->events[readIndex & INPUT_EVENT_QUEUE_MASK];
+		if (event->time > time)
+		{
+			break;
+		}
+
+		int32 buttonIdx = GetInputButtonIndex(event);
+		if (buttonIdx >= 0 && *GetInputButton(state, event) != event->pressed)
+		{
+			// NOTE(Charly): Everything after it waits too, the events stay in order
+			if (changed[buttonIdx])
+			{
+				break;
+			}
+			changed[buttonIdx] = true;
+
+			// NOTE(Charly): A button is pressed at most once per step
+			if (event->pressed && pressTimes)
+			{
+				*GetInputPressTime(pressTimes, event) = event->time;
+			}
+		}
+
+		ApplyInputEvent(event, state);
+
+		++readIndex;
+		++result;
+	}
+	queue->readIndex.store(readIndex, std::memory_order_release);
+
+	return result;
+}
@@ -0,0 +1,79 @@
+#ifndef RELWARB_INPUT_EVENTS_H
+#define RELWARB_INPUT_EVENTS_H
+
+#include <atomic>
+
+#include "relwarb_defines.h"
+#include "relwarb_input.h"
+
+// NOTE(Charly): The platform layer pushes what happened to the devices, with the time it
+//               happened, and the simulation derives its InputState from the events of the
+//               step it simulates. One thread pushes (the one polling the window), one thread
+//               applies.
+//
+//               A button changes at most once per step: a press and release shorter than a
+//               step are applied on two consecutive steps, so the press is seen (rising edge
+//               included) for one tick instead of being lost.
+enum InputEventType
+{
+	InputEvent_Key,
+	InputEvent_MouseButton,
+	InputEvent_Cursor,
+	InputEvent_GamepadButton,
+	InputEvent_GamepadAxis,
+	InputEvent_GamepadDisconnected,
+};
+
+enum GamepadAxis
+{
+	GamepadAxis_LeftThumbStick,
+	GamepadAxis_RightThumbStick,
+	GamepadAxis_Triggers, // NOTE(Charly): Left then right
+};
+
+struct InputEvent
+{
+	int64 time; // NOTE(Charly): GetInputEventTime
+
+	uint8 type;
+	uint8 gamepad;
+	int16 code; // NOTE(Charly): Key, MouseButton, GamepadButton or GamepadAxis
+
+	// NOTE(Charly): Buttons use pressed, the cursor and the axes the values
+	union
+	{
+		bool32 pressed;
+		real32 values[2];
+	};
+};
+
+// NOTE(Charly): Must be a power of two. A full queue drops the new events, a step of input is
+//               a few dozens of them at most.
+#define INPUT_EVENT_QUEUE_SIZE 4096
+#define INPUT_EVENT_QUEUE_MASK (INPUT_EVENT_QUEUE_SIZE - 1)
+
+struct InputEventQueue
+{
+	InputEvent events[INPUT_EVENT_QUEUE_SIZE];
+
+	alignas(64) std::atomic<uint32> writeIndex;
+	alignas(64) std::atomic<uint32> readIndex;
+
+	uint32 nbDropped; // NOTE(Charly): Written by the pushing thread only
+};
+
+// NOTE(Charly): Steady clock, in ns
+int64 GetInputEventTime();
+
+void   InitInputEventQueue(InputEventQueue* queue);
+bool32 PushInputEvent(InputEventQueue* queue, const InputEvent& event);
+
+// NOTE(Charly): Applies the events that happened up to time to state, and returns how many.
+//               Those that would change a button a second time are left for the next call.
+//               pressTimes gets the time each button was pressed at, 0 for the others.
+uint32 ApplyInputEvents(InputEventQueue* queue,
+                        InputState*      state,
+                        int64            time,
+                        InputPressTimes* pressTimes = nullptr);
+
+#endif // RELWARB_INPUT_EVENTS_H
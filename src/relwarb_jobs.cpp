@@ -0,0 +1,452 @@
+#include "relwarb_jobs.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "relwarb_debug.h"
+#include "relwarb_math.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define CpuRelax() _mm_pause()
+#else
+#define CpuRelax() std::this_thread::yield()
+#endif
+
+// NOTE(Charly): Must be a power of two. A full deque is not an error, RunJobs runs the job inline.
+#define JOB_DEQUE_SIZE 1024
+#define JOB_DEQUE_MASK (JOB_DEQUE_SIZE - 1)
+
+#define JOB_WORKER_MEMORY_SIZE Megabytes(8)
+#define MAX_JOB_WORKERS 64
+#define MAX_PARALLEL_FOR_JOBS 64
+#define MAX_ATTACHED_JOB_THREADS 4
+
+// NOTE(Charly): Spins before going to sleep when there is nothing to steal
+#define JOB_IDLE_SPINS 256
+
+#define NOT_A_JOB_WORKER 0xFFFFFFFF
+
+// NOTE(Charly): Chase-Lev deque. Only the owner pushes and pops at the bottom, anyone can steal
+//               at the top. Every store to bottom is a release, thieves acquire it and see the
+//               jobs pushed before. The owner taking from the bottom and a thief reading it must
+//               agree on who gets the last job: those accesses are sequentially consistent
+//               operations rather than fences, the thread sanitizer does not understand fences.
+struct JobDeque
+{
+	std::atomic<int64> top;
+	uint8              padding0[64 - sizeof(std::atomic<int64>)];
+	std::atomic<int64> bottom;
+	uint8              padding1[64 - sizeof(std::atomic<int64>)];
+
+	std::atomic<Job*> jobs[JOB_DEQUE_SIZE];
+};
+
+struct JobSystem
+{
+	uint32    nbWorkers;
+	uint32    nbDeques; // NOTE(Charly): The workers' first, then one per attachable thread
+	JobDeque* deques;
+	uint8*    workerMemory;
+
+	std::vector<std::thread> threads;
+
+	// NOTE(Charly): Jobs pushed but not picked up yet, sleeping workers wait for it to be non zero
+	std::atomic<int32>      nbQueuedJobs;
+	std::atomic<int32>      nbSleepingWorkers;
+	std::atomic<bool32>     shutdown;
+	std::mutex              sleepMutex;
+	std::condition_variable wakeUp;
+
+	std::atomic<uint32> frameIndex;
+
+	std::atomic<bool32> attached[MAX_ATTACHED_JOB_THREADS];
+};
+
+global_variable JobSystem g_jobs;
+
+thread_local uint32 t_workerIdx = NOT_A_JOB_WORKER;
+// NOTE(Charly): Slot of an attached thread, the worker index moves if the system is restarted
+thread_local uint32 t_attachedSlot = NOT_A_JOB_WORKER;
+
+internal bool32 PushJob(JobDeque* deque, Job* job)
+{
+	int64 bottom = deque->bottom.load(std::memory_order_relaxed);
+	int64 top    = deque->top.load(std::memory_order_acquire);
+	if (bottom - top >= JOB_DEQUE_SIZE)
+	{
+		return false;
+	}
+
+	deque->jobs[bottom & JOB_DEQUE_MASK].store(job, std::memory_order_relaxed);
+	deque->bottom.store(bottom + 1, std::memory_order_release);
+
+	return true;
+}
+
+internal Job* PopJob(JobDeque* deque)
+{
+	int64 bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+	deque->bottom.store(bottom, std::memory_order_seq_cst);
+	int64 top = deque->top.load(std::memory_order_seq_cst);
+
+	Job* result = nullptr;
+	if (top <= bottom)
+	{
+		result = deque->jobs[bottom & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// NOTE(Charly): Last job, race the thieves for it
+			if (!deque->top.compare_exchange_strong(
+			        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				result = nullptr;
+			}
+			deque->bottom.store(bottom + 1, std::memory_order_release);
+		}
+	}
+	else
+	{
+		deque->bottom.store(bottom + 1, std::memory_order_release);
+	}
+
+	return result;
+}
+
+internal Job* StealJob(JobDeque* deque)
+{
+	int64 top    = deque->top.load(std::memory_order_seq_cst);
+	int64 bottom = deque->bottom.load(std::memory_order_seq_cst);
+
+	Job* result = nullptr;
+	if (top < bottom)
+	{
+		Job* job = deque->jobs[top & JOB_DEQUE_MASK].load(std::memory_order_relaxed);
+		if (deque->top.compare_exchange_strong(
+		        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			result = job;
+		}
+	}
+
+	return result;
+}
+
+internal void ExecuteJob(Job* job)
+{
+	job->function(job->data, job->begin, job->end);
+	job->counter->value.fetch_sub(1, std::memory_order_release);
+}
+
+// NOTE(Charly): Own jobs first (most recent, hot in cache), then the oldest ones of the others
+internal Job* FindJob(uint32 workerIdx, z::RandomSeries* victims)
+{
+	Job* result = PopJob(g_jobs.deques + workerIdx);
+	if (!result)
+	{
+		uint32 firstVictim = z::NextRandom(victims) % g_jobs.nbDeques;
+		for (uint32 victimOffset = 0; victimOffset < g_jobs.nbDeques && !result; ++victimOffset)
+		{
+			uint32 victimIdx = (firstVictim + victimOffset) % g_jobs.nbDeques;
+			if (victimIdx != workerIdx)
+			{
+				result = StealJob(g_jobs.deques + victimIdx);
+			}
+		}
+	}
+
+	if (result)
+	{
+		g_jobs.nbQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+internal void RunWorker(uint32 workerIdx)
+{
+	t_workerIdx = workerIdx;
+
+	InitializeFrameMemory(g_jobs.workerMemory + (workerIdx - 1) * JOB_WORKER_MEMORY_SIZE,
+	                      JOB_WORKER_MEMORY_SIZE);
+	uint32 frameIndex = g_jobs.frameIndex.load(std::memory_order_acquire);
+
+	z::RandomSeries victims = z::SeedRandomSeries(workerIdx);
+
+	uint32 nbIdleSpins = 0;
+	while (!g_jobs.shutdown.load(std::memory_order_acquire))
+	{
+		Job* job = FindJob(workerIdx, &victims);
+		if (job)
+		{
+			// NOTE(Charly): Results of the jobs of the previous frame have all been consumed
+			uint32 currentFrameIndex = g_jobs.frameIndex.load(std::memory_order_acquire);
+			if (currentFrameIndex != frameIndex)
+			{
+				EndFrameMemory();
+				frameIndex = currentFrameIndex;
+			}
+
+			ExecuteJob(job);
+			nbIdleSpins = 0;
+		}
+		else if (++nbIdleSpins < JOB_IDLE_SPINS)
+		{
+			CpuRelax();
+		}
+		else
+		{
+			// NOTE(Charly): The sleeper count is published before checking for jobs, and RunJobs
+			//               publishes the jobs before checking for sleepers, so at least one of
+			//               the two sees the other.
+			std::unique_lock<std::mutex> lock(g_jobs.sleepMutex);
+			g_jobs.nbSleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+			while (g_jobs.nbQueuedJobs.load(std::memory_order_seq_cst) <= 0 &&
+			       !g_jobs.shutdown.load(std::memory_order_acquire))
+			{
+				g_jobs.wakeUp.wait(lock);
+			}
+			g_jobs.nbSleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+
+			nbIdleSpins = 0;
+		}
+	}
+}
+
+void InitJobSystem(uint32 nbThreads)
+{
+	Assert(g_jobs.nbWorkers == 0);
+
+	if (nbThreads == 0)
+	{
+		nbThreads = std::thread::hardware_concurrency();
+		nbThreads = nbThreads ? nbThreads : 1;
+	}
+	nbThreads = nbThreads < MAX_JOB_WORKERS ? nbThreads : MAX_JOB_WORKERS;
+
+	// NOTE(Charly): Starting threads hits the heap
+	AllowFrameHeapAllocations();
+
+	g_jobs.nbWorkers = nbThreads;
+	g_jobs.nbDeques  = nbThreads + MAX_ATTACHED_JOB_THREADS;
+	g_jobs.deques    = (JobDeque*)PlatformAllocateMemory(g_jobs.nbDeques * sizeof(JobDeque));
+	if (nbThreads > 1)
+	{
+		g_jobs.workerMemory =
+		    (uint8*)PlatformAllocateMemory((nbThreads - 1) * JOB_WORKER_MEMORY_SIZE);
+	}
+	if (!g_jobs.deques || (nbThreads > 1 && !g_jobs.workerMemory))
+	{
+		Log(Log_Error, "Could not allocate the job system, jobs will run inline");
+		ShutdownJobSystem();
+		return;
+	}
+
+	for (uint32 dequeIdx = 0; dequeIdx < g_jobs.nbDeques; ++dequeIdx)
+	{
+		new (g_jobs.deques + dequeIdx) JobDeque();
+	}
+	for (uint32 slotIdx = 0; slotIdx < MAX_ATTACHED_JOB_THREADS; ++slotIdx)
+	{
+		g_jobs.attached[slotIdx].store(false, std::memory_order_relaxed);
+	}
+
+	g_jobs.shutdown.store(false, std::memory_order_relaxed);
+	t_workerIdx = 0;
+
+	g_jobs.threads.reserve(nbThreads - 1);
+	for (uint32 workerIdx = 1; workerIdx < nbThreads; ++workerIdx)
+	{
+		g_jobs.threads.emplace_back(RunWorker, workerIdx);
+	}
+
+	Log(Log_Info, "Job system started with %u workers", nbThreads);
+}
+
+void ShutdownJobSystem()
+{
+	// NOTE(Charly): An attached thread may be running jobs on its deque
+	for (uint32 slotIdx = 0; slotIdx < MAX_ATTACHED_JOB_THREADS; ++slotIdx)
+	{
+		Assert(!g_jobs.attached[slotIdx].load(std::memory_order_acquire));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(g_jobs.sleepMutex);
+		g_jobs.shutdown.store(true, std::memory_order_release);
+	}
+	g_jobs.wakeUp.notify_all();
+
+	for (std::thread& thread : g_jobs.threads)
+	{
+		thread.join();
+	}
+	g_jobs.threads.clear();
+
+	if (g_jobs.deques)
+	{
+		PlatformFreeMemory(g_jobs.deques, g_jobs.nbDeques * sizeof(JobDeque));
+	}
+	if (g_jobs.workerMemory)
+	{
+		PlatformFreeMemory(g_jobs.workerMemory, (g_jobs.nbWorkers - 1) * JOB_WORKER_MEMORY_SIZE);
+	}
+
+	g_jobs.nbWorkers    = 0;
+	g_jobs.nbDeques     = 0;
+	g_jobs.deques       = nullptr;
+	g_jobs.workerMemory = nullptr;
+	t_workerIdx         = NOT_A_JOB_WORKER;
+}
+
+uint32 GetJobWorkerCount()
+{
+	uint32 result = g_jobs.nbWorkers ? g_jobs.nbWorkers : 1;
+	return result;
+}
+
+bool32 AttachJobThread()
+{
+	Assert(t_workerIdx == NOT_A_JOB_WORKER);
+
+	bool32 result = false;
+	for (uint32 slotIdx = 0; slotIdx < MAX_ATTACHED_JOB_THREADS && g_jobs.deques && !result; ++slotIdx)
+	{
+		bool32 expected = false;
+		if (g_jobs.attached[slotIdx].compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			t_workerIdx    = g_jobs.nbWorkers + slotIdx;
+			t_attachedSlot = slotIdx;
+			result         = true;
+		}
+	}
+
+	return result;
+}
+
+void DetachJobThread()
+{
+	if (t_attachedSlot != NOT_A_JOB_WORKER)
+	{
+		// NOTE(Charly): Every job pushed from this thread has been waited for, the deque is empty
+		g_jobs.attached[t_attachedSlot].store(false, std::memory_order_release);
+		t_attachedSlot = NOT_A_JOB_WORKER;
+		t_workerIdx    = NOT_A_JOB_WORKER;
+	}
+}
+
+void EndJobsFrame()
+{
+	g_jobs.frameIndex.fetch_add(1, std::memory_order_release);
+}
+
+void RunJobs(Job* jobs, uint32 nbJobs, JobCounter* counter)
+{
+	counter->value.fetch_add((int32)nbJobs, std::memory_order_relaxed);
+
+	uint32 workerIdx = t_workerIdx;
+	if (workerIdx == NOT_A_JOB_WORKER || g_jobs.nbWorkers <= 1)
+	{
+		for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+		{
+			jobs[jobIdx].counter = counter;
+			ExecuteJob(jobs + jobIdx);
+		}
+		return;
+	}
+
+	JobDeque* deque = g_jobs.deques + workerIdx;
+	for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+	{
+		Job* job     = jobs + jobIdx;
+		job->counter = counter;
+		if (PushJob(deque, job))
+		{
+			g_jobs.nbQueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+		}
+		else
+		{
+			ExecuteJob(job);
+		}
+	}
+
+	if (g_jobs.nbSleepingWorkers.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(g_jobs.sleepMutex);
+		g_jobs.wakeUp.notify_all();
+	}
+}
+
+void WaitForCounter(JobCounter* counter)
+{
+	uint32          workerIdx = t_workerIdx;
+	z::RandomSeries victims   = z::SeedRandomSeries(workerIdx);
+	while (counter->value.load(std::memory_order_acquire) > 0)
+	{
+		// NOTE(Charly): Only pool workers have queued jobs to help with. Outside of the pool
+		//               everything ran inline and the counter is already zero. Attached threads
+		//               do not steal: the jobs of another thread may leave their results in the
+		//               frame memory of whoever runs them, and an attached thread resets its
+		//               frame memory on its own schedule.
+		Job* job = nullptr;
+		if (workerIdx != NOT_A_JOB_WORKER && workerIdx >= g_jobs.nbWorkers)
+		{
+			job = PopJob(g_jobs.deques + workerIdx);
+			if (job)
+			{
+				g_jobs.nbQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		else if (workerIdx != NOT_A_JOB_WORKER)
+		{
+			job = FindJob(workerIdx, &victims);
+		}
+
+		if (job)
+		{
+			ExecuteJob(job);
+		}
+		else
+		{
+			CpuRelax();
+		}
+	}
+}
+
+void ParallelFor(uint32 count, uint32 minBatchSize, JobFunction* function, void* data)
+{
+	minBatchSize = minBatchSize ? minBatchSize : 1;
+
+	// NOTE(Charly): A few batches per worker, so that stealing can balance uneven ranges
+	uint32 maxJobs = GetJobWorkerCount() * 4;
+	maxJobs        = maxJobs < MAX_PARALLEL_FOR_JOBS ? maxJobs : MAX_PARALLEL_FOR_JOBS;
+	uint32 nbJobs  = (count + minBatchSize - 1) / minBatchSize;
+	nbJobs         = nbJobs < maxJobs ? nbJobs : maxJobs;
+	if (nbJobs <= 1 || t_workerIdx == NOT_A_JOB_WORKER || g_jobs.nbWorkers <= 1)
+	{
+		if (count > 0)
+		{
+			function(data, 0, count);
+		}
+		return;
+	}
+
+	Job jobs[MAX_PARALLEL_FOR_JOBS];
+	for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+	{
+		Job* job      = jobs + jobIdx;
+		job->function = function;
+		job->data     = data;
+		job->begin    = (uint32)((uint64)count * jobIdx / nbJobs);
+		job->end      = (uint32)((uint64)count * (jobIdx + 1) / nbJobs);
+	}
+
+	JobCounter counter = {};
+	RunJobs(jobs, nbJobs, &counter);
+	WaitForCounter(&counter);
+}
@@ -0,0 +1,65 @@
+#ifndef RELWARB_JOBS_H
+#define RELWARB_JOBS_H
+
+#include <atomic>
+
+#include "relwarb_defines.h"
+
+// NOTE(Charly): Small job system: a fixed pool of workers, each with its own lock-free
+//               (Chase-Lev) deque. Workers pop their own jobs from the bottom and steal from the
+//               top of the others'. Completion is tracked with counters, a thread waiting on a
+//               counter runs jobs in the meantime, so waiting from inside a job is fine.
+//
+//               The thread calling InitJobSystem is worker 0. Threads outside of the pool (or
+//               any thread when the system is not initialized) run their jobs inline, so game
+//               code can use jobs unconditionally.
+//
+//               Threads with their own frame loop (the renderer) can attach to the pool: their
+//               jobs are stolen by the workers, but they only ever run their own jobs, never
+//               the ones of the thread that owns the pool.
+//
+//               Jobs must not allocate from the heap. A job may use frame memory: what it
+//               pushes in the frame arena of the worker it runs on stays valid until the end of
+//               the frame (see EndJobsFrame).
+
+typedef void JobFunction(void* data, uint32 begin, uint32 end);
+
+struct JobCounter
+{
+	std::atomic<int32> value;
+};
+
+struct Job
+{
+	JobFunction* function;
+	void*        data;
+	uint32       begin;
+	uint32       end;
+
+	JobCounter* counter; // NOTE(Charly): Set by RunJobs
+};
+
+// NOTE(Charly): nbThreads = 0 uses all the cores
+void   InitJobSystem(uint32 nbThreads = 0);
+void   ShutdownJobSystem();
+uint32 GetJobWorkerCount();
+
+// NOTE(Charly): Call from another thread once InitJobSystem has returned, detach before the
+//               system shuts down (it asserts that nothing is attached anymore). Returns false
+//               when there is no slot left, jobs then run inline.
+bool32 AttachJobThread();
+void   DetachJobThread();
+
+// NOTE(Charly): Call once per frame on the main thread, next to EndFrameMemory. The frame memory
+//               of the workers is recycled lazily, before they run their next job.
+void EndJobsFrame();
+
+// NOTE(Charly): jobs must stay alive until the counter reaches zero
+void RunJobs(Job* jobs, uint32 nbJobs, JobCounter* counter);
+void WaitForCounter(JobCounter* counter);
+
+// NOTE(Charly): Calls function on [0, count) split in ranges of at least minBatchSize elements,
+//               and waits for all of them. Small counts run inline.
+void ParallelFor(uint32 count, uint32 minBatchSize, JobFunction* function, void* data);
+
+#endif // RELWARB_JOBS_H
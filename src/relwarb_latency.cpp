@@ -0,0 +1,148 @@
+#include "relwarb_latency.h"
+
+#include <stdio.h>
+
+#include "relwarb_debug.h"
+#include "relwarb_input_events.h"
+#include "relwarb_utils.h"
+
+global_variable const char* latencyStageNames[] = {"tick", "submit", "present"};
+
+global_variable LatencyHistogram g_latencyHistograms[LatencyStage_Count];
+
+// NOTE(Charly): Press between its submit and its present, input is 0 when none
+global_variable LatencyEvent g_followedLatencyEvent;
+global_variable int64        g_lastLatencyInput;
+
+internal void AddLatencySample(LatencyHistogram* histogram, int64 latency)
+{
+	int64 bucket = latency / (LATENCY_BUCKET_US * 1000);
+	if (bucket >= NB_LATENCY_BUCKETS)
+	{
+		bucket = NB_LATENCY_BUCKETS - 1;
+	}
+	else if (bucket < 0)
+	{
+		bucket = 0;
+	}
+	++histogram->buckets[bucket];
+
+	if (histogram->count == 0 || latency < histogram->min)
+	{
+		histogram->min = latency;
+	}
+	if (histogram->count == 0 || latency > histogram->max)
+	{
+		histogram->max = latency;
+	}
+	histogram->total += latency;
+	++histogram->count;
+}
+
+void SubmitLatencyFrame(const LatencyEvent* event)
+{
+	// NOTE(Charly): Later frames show the same press, and a restored snapshot brings back an
+	//               older one
+	if (event->input <= g_lastLatencyInput)
+	{
+		return;
+	}
+	g_lastLatencyInput = event->input;
+
+	g_followedLatencyEvent                               = *event;
+	g_followedLatencyEvent.stages[LatencyStage_Submit]   = GetInputEventTime();
+	g_followedLatencyEvent.stages[LatencyStage_Present] = 0;
+}
+
+void PresentLatencyFrame()
+{
+	LatencyEvent* event = &g_followedLatencyEvent;
+	if (event->input == 0)
+	{
+		return;
+	}
+	event->stages[LatencyStage_Present] = GetInputEventTime();
+
+	for (uint32 stage = 0; stage < LatencyStage_Count; ++stage)
+	{
+		AddLatencySample(g_latencyHistograms + stage, event->stages[stage] - event->input);
+	}
+
+	*event = {};
+}
+
+const LatencyHistogram* GetLatencyHistogram(LatencyStage stage)
+{
+	const LatencyHistogram* result = g_latencyHistograms + stage;
+	return result;
+}
+
+const char* GetLatencyStageName(LatencyStage stage)
+{
+	const char* result = latencyStageNames[stage];
+	return result;
+}
+
+// NOTE(Charly): Upper bound of the bucket holding the sample of that rank, but never past the max
+internal real64 GetLatencySample(const LatencyHistogram* histogram, uint32 rank)
+{
+	real64 result = histogram->max / 1e6;
+
+	uint32 seen = 0;
+	for (uint32 bucket = 0; bucket < NB_LATENCY_BUCKETS; ++bucket)
+	{
+		seen += histogram->buckets[bucket];
+		if (seen > rank)
+		{
+			int64 upper = (int64)(bucket + 1) * LATENCY_BUCKET_US * 1000;
+			result      = (upper < histogram->max ? upper : histogram->max) / 1e6;
+			break;
+		}
+	}
+
+	return result;
+}
+
+real64 GetLatencyPercentile(const LatencyHistogram* histogram, real64 percentile)
+{
+	real64 result = 0.0;
+	if (histogram->count == 0)
+	{
+		return result;
+	}
+
+	PercentileRank rank = GetPercentileRank(histogram->count, percentile);
+	result = GetLatencySample(histogram, rank.below) * (1.0 - rank.t) +
+	         GetLatencySample(histogram, rank.above) * rank.t;
+	return result;
+}
+
+bool32 SaveLatencyHistograms(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (!file)
+	{
+		Log(Log_Error, "Could not open %s", filename);
+		return false;
+	}
+
+	fprintf(file, "bucket_ms");
+	for (uint32 stage = 0; stage < LatencyStage_Count; ++stage)
+	{
+		fprintf(file, ",%s", latencyStageNames[stage]);
+	}
+	fprintf(file, "\n");
+
+	for (uint32 bucket = 0; bucket < NB_LATENCY_BUCKETS; ++bucket)
+	{
+		fprintf(file, "%.1f", bucket * LATENCY_BUCKET_US / 1000.0);
+		for (uint32 stage = 0; stage < LatencyStage_Count; ++stage)
+		{
+			fprintf(file, ",%u", g_latencyHistograms[stage].buckets[bucket]);
+		}
+		fprintf(file, "\n");
+	}
+
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,56 @@
+#ifndef RELWARB_LATENCY_H
+#define RELWARB_LATENCY_H
+
+#include "relwarb_defines.h"
+
+// NOTE(Charly): Follows jump presses from the device to the screen. Each stage is timed from the
+//               press (GetInputEventTime, ns):
+//               - Tick: the simulation tick whose UpdateWorld saw the rising edge of Action_Jump
+//               - Submit: the render queue of the first frame showing that tick was flushed
+//               - Present: the swap of that frame returned
+//               The simulation only stamps the event, the main thread stamps the rest and keeps
+//               the histograms. Recorded presses only, replays have no timestamps.
+enum LatencyStage
+{
+	LatencyStage_Tick,
+	LatencyStage_Submit,
+	LatencyStage_Present,
+
+	LatencyStage_Count,
+};
+
+struct LatencyEvent
+{
+	int64 input; // NOTE(Charly): 0 when no press was seen yet
+	int64 stages[LatencyStage_Count];
+};
+
+#define LATENCY_BUCKET_US 500
+#define NB_LATENCY_BUCKETS 128 // NOTE(Charly): The last one also holds everything above
+
+struct LatencyHistogram
+{
+	uint32 buckets[NB_LATENCY_BUCKETS];
+	uint32 count;
+	int64  total;
+	int64  min;
+	int64  max;
+};
+
+// NOTE(Charly): With the event of the frame being drawn, right after its render queue was flushed.
+//               A press is only followed the first time a frame shows it.
+void SubmitLatencyFrame(const LatencyEvent* event);
+// NOTE(Charly): Right after the swap returned, completes and records the followed press
+void PresentLatencyFrame();
+
+// NOTE(Charly): Main thread only, like the two above
+const LatencyHistogram* GetLatencyHistogram(LatencyStage stage);
+const char*             GetLatencyStageName(LatencyStage stage);
+
+// NOTE(Charly): In ms, to the resolution of the buckets. Percentile in [0, 1], see GetPercentile.
+real64 GetLatencyPercentile(const LatencyHistogram* histogram, real64 percentile);
+
+// NOTE(Charly): CSV, a line per bucket and a column per stage
+bool32 SaveLatencyHistograms(const char* filename);
+
+#endif // RELWARB_LATENCY_H
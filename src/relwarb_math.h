@@ -4,9 +4,15 @@
 #include <cmath>
 #include <limits>
 #include <cstdlib>
+#include <cstdint>
 
-#ifndef ZMATH_NO_SSE
+// NOTE(Charly): The SSE paths are single precision only. They give the same bits as the scalar
+//               code (same operations in the same order), except InvSqrt which is less precise:
+//               about 2.7e-7 relative error against 1.4e-7 for the scalar code.
+//               relwarb_headless --math-test checks both.
+#if !defined(ZMATH_NO_SSE) && !defined(ZMATH_DOUBLE_PRECISION)
 #include <immintrin.h>
+#define ZMATH_SSE
 #endif
 
 #ifdef ZMATH_DOUBLE_PRECISION
@@ -55,9 +61,21 @@ namespace z
     inline real ArcTan(real x);
     inline void SinCosSquared(real x, real* psin, real* pcos);
 
-    inline void SeedRNG(unsigned int seed);
-    inline real GenerateRandBetween(real a = real(0), real b = real(1));
-    inline real GenerateRandNormal(real mean = 0.0,  real stddev = 1.0);
+    // NOTE(Charly): Explicit generator state (xorshift64*), the same seed always gives
+    //               the same sequence, whatever the platform's rand() is. There is no global
+    //               generator on purpose: every world owns its series, so that worlds can be
+    //               simulated concurrently.
+    struct RandomSeries
+    {
+        uint64_t state;
+        real cachedNormal;
+        bool hasCachedNormal;
+    };
+
+    inline RandomSeries SeedRandomSeries(uint32_t seed);
+    inline uint32_t NextRandom(RandomSeries* series);
+    inline real GenerateRandBetween(RandomSeries* series, real a = real(0), real b = real(1));
+    inline real GenerateRandNormal(RandomSeries* series, real mean = 0.0,  real stddev = 1.0);
 
     template <typename T> inline T Clamp(const T& x, const T& a, const T& b);
     template <typename T> inline T Saturate(const T& x);
@@ -160,6 +178,8 @@ namespace z
     vec4 Vec4(real x);
     vec4 Vec4(real x, real y, real z, real w);
 
+    inline vec4 Lerp(const vec4& a, const vec4& b, real t);
+
     template <typename V> inline real LengthSquared(const V& v);
     template <typename V> inline real Length(const V& v);
     template <typename V> inline real Dot(const V& v1, const V& v2);
@@ -257,12 +277,50 @@ namespace z
     inline mat3 Rotation(real r);
     inline mat3 Scale(real sx, real sy);
     inline mat3 Scale(const vec2& s);
+
+    // NOTE(Charly): 2D affine transform, the first two rows of a mat3 whose last row is (0, 0, 1).
+    //               Half the size of a mat3, composes in 12 products and needs no divide.
+    struct affine2
+    {
+        real xx, xy, tx;
+        real yx, yy, ty;
+    };
+
+    inline affine2 Affine2(real x);
+    inline affine2 Affine2(const mat3& m); // NOTE(Charly): The last row of m is dropped
+    // NOTE(Charly): Closed form of Translation(position) * Rotation(rotation) * Scale(scale) * Translation(-origin)
+    inline affine2 Affine2(const vec2& position, real rotation, const vec2& scale, const vec2& origin);
+    inline mat3 Mat3(const affine2& a);
+
+    inline affine2 operator*(const affine2& a1, const affine2& a2);
+    inline vec2 operator*(const affine2& a, const vec2& v);
+    inline vec2 TransformVector(const affine2& a, const vec2& v); // NOTE(Charly): No translation
+
+    // NOTE(Charly): stride is in bytes, the same for points and result, which can be the same array
+    inline void TransformPoints(const affine2& a, const vec2* points, vec2* result, uint32_t count,
+                                size_t stride = sizeof(vec2));
 }
 
 #undef DEFAULT_CTORS
 
 namespace z
 {
+#ifdef ZMATH_SSE
+    // NOTE(Charly): Unaligned, vec4 and the (padded) rows of mat3 are only 4-byte aligned
+    inline __m128 LoadSimd(const real* data)
+    {
+        __m128 result = _mm_loadu_ps(data);
+        return result;
+    }
+
+    inline vec4 StoreVec4(__m128 v)
+    {
+        vec4 result;
+        _mm_storeu_ps(result.data, v);
+        return result;
+    }
+#endif
+
     inline real Sqrt(real x)
     {
         real result = std::sqrt(x);
@@ -271,6 +329,12 @@ namespace z
 
     inline real InvSqrt(real x)
     {
+#ifdef ZMATH_SSE
+        // NOTE(Charly): The estimate is good to 12 bits, one Newton-Raphson step to ~22
+        real estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        real result = estimate * (real(1.5) - real(0.5) * x * estimate * estimate);
+        return result;
+#else
         // https://en.wikipedia.org/wiki/Methods_of_computing_square_roots#Approximations_that_depend_on_the_floating_point_representation
         real xhalf = 0.5f * x;
         union
@@ -289,6 +353,7 @@ namespace z
         real result = u.x;
 
         return result;
+#endif
     }
 
     inline real Pow(real x, int n)
@@ -470,51 +535,81 @@ namespace z
         return result;
     }
 
-    inline void SeedRNG(unsigned int seed)
+    inline vec4 Lerp(const vec4& a, const vec4& b, real t)
     {
-        std::srand(seed);
+#ifdef ZMATH_SSE
+        __m128 tb = _mm_mul_ps(_mm_set1_ps(t), LoadSimd(b.data));
+        __m128 ta = _mm_mul_ps(_mm_set1_ps(1 - t), LoadSimd(a.data));
+        vec4 result = StoreVec4(_mm_add_ps(tb, ta));
+#else
+        vec4 result = t * b + (1 - t) * a;
+#endif
+        return result;
     }
 
-    inline real GenerateRandBetween(real a, real b)
+    inline RandomSeries SeedRandomSeries(uint32_t seed)
+    {
+        // NOTE(Charly): splitmix64 step, so that close seeds give unrelated sequences
+        uint64_t z = uint64_t(seed) + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+
+        RandomSeries result;
+        result.state = z ? z : 0x9E3779B97F4A7C15ull;
+        result.cachedNormal = real(0);
+        result.hasCachedNormal = false;
+
+        return result;
+    }
+
+    inline uint32_t NextRandom(RandomSeries* series)
+    {
+        uint64_t x = series->state;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        series->state = x;
+
+        uint32_t result = uint32_t((x * 0x2545F4914F6CDD1Dull) >> 32);
+        return result;
+    }
+
+    inline real GenerateRandBetween(RandomSeries* series, real a, real b)
     {
         // [0..1]
-        real r = real(std::rand()) / real(RAND_MAX);
+        real r = real(NextRandom(series) >> 8) / real(0xFFFFFF);
         r = r * (b - a) + a;
 
         return r;
     }
 
-    inline real GenerateRandNormal(real mean, real stddev)
+    inline real GenerateRandNormal(RandomSeries* series, real mean, real stddev)
     {
-        // NOTE(Charly): Box-muller method http://stackoverflow.com/a/28551411/4717805
-        static real n2(0);
-        static bool n2_cached = false;
-
         real result;
 
-        if (!n2_cached)
+        if (!series->hasCachedNormal)
         {
             real x, y, r;
             do
             {
-                x = real(2) * std::rand() / real(RAND_MAX) - real(1);
-                y = real(2) * std::rand() / real(RAND_MAX) - real(1);
+                x = GenerateRandBetween(series, real(-1), real(1));
+                y = GenerateRandBetween(series, real(-1), real(1));
 
                 r = x * x + y * y;
             }
             while (r == real(0) || r > real(1));
 
             real d = Sqrt(-2 * Log(r) / r);
-            real n1 = x * d;
-            n2 = y * d;
+            series->cachedNormal = y * d;
+            series->hasCachedNormal = true;
 
-            result = n1 * stddev + mean;
-            n2_cached = true;
+            result = x * d * stddev + mean;
         }
         else
         {
-            n2_cached = false;
-            result = n2 * stddev + mean;
+            series->hasCachedNormal = false;
+            result = series->cachedNormal * stddev + mean;
         }
 
         return result;
@@ -812,56 +907,80 @@ namespace z
 
     inline vec4& vec4::operator+=(const vec4& v)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_add_ps(LoadSimd(data), LoadSimd(v.data)));
+#else
         x += v.x;
         y += v.y;
         z += v.z;
         w += v.w;
+#endif
         return *this;
     }
 
     inline vec4& vec4::operator-=(const vec4& v)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_sub_ps(LoadSimd(data), LoadSimd(v.data)));
+#else
         x -= v.x;
         y -= v.y;
         z -= v.z;
         w -= v.w;
+#endif
         return *this;
     }
 
     inline vec4& vec4::operator*=(real a)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_mul_ps(LoadSimd(data), _mm_set1_ps(a)));
+#else
         x *= a;
         y *= a;
         z *= a;
         w *= a;
+#endif
         return *this;
     }
 
 
     inline vec4& vec4::operator*=(const vec4& v)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_mul_ps(LoadSimd(data), LoadSimd(v.data)));
+#else
         x *= v.x;
         y *= v.y;
         z *= v.z;
         w *= v.w;
+#endif
         return *this;
     }
 
     inline vec4& vec4::operator/=(real a)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_div_ps(LoadSimd(data), _mm_set1_ps(a)));
+#else
         x /= a;
         y /= a;
         z /= a;
-        y /= a;
+        w /= a;
+#endif
         return *this;
     }
 
     inline vec4& vec4::operator/=(const vec4& v)
     {
+#ifdef ZMATH_SSE
+        *this = StoreVec4(_mm_div_ps(LoadSimd(data), LoadSimd(v.data)));
+#else
         x /= v.x;
         y /= v.y;
         z /= v.z;
         w /= v.w;
+#endif
         return *this;
     }
 
@@ -889,37 +1008,61 @@ namespace z
 
     inline vec4 operator-(const vec4& v)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_xor_ps(LoadSimd(v.data), _mm_set1_ps(-0.f)));
+#else
         vec4 result = Vec4(-v.x, -v.y, -v.z, -v.w);
+#endif
         return result;
     }
 
     inline vec4 operator+(const vec4& v1, const vec4& v2)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_add_ps(LoadSimd(v1.data), LoadSimd(v2.data)));
+#else
         vec4 result = Vec4(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w);
+#endif
         return result;
     }
 
     inline vec4 operator-(const vec4& v1, const vec4& v2)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_sub_ps(LoadSimd(v1.data), LoadSimd(v2.data)));
+#else
         vec4 result = Vec4(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w);
+#endif
         return result;
     }
 
     inline vec4 operator*(const vec4& v1, const vec4& v2)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_mul_ps(LoadSimd(v1.data), LoadSimd(v2.data)));
+#else
         vec4 result = Vec4(v1.x * v2.x, v1.y * v2.y, v1.z * v2.z, v1.w * v2.w);
+#endif
         return result;
     }
 
     inline vec4 operator/(const vec4& v1, const vec4& v2)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_div_ps(LoadSimd(v1.data), LoadSimd(v2.data)));
+#else
         vec4 result = Vec4(v1.x / v2.x, v1.y / v2.y, v1.z / v2.z, v1.w / v2.w);
+#endif
         return result;
     }
 
     inline vec4 operator*(const vec4& v, real x)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_mul_ps(LoadSimd(v.data), _mm_set1_ps(x)));
+#else
         vec4 result = Vec4(v.x * x, v.y * x, v.z * x, v.w * x);
+#endif
         return result;
     }
 
@@ -937,7 +1080,11 @@ namespace z
 
     inline vec4 operator/(real x, const vec4& v)
     {
+#ifdef ZMATH_SSE
+        vec4 result = StoreVec4(_mm_div_ps(_mm_set1_ps(x), LoadSimd(v.data)));
+#else
         vec4 result = Vec4(x / v.x, x / v.y, x / v.z, x / v.w);
+#endif
         return result;
     }
 
@@ -1184,10 +1331,24 @@ namespace z
     {
         vec3 result;
 
+#ifdef ZMATH_SSE
+        // NOTE(Charly): Rows to columns, then a column per component of v, which adds the same
+        //               products in the same order as the dot products
+        __m128 col0 = LoadSimd(m.data[0].data);
+        __m128 col1 = LoadSimd(m.data[1].data);
+        __m128 col2 = LoadSimd(m.data[2].data);
+        __m128 col3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+        __m128 sum = _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(v.x)), _mm_mul_ps(col1, _mm_set1_ps(v.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(col2, _mm_set1_ps(v.z)));
+        _mm_storeu_ps(result.data, sum);
+#else
         for (int i = 0; i < 3; ++i)
         {
             result[i] = Dot(m.Row(i), v);
         }
+#endif
 
         return result;
     }
@@ -1208,6 +1369,23 @@ namespace z
     {
         mat3 result;
 
+#ifdef ZMATH_SSE
+        // NOTE(Charly): A row of the product is the rows of m2 weighted by a row of m1. The
+        //               padding of the rows is never written, it can hold denormals which would
+        //               make every operation on the lane very slow.
+        __m128 xyz  = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        __m128 row0 = _mm_and_ps(LoadSimd(m2.data[0].data), xyz);
+        __m128 row1 = _mm_and_ps(LoadSimd(m2.data[1].data), xyz);
+        __m128 row2 = _mm_and_ps(LoadSimd(m2.data[2].data), xyz);
+        for (int row = 0; row < 3; ++row)
+        {
+            const vec3& weights = m1.data[row];
+            __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(weights.x), row0),
+                                    _mm_mul_ps(_mm_set1_ps(weights.y), row1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights.z), row2));
+            _mm_storeu_ps(result.data[row].data, sum);
+        }
+#else
         for (int row = 0; row < 3; ++row)
         {
             for (int col = 0; col < 3; ++col)
@@ -1216,6 +1394,7 @@ namespace z
                 result[row][col] = prod;
             }
         }
+#endif
 
         return result;
     }
@@ -1284,12 +1463,27 @@ namespace z
 
     inline vec2 operator*(const mat3& m, const vec2& v)
     {
+#ifdef ZMATH_SSE
+        __m128 col0 = LoadSimd(m.data[0].data);
+        __m128 col1 = LoadSimd(m.data[1].data);
+        __m128 col2 = LoadSimd(m.data[2].data);
+        __m128 col3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+        // NOTE(Charly): The last column times 1
+        __m128 p = _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(v.x)), _mm_mul_ps(col1, _mm_set1_ps(v.y)));
+        p = _mm_add_ps(p, col2);
+        p = _mm_div_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+
+        vec2 result = Vec2(_mm_cvtss_f32(p), _mm_cvtss_f32(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))));
+#else
         vec3 v1 = Vec3(v.x, v.y, real(1));
 
         v1 = m * v1;
         v1 /= v1.z;
 
         vec2 result = Vec2(v1.x, v1.y);
+#endif
         return result;
     }
 
@@ -1449,6 +1643,106 @@ namespace z
         mat3 result = Scale(s.x, s.y);
         return result;
     }
+
+    inline affine2 Affine2(real x)
+    {
+        affine2 result = {x, 0, 0,
+                          0, x, 0};
+        return result;
+    }
+
+    inline affine2 Affine2(const mat3& m)
+    {
+        affine2 result = {m[0][0], m[0][1], m[0][2],
+                          m[1][0], m[1][1], m[1][2]};
+        return result;
+    }
+
+    inline affine2 Affine2(const vec2& position, real rotation, const vec2& scale, const vec2& origin)
+    {
+        const real c = Cos(rotation);
+        const real s = Sin(rotation);
+
+        affine2 result;
+        result.xx = c * scale.x;
+        result.xy = -s * scale.y;
+        result.yx = s * scale.x;
+        result.yy = c * scale.y;
+        result.tx = position.x - (result.xx * origin.x + result.xy * origin.y);
+        result.ty = position.y - (result.yx * origin.x + result.yy * origin.y);
+        return result;
+    }
+
+    inline mat3 Mat3(const affine2& a)
+    {
+        mat3 result(Vec3(a.xx, a.xy, a.tx),
+                    Vec3(a.yx, a.yy, a.ty),
+                    Vec3(0, 0, 1));
+        return result;
+    }
+
+    inline affine2 operator*(const affine2& a1, const affine2& a2)
+    {
+        affine2 result;
+        result.xx = a1.xx * a2.xx + a1.xy * a2.yx;
+        result.xy = a1.xx * a2.xy + a1.xy * a2.yy;
+        result.tx = a1.xx * a2.tx + a1.xy * a2.ty + a1.tx;
+        result.yx = a1.yx * a2.xx + a1.yy * a2.yx;
+        result.yy = a1.yx * a2.xy + a1.yy * a2.yy;
+        result.ty = a1.yx * a2.tx + a1.yy * a2.ty + a1.ty;
+        return result;
+    }
+
+    inline vec2 operator*(const affine2& a, const vec2& v)
+    {
+        vec2 result = Vec2(a.xx * v.x + a.xy * v.y + a.tx,
+                           a.yx * v.x + a.yy * v.y + a.ty);
+        return result;
+    }
+
+    inline vec2 TransformVector(const affine2& a, const vec2& v)
+    {
+        vec2 result = Vec2(a.xx * v.x + a.xy * v.y,
+                           a.yx * v.x + a.yy * v.y);
+        return result;
+    }
+
+    inline void TransformPoints(const affine2& a, const vec2* points, vec2* result, uint32_t count, size_t stride)
+    {
+        const char* in = (const char*)points;
+        char* out = (char*)result;
+        uint32_t i = 0;
+
+#ifdef ZMATH_SSE
+        // NOTE(Charly): Two points per register, (x0, y0, x1, y1). Same operations in the same
+        //               order as a * v, the results are the same bits.
+        const __m128 colX = _mm_setr_ps(a.xx, a.yx, a.xx, a.yx);
+        const __m128 colY = _mm_setr_ps(a.xy, a.yy, a.xy, a.yy);
+        const __m128 t = _mm_setr_ps(a.tx, a.ty, a.tx, a.ty);
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128 p = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)in);
+            p = _mm_loadh_pi(p, (const __m64*)(in + stride));
+
+            __m128 px = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 py = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, colX), _mm_mul_ps(py, colY)), t);
+
+            _mm_storel_pi((__m64*)out, r);
+            _mm_storeh_pi((__m64*)(out + stride), r);
+
+            in += 2 * stride;
+            out += 2 * stride;
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            *(vec2*)out = a * *(const vec2*)in;
+            in += stride;
+            out += stride;
+        }
+    }
 }
 
 #endif // ZMATH_HPP
@@ -0,0 +1,127 @@
+#include "relwarb_memory.h"
+
+#include <stdlib.h>
+#include <new>
+
+#include "relwarb_debug.h"
+
+// NOTE(Charly): Everything is per thread, so that worlds can be simulated concurrently
+global_variable thread_local MemoryArena g_frameArena;
+global_variable thread_local MemoryArena g_doubleBufferedArenas[2];
+global_variable thread_local uint32      g_currentDoubleBufferedArena;
+
+global_variable thread_local uint64 g_heapAllocationCount;
+global_variable thread_local uint64 g_frameStartHeapAllocationCount;
+global_variable thread_local bool32 g_frameHeapAllocationsAllowed;
+
+#if defined(RELWARB_DEBUG)
+void* operator new(size_t size)
+{
+	++g_heapAllocationCount;
+
+	void* result = malloc(size ? size : 1);
+	Assert(result);
+	return result;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+#endif
+
+void InitializeArena(MemoryArena* arena, void* base, size_t size)
+{
+	arena->base = (uint8*)base;
+	arena->size = size;
+	arena->used = 0;
+	arena->peak = 0;
+}
+
+void ResetArena(MemoryArena* arena)
+{
+	if (arena->used > arena->peak)
+	{
+		arena->peak = arena->used;
+	}
+
+	arena->used = 0;
+}
+
+void* PushSize(MemoryArena* arena, size_t size, size_t alignment)
+{
+	Assert(alignment && (alignment & (alignment - 1)) == 0);
+
+	size_t current = (size_t)(arena->base + arena->used);
+	size_t padding = (alignment - (current & (alignment - 1))) & (alignment - 1);
+
+	if (arena->used + padding + size > arena->size)
+	{
+		Assert(!"Memory arena is full");
+		Log(Log_Error, "Memory arena is full (%zu / %zu bytes)", arena->used, arena->size);
+		return nullptr;
+	}
+
+	void* result = arena->base + arena->used + padding;
+	arena->used += padding + size;
+
+	return result;
+}
+
+void InitializeFrameMemory(void* memory, size_t size)
+{
+	// NOTE(Charly): Half for the frame arena, a quarter for each double buffered one
+	size_t frameSize          = size / 2;
+	size_t doubleBufferedSize = size / 4;
+
+	uint8* base = (uint8*)memory;
+	InitializeArena(&g_frameArena, base, frameSize);
+	InitializeArena(&g_doubleBufferedArenas[0], base + frameSize, doubleBufferedSize);
+	InitializeArena(&g_doubleBufferedArenas[1],
+	                base + frameSize + doubleBufferedSize,
+	                doubleBufferedSize);
+	g_currentDoubleBufferedArena = 0;
+
+	// NOTE(Charly): Game initialization is accounted to the first frame
+	g_frameStartHeapAllocationCount = g_heapAllocationCount;
+	g_frameHeapAllocationsAllowed   = true;
+}
+
+MemoryArena* GetFrameArena()
+{
+	return &g_frameArena;
+}
+
+MemoryArena* GetDoubleBufferedFrameArena()
+{
+	return &g_doubleBufferedArenas[g_currentDoubleBufferedArena];
+}
+
+void EndFrameMemory()
+{
+#if defined(RELWARB_DEBUG)
+	uint64 frameHeapAllocations = g_heapAllocationCount - g_frameStartHeapAllocationCount;
+	if (!g_frameHeapAllocationsAllowed)
+	{
+		Assert(frameHeapAllocations == 0);
+	}
+#endif
+	g_frameStartHeapAllocationCount = g_heapAllocationCount;
+	g_frameHeapAllocationsAllowed   = false;
+
+	ResetArena(&g_frameArena);
+
+	g_currentDoubleBufferedArena ^= 1;
+	ResetArena(&g_doubleBufferedArenas[g_currentDoubleBufferedArena]);
+}
+
+void AllowFrameHeapAllocations()
+{
+	g_frameHeapAllocationsAllowed = true;
+}
+
+uint64 GetHeapAllocationCount()
+{
+	uint64 result = g_heapAllocationCount;
+	return result;
+}
@@ -0,0 +1,99 @@
+#ifndef RELWARB_MEMORY_H
+#define RELWARB_MEMORY_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "relwarb_defines.h"
+
+#define Kilobytes(x) ((x) * (size_t)1024)
+#define Megabytes(x) (Kilobytes(x) * (size_t)1024)
+#define Gigabytes(x) (Megabytes(x) * (size_t)1024)
+
+// NOTE(Charly): Linear (bump) allocator. Nothing is ever freed individually,
+//               the whole arena is reset at once.
+struct MemoryArena
+{
+	uint8* base;
+	size_t size;
+	size_t used;
+	size_t peak;
+};
+
+void InitializeArena(MemoryArena* arena, void* base, size_t size);
+void ResetArena(MemoryArena* arena);
+
+// NOTE(Charly): Returns nullptr (and asserts in debug) when the arena is full
+void* PushSize(MemoryArena* arena, size_t size, size_t alignment = 16);
+
+#define PushStruct(arena, type) (type*)PushSize(arena, sizeof(type), alignof(type))
+#define PushArray(arena, count, type) (type*)PushSize(arena, (count) * sizeof(type), alignof(type))
+
+// NOTE(Charly): Frame memory
+//               - The frame arena is reset at the end of every frame.
+//               - The double buffered arena keeps what was pushed during frame N alive until the
+//               end of frame N + 1, for data that is produced in one frame and consumed in the
+//               next one.
+//               They are all carved out of the transient storage (see GameMemory), and they
+//               are per thread: every thread running game code must initialize its own.
+void         InitializeFrameMemory(void* memory, size_t size);
+MemoryArena* GetFrameArena();
+MemoryArena* GetDoubleBufferedFrameArena();
+void         EndFrameMemory();
+
+// NOTE(Charly): In debug builds, every operator new is counted and EndFrameMemory asserts that
+//               no heap allocation happened during the frame. Code paths that legitimately hit
+//               the heap (asset loading, first use of a pool) must say so with this.
+//               Allocations are counted per thread.
+void   AllowFrameHeapAllocations();
+uint64 GetHeapAllocationCount();
+
+// NOTE(Charly): STL-compatible allocator on top of a MemoryArena. Deallocation only gives memory
+//               back when the block is the last one pushed (typical of a growing vector).
+template <typename T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	MemoryArena* arena;
+
+	ArenaAllocator() : arena(GetFrameArena()) {}
+	explicit ArenaAllocator(MemoryArena* arena_) : arena(arena_) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena)
+	{
+	}
+
+	T* allocate(size_t n)
+	{
+		T* result = (T*)PushSize(arena, n * sizeof(T), alignof(T));
+		return result;
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		uint8* end = (uint8*)(p + n);
+		if (end == arena->base + arena->used)
+		{
+			arena->used = (uint8*)p - arena->base;
+		}
+	}
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.arena != b.arena;
+}
+
+// NOTE(Charly): Must not outlive the frame it was created in
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // RELWARB_MEMORY_H
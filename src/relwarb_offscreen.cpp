@@ -0,0 +1,678 @@
+#include "relwarb_defines.h"
+#include "relwarb_opengl.h"
+#include "relwarb_debug.h"
+#include "relwarb_frame_pacing.h"
+#include "relwarb_input.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+#include "relwarb_replay.h"
+#include "relwarb_batch.h"
+#include "relwarb_jobs.h"
+#include "relwarb_profiler.h"
+#include "relwarb_stress_scene.h"
+#include "relwarb_render_snapshot.h"
+#include "relwarb_renderer.h"
+#include "relwarb_render_commands.h"
+#include "relwarb_utils.h"
+#include "relwarb.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE(Charly): Offscreen platform layer: no window, the game renders in a framebuffer object of
+//               a surfaceless EGL context. Works with Mesa's software rasterizer, so build
+//               machines without a display or a GPU can benchmark the renderer
+//               (LIBGL_ALWAYS_SOFTWARE=1 forces llvmpipe).
+//
+//               Every frame is a fixed simulation tick (scripted input, or a replay) and a
+//               rendered frame, waited for with glFinish, as fast as possible. Frame times are
+//               reported as percentiles. --dump-dir writes frames as PNG files, to compare
+//               against golden images: the simulation is deterministic, so is the software
+//               rasterizer.
+//
+//               --null-renderer records the GL commands instead of calling GL (no context is
+//               created), the frame times are then the CPU cost of the game and the renderer.
+//               --capture also keeps the commands of every frame and saves them, --play-capture
+//               replays such a file in the context, without the game.
+
+#define RENDER_SNAPSHOTS_MEMORY_SIZE Megabytes(48)
+// NOTE(Charly): Address space, only what is recorded is ever touched
+#define RENDER_CAPTURE_MEMORY_SIZE Gigabytes(2)
+#define NULL_RENDERER_MEMORY_SIZE Megabytes(64)
+
+struct OffscreenContext
+{
+	EGLDisplay display;
+	EGLContext context;
+
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+};
+
+internal bool32 CreateOffscreenContext(OffscreenContext* offscreen, uint32 width, uint32 height)
+{
+	// NOTE(Charly): Mesa's surfaceless platform needs neither X nor a render node
+	offscreen->display = EGL_NO_DISPLAY;
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+		{
+			offscreen->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (offscreen->display == EGL_NO_DISPLAY)
+	{
+		offscreen->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (offscreen->display == EGL_NO_DISPLAY || !eglInitialize(offscreen->display, &major, &minor))
+	{
+		Log(Log_Error, "Offscreen: no EGL display");
+		return false;
+	}
+
+	// NOTE(Charly): Never drawn to, but the default surface type (window) matches nothing here
+	const EGLint configAttributes[] = {
+	    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+	    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+	    EGL_NONE,
+	};
+	EGLConfig config;
+	EGLint    nbConfigs = 0;
+	if (!eglChooseConfig(offscreen->display, configAttributes, &config, 1, &nbConfigs) || nbConfigs == 0)
+	{
+		Log(Log_Error, "Offscreen: no EGL config for desktop GL");
+		return false;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	const EGLint contextAttributes[] = {
+	    EGL_CONTEXT_MAJOR_VERSION, 3,
+	    EGL_CONTEXT_MINOR_VERSION, 3,
+	    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+	    EGL_NONE,
+	};
+	offscreen->context = eglCreateContext(offscreen->display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (offscreen->context == EGL_NO_CONTEXT ||
+	    !eglMakeCurrent(offscreen->display, EGL_NO_SURFACE, EGL_NO_SURFACE, offscreen->context))
+	{
+		Log(Log_Error, "Offscreen: could not create a GL 3.3 core context (EGL %d.%d)", major, minor);
+		return false;
+	}
+
+	if (gl3wInit() != 0 || !gl3wIsSupported(3, 3))
+	{
+		Log(Log_Error, "Offscreen: could not load GL 3.3");
+		return false;
+	}
+
+	// NOTE(Charly): The renderer never binds a framebuffer, everything ends up in this one
+	glGenRenderbuffers(1, &offscreen->colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreen->colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &offscreen->depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreen->depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &offscreen->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreen->framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen->colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen->depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		Log(Log_Error, "Offscreen: incomplete framebuffer");
+		return false;
+	}
+
+	Log(Log_Info,
+	    "Offscreen: %s, %s, %ux%u",
+	    (const char*)glGetString(GL_RENDERER),
+	    (const char*)glGetString(GL_VERSION),
+	    width,
+	    height);
+
+	return true;
+}
+
+internal void DestroyOffscreenContext(OffscreenContext* offscreen)
+{
+	glDeleteFramebuffers(1, &offscreen->framebuffer);
+	glDeleteRenderbuffers(1, &offscreen->colorBuffer);
+	glDeleteRenderbuffers(1, &offscreen->depthBuffer);
+
+	eglMakeCurrent(offscreen->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(offscreen->display, offscreen->context);
+	eglTerminate(offscreen->display);
+}
+
+//
+// NOTE(Charly): PNG, stored (uncompressed) deflate blocks: big files, but no dependency and the
+//               pixels are exactly what was rendered
+//
+
+internal uint32 UpdatePNGCrc(uint32 crc, const uint8* data, size_t size)
+{
+	local_persist uint32 table[256];
+	if (table[1] == 0)
+	{
+		for (uint32 n = 0; n < 256; ++n)
+		{
+			uint32 c = n;
+			for (uint32 k = 0; k < 8; ++k)
+			{
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+	}
+
+	for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+	{
+		crc = table[(crc ^ data[byteIdx]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+internal void WritePNGUint32(FILE* file, uint32 value, uint32* crc)
+{
+	uint8 bytes[4] = {(uint8)(value >> 24), (uint8)(value >> 16), (uint8)(value >> 8), (uint8)value};
+	fwrite(bytes, 1, 4, file);
+	if (crc)
+	{
+		*crc = UpdatePNGCrc(*crc, bytes, 4);
+	}
+}
+
+// NOTE(Charly): A chunk may be written in several parts, its size must be known upfront
+internal void BeginPNGChunk(FILE* file, const char* type, uint32 size, uint32* crc)
+{
+	WritePNGUint32(file, size, nullptr);
+	*crc = UpdatePNGCrc(0xFFFFFFFFu, (const uint8*)type, 4);
+	fwrite(type, 1, 4, file);
+}
+
+internal void WritePNGChunkData(FILE* file, const void* data, size_t size, uint32* crc)
+{
+	fwrite(data, 1, size, file);
+	*crc = UpdatePNGCrc(*crc, (const uint8*)data, size);
+}
+
+internal void EndPNGChunk(FILE* file, uint32 crc)
+{
+	WritePNGUint32(file, crc ^ 0xFFFFFFFFu, nullptr);
+}
+
+// NOTE(Charly): Rows are top-down RGBA
+internal bool32 WritePNG(const char* filename, uint32 width, uint32 height, const uint8* pixels)
+{
+	FILE* file = fopen(filename, "wb");
+	if (!file)
+	{
+		Log(Log_Error, "Could not open %s", filename);
+		return false;
+	}
+
+	const uint8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	fwrite(signature, 1, 8, file);
+
+	uint32 crc;
+	BeginPNGChunk(file, "IHDR", 13, &crc);
+	WritePNGUint32(file, width, &crc);
+	WritePNGUint32(file, height, &crc);
+	const uint8 format[5] = {8, 6, 0, 0, 0}; // NOTE(Charly): 8 bits RGBA, no interlacing
+	WritePNGChunkData(file, format, 5, &crc);
+	EndPNGChunk(file, crc);
+
+	// NOTE(Charly): zlib stream of stored blocks, each row prefixed with filter type 0
+	uint32 rowSize      = 4 * width + 1;
+	uint32 rawSize      = rowSize * height;
+	uint32 maxBlockSize = 65535;
+	uint32 nbBlocks     = (rawSize + maxBlockSize - 1) / maxBlockSize;
+	uint32 idatSize     = 2 + 5 * nbBlocks + rawSize + 4;
+
+	BeginPNGChunk(file, "IDAT", idatSize, &crc);
+	const uint8 zlibHeader[2] = {0x78, 0x01};
+	WritePNGChunkData(file, zlibHeader, 2, &crc);
+
+	uint32 adlerA = 1, adlerB = 0;
+	uint32 rawPos = 0;
+	for (uint32 blockIdx = 0; blockIdx < nbBlocks; ++blockIdx)
+	{
+		uint32 blockSize = std::min(maxBlockSize, rawSize - rawPos);
+		uint8  header[5] = {(uint8)(blockIdx + 1 == nbBlocks),
+                           (uint8)blockSize,
+                           (uint8)(blockSize >> 8),
+                           (uint8)~blockSize,
+                           (uint8)(~blockSize >> 8)};
+		WritePNGChunkData(file, header, 5, &crc);
+
+		for (uint32 blockEnd = rawPos + blockSize; rawPos < blockEnd;)
+		{
+			uint32 row       = rawPos / rowSize;
+			uint32 rowOffset = rawPos % rowSize;
+
+			const uint8* data;
+			uint32       size;
+			uint8        filter = 0;
+			if (rowOffset == 0)
+			{
+				data = &filter;
+				size = 1;
+			}
+			else
+			{
+				data = pixels + row * 4 * width + rowOffset - 1;
+				size = std::min(rowSize - rowOffset, blockEnd - rawPos);
+			}
+
+			WritePNGChunkData(file, data, size, &crc);
+			for (uint32 byteIdx = 0; byteIdx < size; ++byteIdx)
+			{
+				adlerA = (adlerA + data[byteIdx]) % 65521;
+				adlerB = (adlerB + adlerA) % 65521;
+			}
+			rawPos += size;
+		}
+	}
+
+	uint8 adler[4] = {(uint8)(adlerB >> 8), (uint8)adlerB, (uint8)(adlerA >> 8), (uint8)adlerA};
+	WritePNGChunkData(file, adler, 4, &crc);
+	EndPNGChunk(file, crc);
+
+	BeginPNGChunk(file, "IEND", 0, &crc);
+	EndPNGChunk(file, crc);
+
+	bool32 result = ferror(file) == 0;
+	fclose(file);
+	return result;
+}
+
+internal bool32 DumpFrame(const char* directory, uint32 frame, uint32 width, uint32 height, uint8* pixels)
+{
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	// NOTE(Charly): GL reads bottom-up
+	uint32 rowSize = 4 * width;
+	uint8* row     = pixels + rowSize * height; // NOTE(Charly): One spare row
+	for (uint32 y = 0; y < height / 2; ++y)
+	{
+		uint8* top    = pixels + y * rowSize;
+		uint8* bottom = pixels + (height - 1 - y) * rowSize;
+		memcpy(row, top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, row, rowSize);
+	}
+
+	char filename[512];
+	snprintf(filename, sizeof(filename), "%s/frame_%05u.png", directory, frame);
+	return WritePNG(filename, width, height, pixels);
+}
+
+internal void PrintFrameTimes(real64* frameTimes, uint32 nbFrames, real64 elapsed)
+{
+	if (nbFrames > 0)
+	{
+		std::sort(frameTimes, frameTimes + nbFrames);
+		printf("%u frames in %.3f s: %.1f fps\n", nbFrames, elapsed / 1000.0, nbFrames * 1000.0 / elapsed);
+		printf("frame ms: min %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+		       frameTimes[0],
+		       GetPercentile(frameTimes, nbFrames, 0.5),
+		       GetPercentile(frameTimes, nbFrames, 0.9),
+		       GetPercentile(frameTimes, nbFrames, 0.99),
+		       frameTimes[nbFrames - 1]);
+	}
+}
+
+// NOTE(Charly): Frame times are the submission of the recorded commands and the GPU work, the
+//               game and the CPU side of the renderer are not part of them anymore
+internal int PlayRenderCapture(const char* filename, uint32 width, uint32 height, const char* dumpDirectory,
+                               uint32 dumpEvery)
+{
+	RenderCommandStream capture;
+	if (!LoadRenderCapture(&capture, filename))
+	{
+		return 1;
+	}
+
+	OffscreenContext offscreen = {};
+	if (!CreateOffscreenContext(&offscreen, width, height))
+	{
+		FreeRenderCapture(&capture);
+		return 1;
+	}
+
+	uint32  nbFrames   = std::max(1u, capture.nbFrames);
+	real64* frameTimes = (real64*)PlatformAllocateMemory(nbFrames * sizeof(real64));
+	uint8*  pixels     = (uint8*)PlatformAllocateMemory(4 * width * (height + 1));
+	if (!frameTimes || !pixels)
+	{
+		return 1;
+	}
+
+	using Clock = std::chrono::steady_clock;
+	using Ms    = std::chrono::duration<real64, std::milli>;
+
+	RenderReplayer replayer;
+	BeginRenderReplay(&replayer);
+
+	uint32            frame = 0;
+	Clock::time_point start = Clock::now();
+	for (; frame < nbFrames; ++frame)
+	{
+		Clock::time_point frameStart = Clock::now();
+		if (!ReplayRenderFrame(&replayer, &capture))
+		{
+			break;
+		}
+		glFinish();
+		frameTimes[frame] = Ms(Clock::now() - frameStart).count();
+
+		if (dumpDirectory && frame % dumpEvery == 0)
+		{
+			DumpFrame(dumpDirectory, frame, width, height, pixels);
+		}
+	}
+	real64 elapsed = Ms(Clock::now() - start).count();
+
+	printf("replayed %s: %u commands, %.1f MB\n", filename, capture.nbCommands, capture.used / (1024.0 * 1024.0));
+	PrintFrameTimes(frameTimes, frame, elapsed);
+
+	EndRenderReplay(&replayer);
+	DestroyOffscreenContext(&offscreen);
+
+	PlatformFreeMemory(pixels, 4 * width * (height + 1));
+	PlatformFreeMemory(frameTimes, nbFrames * sizeof(real64));
+	FreeRenderCapture(&capture);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	uint32      nbFrames        = 600;
+	uint32      width           = 1440;
+	uint32      height          = 720;
+	uint32      seed            = 0;
+	uint32      nbThreads       = 0;
+	const char* replayFilename  = nullptr;
+	const char* dumpDirectory   = nullptr;
+	uint32      dumpEvery       = 1;
+	const char* statsFilename   = nullptr;
+	bool32      stressScene     = false;
+	bool32      nullRenderer    = false;
+	const char* captureFilename = nullptr;
+	const char* playFilename    = nullptr;
+	real64      frameCap        = 0.0;
+
+	StressSceneParams stressParams = {};
+	stressParams.botBehavior       = BotBehavior_Random;
+	for (int argIdx = 1; argIdx < argc; ++argIdx)
+	{
+		if (strcmp(argv[argIdx], "--frames") == 0 && argIdx + 1 < argc)
+		{
+			nbFrames = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--size") == 0 && argIdx + 2 < argc)
+		{
+			width  = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+			height = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--seed") == 0 && argIdx + 1 < argc)
+		{
+			seed = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--threads") == 0 && argIdx + 1 < argc)
+		{
+			nbThreads = (uint32)strtoul(argv[++argIdx], nullptr, 10);
+		}
+		else if (strcmp(argv[argIdx], "--replay") == 0 && argIdx + 1 < argc)
+		{
+			replayFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--dump-dir") == 0 && argIdx + 1 < argc)
+		{
+			dumpDirectory = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--dump-every") == 0 && argIdx + 1 < argc)
+		{
+			dumpEvery = std::max(1u, (uint32)strtoul(argv[++argIdx], nullptr, 10));
+		}
+		else if (strcmp(argv[argIdx], "--render-stats") == 0 && argIdx + 1 < argc)
+		{
+			statsFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--stress-scene") == 0 && argIdx + 1 < argc &&
+		         ParseStressSceneParams(argv[argIdx + 1], &stressParams))
+		{
+			stressScene = true;
+			++argIdx;
+		}
+		else if (strcmp(argv[argIdx], "--stress-patrol") == 0)
+		{
+			stressParams.botBehavior = BotBehavior_Patrol;
+		}
+		else if (strcmp(argv[argIdx], "--null-renderer") == 0)
+		{
+			nullRenderer = true;
+		}
+		else if (strcmp(argv[argIdx], "--capture") == 0 && argIdx + 1 < argc)
+		{
+			captureFilename = argv[++argIdx];
+			nullRenderer    = true;
+		}
+		else if (strcmp(argv[argIdx], "--play-capture") == 0 && argIdx + 1 < argc)
+		{
+			playFilename = argv[++argIdx];
+		}
+		else if (strcmp(argv[argIdx], "--frame-cap") == 0 && argIdx + 1 < argc)
+		{
+			// NOTE(Charly): To measure the pacing, and the CPU it saves
+			frameCap = strtod(argv[++argIdx], nullptr);
+		}
+		else
+		{
+			fprintf(stderr,
+			        "usage: %s [--frames N] [--size W H] [--seed N] [--threads N] [--replay file]\n"
+			        "          [--stress-scene platforms,bots,systems [--stress-patrol]]\n"
+			        "          [--dump-dir dir [--dump-every N]] [--render-stats file.csv]\n"
+			        "          [--null-renderer] [--capture file] [--play-capture file] [--frame-cap fps]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+
+	if (playFilename)
+	{
+		return PlayRenderCapture(playFilename, width, height, dumpDirectory, dumpEvery);
+	}
+
+	RenderCommandStream commands     = {};
+	size_t              commandsSize = captureFilename ? RENDER_CAPTURE_MEMORY_SIZE : NULL_RENDERER_MEMORY_SIZE;
+	OffscreenContext    offscreen    = {};
+	if (nullRenderer)
+	{
+		void* commandsMemory = PlatformAllocateMemory(commandsSize);
+		if (!commandsMemory)
+		{
+			return 1;
+		}
+		InitRenderCommandStream(&commands, commandsMemory, commandsSize);
+		SetRenderBackend(RenderBackend_Record, &commands);
+
+		// NOTE(Charly): Without a context, nothing to dump
+		dumpDirectory = nullptr;
+	}
+	else if (!CreateOffscreenContext(&offscreen, width, height))
+	{
+		return 1;
+	}
+
+	GameMemory gameMemory           = {};
+	gameMemory.permanentStorageSize = Megabytes(256);
+	gameMemory.transientStorageSize = Megabytes(128);
+
+	size_t totalSize = gameMemory.permanentStorageSize + gameMemory.transientStorageSize;
+	uint8* memory    = (uint8*)PlatformAllocateMemory(totalSize);
+	uint8* snapshotsMemory = (uint8*)PlatformAllocateMemory(RENDER_SNAPSHOTS_MEMORY_SIZE);
+	uint8* pixels          = (uint8*)PlatformAllocateMemory(4 * width * (height + 1));
+	if (!memory || !snapshotsMemory || !pixels)
+	{
+		return 1;
+	}
+	gameMemory.permanentStorage = memory;
+	gameMemory.transientStorage = memory + gameMemory.permanentStorageSize;
+
+	GameState* gameState     = InitGameMemory(&gameMemory);
+	gameState->viewportSize  = z::Vec2(width, height);
+	gameState->deterministic = true;
+	gameState->seed          = seed;
+
+	// NOTE(Charly): Replays are played a recorded frame per tick, always at the fixed dt
+	InputPlayback playback = {};
+	if (replayFilename && !BeginInputPlayback(&playback, replayFilename, gameState))
+	{
+		return 1;
+	}
+
+	InitJobSystem(nbThreads);
+
+	if (statsFilename)
+	{
+		BeginRenderStatsCapture(statsFilename);
+	}
+
+	InitGame(gameState);
+	if (stressScene)
+	{
+		stressParams.seed = gameState->seed;
+		GenerateStressScene(gameState, &stressParams);
+	}
+	EndFrameMemory();
+
+	RenderSnapshotBuffer snapshots;
+	InitRenderSnapshotBuffer(&snapshots, snapshotsMemory, RENDER_SNAPSHOTS_MEMORY_SIZE);
+
+	z::RandomSeries script = z::SeedRandomSeries(gameState->seed ^ 0x5c71b07u);
+
+	real64* frameTimes = (real64*)PlatformAllocateMemory(std::max(1u, nbFrames) * sizeof(real64));
+	if (!frameTimes)
+	{
+		return 1;
+	}
+
+	using Clock = std::chrono::steady_clock;
+	using Ms    = std::chrono::duration<real64, std::milli>;
+
+	FramePacer pacer;
+	InitFramePacer(&pacer, frameCap > 0.0 ? FramePacing_Cap : FramePacing_Off, frameCap);
+
+	uint32            frame    = 0;
+	std::clock_t      cpuStart = std::clock();
+	Clock::time_point start    = Clock::now();
+	for (; frame < nbFrames; ++frame)
+	{
+		BeginPacedFrame(&pacer);
+		Clock::time_point frameStart = Clock::now();
+
+		if (nullRenderer && !captureFilename)
+		{
+			RewindRenderCommandStream(&commands, 0);
+		}
+
+		InputState input = gameState->inputState;
+		if (replayFilename)
+		{
+			real32 recordedDt;
+			if (!PlaybackInputFrame(&playback, &input, &recordedDt))
+			{
+				break;
+			}
+		}
+		else
+		{
+			ScriptInput(&script, gameState->tick, gameState->viewportSize, &input);
+		}
+
+		StepGame(gameState, &input, gameState->fixedDt);
+
+		BuildRenderSnapshot(gameState, GetRenderSnapshotToWrite(&snapshots));
+		PublishRenderSnapshot(&snapshots);
+		RenderGame(gameState, AcquireRenderSnapshot(&snapshots), gameState->fixedDt);
+
+		// NOTE(Charly): Without a swap, nothing else says when the GPU is done
+		if (!nullRenderer)
+		{
+			glFinish();
+		}
+		frameTimes[frame] = Ms(Clock::now() - frameStart).count();
+		EndPacedFrame(&pacer);
+
+		if (dumpDirectory && frame % dumpEvery == 0)
+		{
+			DumpFrame(dumpDirectory, frame, width, height, pixels);
+		}
+
+		EndFrameMemory();
+		EndJobsFrame();
+	}
+	real64 elapsed = Ms(Clock::now() - start).count();
+	real64 cpuTime = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+	PrintFrameTimes(frameTimes, frame, elapsed);
+	if (pacer.mode == FramePacing_Cap)
+	{
+		FramePacingStats pacing;
+		GetFramePacingStats(&pacer, &pacing);
+		printf("pacing: present %.3f ms (std dev %.3f, min %.3f, max %.3f), sleep %.3f ms, spin %.3f ms\n",
+		       pacing.meanPresentInterval,
+		       pacing.presentIntervalStdDev,
+		       pacing.minPresentInterval,
+		       pacing.maxPresentInterval,
+		       pacing.meanSleep,
+		       pacing.meanSpin);
+	}
+	printf("cpu: %.1f%% of a core\n", 100.0 * cpuTime / elapsed);
+	printf("checksum: %016llx\n", (unsigned long long)gameState->checksum);
+
+	if (captureFilename)
+	{
+		printf("captured %u frames, %u commands, %.1f MB\n",
+		       commands.nbFrames,
+		       commands.nbCommands,
+		       commands.used / (1024.0 * 1024.0));
+		SaveRenderCapture(&commands, captureFilename);
+	}
+
+	EndRenderStatsCapture();
+	EndInputPlayback(&playback);
+	ShutdownJobSystem();
+	if (nullRenderer)
+	{
+		PlatformFreeMemory(commands.base, commandsSize);
+	}
+	else
+	{
+		DestroyOffscreenContext(&offscreen);
+	}
+
+	PlatformFreeMemory(frameTimes, std::max(1u, nbFrames) * sizeof(real64));
+	PlatformFreeMemory(pixels, 4 * width * (height + 1));
+	PlatformFreeMemory(snapshotsMemory, RENDER_SNAPSHOTS_MEMORY_SIZE);
+	PlatformFreeMemory(memory, totalSize);
+
+	return 0;
+}
@@ -6,6 +6,7 @@
 #include "relwarb_debug.h"
 #include "relwarb_defines.h"
 #include "relwarb_entity.h"
+#include "relwarb_profiler.h"
 
 #define SEPARATOR " \t"
 
@@ -85,6 +86,8 @@ void ExtractUint8(std::string& line, uint8& extract)
 
 bool LoadMapFile(GameState * gameState, const char* mapfile)
 {
+    TIMED_FUNCTION();
+
     std::ifstream ini;
     ini.open(mapfile);
 
@@ -0,0 +1,108 @@
+#include "relwarb_platform.h"
+
+#include "relwarb_debug.h"
+
+#if defined(OS_LINUX) || defined(OS_MACOS)
+#include <sys/mman.h>
+#endif
+
+#if defined(OS_WINDOWS)
+void* PlatformAllocateMemory(size_t size, bool32 useLargePages)
+{
+	void* result = nullptr;
+
+	if (useLargePages)
+	{
+		// NOTE(Charly): Needs the SeLockMemoryPrivilege, which most accounts do not have
+		size_t largePageSize = GetLargePageMinimum();
+		if (largePageSize)
+		{
+			size_t largeSize = (size + largePageSize - 1) & ~(largePageSize - 1);
+			result           = VirtualAlloc(nullptr,
+			                                largeSize,
+			                                MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			                                PAGE_READWRITE);
+		}
+
+		if (!result)
+		{
+			Log(Log_Warning, "Large pages unavailable, falling back to regular pages");
+		}
+	}
+
+	if (!result)
+	{
+		result = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	return result;
+}
+
+void PlatformFreeMemory(void* memory, size_t size)
+{
+	if (memory)
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+	}
+}
+#else
+// NOTE(Charly): Sizes are rounded to the huge page size whatever the page size actually used,
+//               so that PlatformFreeMemory does not need to know which one we got.
+internal size_t RoundToHugePageSize(size_t size)
+{
+	const size_t hugePageSize = 2 * 1024 * 1024;
+	size_t       result       = (size + hugePageSize - 1) & ~(hugePageSize - 1);
+	return result;
+}
+
+void* PlatformAllocateMemory(size_t size, bool32 useLargePages)
+{
+	void* result = MAP_FAILED;
+	size         = RoundToHugePageSize(size);
+
+#if defined(MAP_HUGETLB)
+	if (useLargePages)
+	{
+		// NOTE(Charly): Explicit huge pages must have been reserved by the admin (vm.nr_hugepages)
+		result = mmap(nullptr,
+		              size,
+		              PROT_READ | PROT_WRITE,
+		              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+		              -1,
+		              0);
+		if (result == MAP_FAILED)
+		{
+			Log(Log_Warning, "Huge pages unavailable, falling back to regular pages");
+		}
+	}
+#endif
+
+	if (result == MAP_FAILED)
+	{
+		result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (result == MAP_FAILED)
+		{
+			Log(Log_Error, "Could not allocate %zu bytes", size);
+			return nullptr;
+		}
+
+#if defined(MADV_HUGEPAGE)
+		// NOTE(Charly): Transparent huge pages are the next best thing
+		if (useLargePages)
+		{
+			madvise(result, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	return result;
+}
+
+void PlatformFreeMemory(void* memory, size_t size)
+{
+	if (memory)
+	{
+		munmap(memory, RoundToHugePageSize(size));
+	}
+}
+#endif
@@ -1,9 +1,18 @@
 #ifndef RELWARB_PLATFORM_H
 #define RELWARB_PLATFORM_H
 
+#include <stddef.h>
+
+#include "relwarb_defines.h"
+
 // NOTE(Charly): Platform-specific functions that will be 
 //               used outside of the platform layer.
 
+// NOTE(Charly): Zero-initialized, page aligned memory. With useLargePages, huge pages are tried
+//               first and we silently fall back to regular pages if the system refuses them.
+void* PlatformAllocateMemory(size_t size, bool32 useLargePages = false);
+void  PlatformFreeMemory(void* memory, size_t size);
+
 // TODO(Charly): List files in a directory
 // TODO(Charly): Open file dialog
 // TODO(Charly): Save file dialog
@@ -0,0 +1,404 @@
+#include "relwarb_profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <string.h>
+
+#include "relwarb_debug.h"
+#include "relwarb_platform.h"
+#include "relwarb_trace.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#define MAX_PROFILE_DEPTH 32
+
+struct ProfilerThread
+{
+	const char* name;
+	uint32      index;
+
+	// NOTE(Charly): Only touched by the profiled thread
+	ProfilerFrame current;
+	uint32        stack[MAX_PROFILE_DEPTH];
+	uint32        depth;
+
+	// NOTE(Charly): Finished frames, the profiled thread only takes the lock to copy one in
+	std::mutex    historyMutex;
+	ProfilerFrame history[PROFILER_HISTORY];
+	uint32        nbFrames;
+};
+
+struct Profiler
+{
+	ProfilerThread*     threads[MAX_PROFILER_THREADS];
+	std::atomic<uint32> nbThreads;
+
+	// NOTE(Charly): The time stamp counter runs at a fixed rate on anything recent, its
+	//               frequency is measured against the steady clock since the first registration
+	std::once_flag                        calibrationFlag;
+	uint64                                calibrationTicks;
+	std::chrono::steady_clock::time_point calibrationTime;
+};
+
+global_variable Profiler g_profiler;
+
+thread_local ProfilerThread* t_profilerThread = nullptr;
+
+uint64 GetProfilerTicks()
+{
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+	uint64 result = __rdtsc();
+#else
+	uint64 result = (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                    std::chrono::steady_clock::now().time_since_epoch())
+	                    .count();
+#endif
+	return result;
+}
+
+real64 GetProfilerTicksPerMs()
+{
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+	uint64 ticks   = GetProfilerTicks() - g_profiler.calibrationTicks;
+	real64 elapsed = std::chrono::duration<real64, std::milli>(std::chrono::steady_clock::now() -
+	                                                           g_profiler.calibrationTime)
+	                     .count();
+	real64 result = elapsed > 0.0 ? ticks / elapsed : 1e6;
+#else
+	real64 result = 1e6;
+#endif
+	return result;
+}
+
+void RegisterProfilerThread(const char* name)
+{
+	std::call_once(g_profiler.calibrationFlag, []() {
+		g_profiler.calibrationTime  = std::chrono::steady_clock::now();
+		g_profiler.calibrationTicks = GetProfilerTicks();
+	});
+
+	uint32 threadIdx = g_profiler.nbThreads.load(std::memory_order_relaxed);
+	if (threadIdx >= MAX_PROFILER_THREADS || t_profilerThread)
+	{
+		Log(Log_Warning, "Profiler: could not register thread %s", name);
+		return;
+	}
+
+	// NOTE(Charly): Lives until the end of the program, reports may be asked for at any time
+	void* memory = PlatformAllocateMemory(sizeof(ProfilerThread));
+	if (!memory)
+	{
+		return;
+	}
+
+	// NOTE(Charly): Threads register once, at startup, a lost race only loses the slot
+	threadIdx = g_profiler.nbThreads.fetch_add(1, std::memory_order_relaxed);
+	if (threadIdx < MAX_PROFILER_THREADS)
+	{
+		ProfilerThread* thread        = new (memory) ProfilerThread();
+		thread->name                  = name;
+		thread->index                 = threadIdx;
+		t_profilerThread              = thread;
+		g_profiler.threads[threadIdx] = thread;
+	}
+	else
+	{
+		PlatformFreeMemory(memory, sizeof(ProfilerThread));
+	}
+}
+
+uint32 BeginProfileBlock(const char* name)
+{
+	ProfilerThread* thread = t_profilerThread;
+	if (!thread)
+	{
+		return NOT_A_PROFILE_BLOCK;
+	}
+
+	uint32 result = NOT_A_PROFILE_BLOCK;
+	if (thread->current.nbBlocks < MAX_PROFILE_BLOCKS && thread->depth < MAX_PROFILE_DEPTH)
+	{
+		result              = thread->current.nbBlocks++;
+		ProfileBlock* block = thread->current.blocks + result;
+		block->name         = name;
+		block->parent       = thread->depth ? thread->stack[thread->depth - 1] : NOT_A_PROFILE_BLOCK;
+		block->end          = 0;
+
+		thread->stack[thread->depth++] = result;
+
+		// NOTE(Charly): Last, so that the bookkeeping is not timed
+		block->begin = GetProfilerTicks();
+	}
+
+	return result;
+}
+
+void EndProfileBlock(uint32 blockIdx)
+{
+	if (blockIdx == NOT_A_PROFILE_BLOCK)
+	{
+		return;
+	}
+
+	uint64          ticks  = GetProfilerTicks();
+	ProfilerThread* thread = t_profilerThread;
+
+	thread->current.blocks[blockIdx].end = ticks;
+
+	Assert(thread->depth > 0 && thread->stack[thread->depth - 1] == blockIdx);
+	--thread->depth;
+}
+
+void SetProfileCounter(const char* name, real64 value)
+{
+	ProfilerThread* thread = t_profilerThread;
+	if (!thread)
+	{
+		return;
+	}
+
+	ProfilerFrame* frame = &thread->current;
+	for (uint32 counterIdx = 0; counterIdx < frame->nbCounters; ++counterIdx)
+	{
+		if (frame->counters[counterIdx].name == name)
+		{
+			frame->counters[counterIdx].value = value;
+			return;
+		}
+	}
+
+	if (frame->nbCounters < MAX_PROFILE_COUNTERS)
+	{
+		frame->counters[frame->nbCounters++] = {name, value};
+	}
+}
+
+void BeginProfilerFrame()
+{
+	ProfilerThread* thread = t_profilerThread;
+	if (thread)
+	{
+		thread->current.nbBlocks   = 0;
+		thread->current.nbCounters = 0;
+		thread->depth              = 0;
+		thread->current.begin      = GetProfilerTicks();
+	}
+}
+
+// NOTE(Charly): Only the blocks in use
+void CopyProfilerFrame(ProfilerFrame* dest, const ProfilerFrame* source)
+{
+	dest->index      = source->index;
+	dest->begin      = source->begin;
+	dest->end        = source->end;
+	dest->nbCounters = source->nbCounters;
+	dest->nbBlocks   = source->nbBlocks;
+	memcpy(dest->counters, source->counters, source->nbCounters * sizeof(ProfileCounter));
+	memcpy(dest->blocks, source->blocks, source->nbBlocks * sizeof(ProfileBlock));
+}
+
+void EndProfilerFrame()
+{
+	ProfilerThread* thread = t_profilerThread;
+	if (!thread)
+	{
+		return;
+	}
+
+	thread->current.end = GetProfilerTicks();
+
+	// NOTE(Charly): Blocks still open (the frame ended inside a scope) end with the frame
+	for (uint32 blockIdx = 0; blockIdx < thread->current.nbBlocks; ++blockIdx)
+	{
+		if (thread->current.blocks[blockIdx].end == 0)
+		{
+			thread->current.blocks[blockIdx].end = thread->current.end;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(thread->historyMutex);
+		thread->current.index = thread->nbFrames;
+		ProfilerFrame* frame  = thread->history + thread->nbFrames % PROFILER_HISTORY;
+		CopyProfilerFrame(frame, &thread->current);
+		++thread->nbFrames;
+	}
+
+	SubmitTraceFrame(thread->index, thread->name, &thread->current);
+}
+
+uint32 GetProfilerThreadIndex()
+{
+	uint32 result = t_profilerThread ? t_profilerThread->index : NOT_A_PROFILE_BLOCK;
+	return result;
+}
+
+uint32 GetProfilerThreadCount()
+{
+	uint32 result = g_profiler.nbThreads.load(std::memory_order_acquire);
+	result        = result < MAX_PROFILER_THREADS ? result : MAX_PROFILER_THREADS;
+	return result;
+}
+
+// NOTE(Charly): A node of the report is a block name under a given parent node
+struct ProfileAccumulator
+{
+	const char* name;
+	uint32      parent;
+	uint32      depth;
+
+	uint64 frameTicks;
+	uint32 frameCalls;
+
+	uint32 nbFrames;
+	uint32 nbCalls;
+	uint64 minTicks;
+	uint64 maxTicks;
+	uint64 totalTicks;
+};
+
+internal uint32 FindOrAddProfileNode(ProfileAccumulator* nodes,
+                                     uint32*             nbNodes,
+                                     const char*         name,
+                                     uint32              parent)
+{
+	for (uint32 nodeIdx = 0; nodeIdx < *nbNodes; ++nodeIdx)
+	{
+		if (nodes[nodeIdx].name == name && nodes[nodeIdx].parent == parent)
+		{
+			return nodeIdx;
+		}
+	}
+
+	uint32 result = NOT_A_PROFILE_BLOCK;
+	if (*nbNodes < MAX_PROFILE_NODES)
+	{
+		result                  = (*nbNodes)++;
+		ProfileAccumulator* acc = nodes + result;
+		*acc                    = {};
+		acc->name               = name;
+		acc->parent             = parent;
+		acc->depth              = parent == NOT_A_PROFILE_BLOCK ? 0 : nodes[parent].depth + 1;
+		acc->minTicks           = UINT64_MAX;
+	}
+
+	return result;
+}
+
+internal void EmitProfileNodes(const ProfileAccumulator* nodes,
+                               uint32                    nbNodes,
+                               uint32                    parent,
+                               real64                    ticksPerMs,
+                               ProfilerReport*           report)
+{
+	for (uint32 nodeIdx = 0; nodeIdx < nbNodes; ++nodeIdx)
+	{
+		const ProfileAccumulator* acc = nodes + nodeIdx;
+		if (acc->parent != parent || acc->nbFrames == 0)
+		{
+			continue;
+		}
+
+		ProfileNode* node = report->nodes + report->nbNodes++;
+		node->name        = acc->name;
+		node->depth       = acc->depth;
+		node->calls       = (real32)acc->nbCalls / acc->nbFrames;
+		node->min         = (real32)(acc->minTicks / ticksPerMs);
+		node->avg         = (real32)(acc->totalTicks / ticksPerMs / acc->nbFrames);
+		node->max         = (real32)(acc->maxTicks / ticksPerMs);
+
+		EmitProfileNodes(nodes, nbNodes, nodeIdx, ticksPerMs, report);
+	}
+}
+
+void GetProfilerReport(uint32 threadIdx, ProfilerReport* report)
+{
+	*report = {};
+	if (threadIdx >= GetProfilerThreadCount() || !g_profiler.threads[threadIdx])
+	{
+		return;
+	}
+
+	ProfilerThread* thread = g_profiler.threads[threadIdx];
+	report->threadName     = thread->name;
+
+	ProfileAccumulator nodes[MAX_PROFILE_NODES];
+	uint32             nbNodes = 0;
+	uint32             blockNodes[MAX_PROFILE_BLOCKS];
+
+	uint64 frameMin   = UINT64_MAX;
+	uint64 frameMax   = 0;
+	uint64 frameTotal = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(thread->historyMutex);
+
+		uint32 nbFrames  = thread->nbFrames < PROFILER_HISTORY ? thread->nbFrames : PROFILER_HISTORY;
+		report->nbFrames = nbFrames;
+		for (uint32 frameIdx = thread->nbFrames - nbFrames; frameIdx < thread->nbFrames; ++frameIdx)
+		{
+			const ProfilerFrame* frame = thread->history + frameIdx % PROFILER_HISTORY;
+
+			uint64 frameTicks = frame->end - frame->begin;
+			frameMin          = frameTicks < frameMin ? frameTicks : frameMin;
+			frameMax          = frameTicks > frameMax ? frameTicks : frameMax;
+			frameTotal += frameTicks;
+
+			// NOTE(Charly): A block called several times in a frame counts as one, with the sum
+			//               of its durations
+			for (uint32 blockIdx = 0; blockIdx < frame->nbBlocks; ++blockIdx)
+			{
+				const ProfileBlock* block  = frame->blocks + blockIdx;
+				uint32              parent = block->parent == NOT_A_PROFILE_BLOCK
+				                                 ? NOT_A_PROFILE_BLOCK
+				                                 : blockNodes[block->parent];
+				uint32 nodeIdx = NOT_A_PROFILE_BLOCK;
+				if (block->parent == NOT_A_PROFILE_BLOCK || parent != NOT_A_PROFILE_BLOCK)
+				{
+					nodeIdx = FindOrAddProfileNode(nodes, &nbNodes, block->name, parent);
+				}
+				blockNodes[blockIdx] = nodeIdx;
+
+				if (nodeIdx != NOT_A_PROFILE_BLOCK)
+				{
+					nodes[nodeIdx].frameTicks += block->end - block->begin;
+					++nodes[nodeIdx].frameCalls;
+				}
+			}
+
+			for (uint32 nodeIdx = 0; nodeIdx < nbNodes; ++nodeIdx)
+			{
+				ProfileAccumulator* acc = nodes + nodeIdx;
+				if (acc->frameCalls > 0)
+				{
+					acc->minTicks = acc->frameTicks < acc->minTicks ? acc->frameTicks : acc->minTicks;
+					acc->maxTicks = acc->frameTicks > acc->maxTicks ? acc->frameTicks : acc->maxTicks;
+					acc->totalTicks += acc->frameTicks;
+					acc->nbCalls += acc->frameCalls;
+					++acc->nbFrames;
+
+					acc->frameTicks = 0;
+					acc->frameCalls = 0;
+				}
+			}
+		}
+	}
+
+	if (report->nbFrames == 0)
+	{
+		return;
+	}
+
+	real64 ticksPerMs = GetProfilerTicksPerMs();
+	report->frameMin  = (real32)(frameMin / ticksPerMs);
+	report->frameAvg  = (real32)(frameTotal / ticksPerMs / report->nbFrames);
+	report->frameMax  = (real32)(frameMax / ticksPerMs);
+
+	EmitProfileNodes(nodes, nbNodes, NOT_A_PROFILE_BLOCK, ticksPerMs, report);
+}
@@ -0,0 +1,132 @@
+#ifndef RELWARB_PROFILER_H
+#define RELWARB_PROFILER_H
+
+#include "relwarb_defines.h"
+
+// NOTE(Charly): Hierarchical CPU profiler. Scoped timers record blocks in the current frame of
+//               their thread, and every finished frame goes in a ring buffer of the last
+//               PROFILER_HISTORY frames, from which reports (min/avg/max per block) are built.
+//
+//               Only threads that called RegisterProfilerThread record anything, on the other
+//               ones (job workers...) a timer costs a thread local read. Blocks inside jobs are
+//               not recorded, time the code that runs the jobs instead.
+//
+//               Building without RELWARB_PROFILER compiles all the timers out.
+
+#define PROFILER_HISTORY 64
+#define MAX_PROFILE_BLOCKS 512 // NOTE(Charly): Per frame, blocks past that are dropped
+#define MAX_PROFILE_NODES 64   // NOTE(Charly): Distinct (parent, name) pairs in a report
+#define MAX_PROFILE_COUNTERS 16
+#define MAX_PROFILER_THREADS 8
+
+#define NOT_A_PROFILE_BLOCK 0xFFFFFFFF
+
+struct ProfileBlock
+{
+	const char* name;
+	uint64      begin;
+	uint64      end;
+	uint32      parent;
+};
+
+// NOTE(Charly): A value sampled once per frame (entities, draw calls...)
+struct ProfileCounter
+{
+	const char* name;
+	real64      value;
+};
+
+struct ProfilerFrame
+{
+	uint32 index;
+	uint64 begin;
+	uint64 end;
+
+	uint32         nbCounters;
+	ProfileCounter counters[MAX_PROFILE_COUNTERS];
+
+	uint32       nbBlocks;
+	ProfileBlock blocks[MAX_PROFILE_BLOCKS];
+};
+
+// NOTE(Charly): Time stamps of the blocks
+uint64 GetProfilerTicks();
+real64 GetProfilerTicksPerMs();
+
+// NOTE(Charly): Only copies the blocks and counters in use
+void CopyProfilerFrame(ProfilerFrame* dest, const ProfilerFrame* source);
+
+// NOTE(Charly): name must be a string literal (or live as long as the program), blocks are
+//               told apart by their name pointer and their parent
+uint32 BeginProfileBlock(const char* name);
+void   EndProfileBlock(uint32 blockIdx);
+
+// NOTE(Charly): Same name rules as the blocks. Setting a counter twice in a frame keeps the last value.
+void SetProfileCounter(const char* name, real64 value);
+
+struct ProfileScope
+{
+	uint32 blockIdx;
+
+	ProfileScope(const char* name) : blockIdx(BeginProfileBlock(name)) {}
+	~ProfileScope() { EndProfileBlock(blockIdx); }
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#if defined(RELWARB_PROFILER)
+#define TIMED_BLOCK(name) ProfileScope PROFILER_CONCAT(profileScope_, __LINE__)(name)
+#define TIMED_FUNCTION() TIMED_BLOCK(__FUNCTION__)
+// NOTE(Charly): For blocks that do not match a scope
+#define BEGIN_TIMED_BLOCK(id) uint32 profileBlock_##id = BeginProfileBlock(#id)
+#define END_TIMED_BLOCK(id) EndProfileBlock(profileBlock_##id)
+#define PROFILE_COUNTER(name, value) SetProfileCounter(name, value)
+#else
+#define TIMED_BLOCK(name)
+#define TIMED_FUNCTION()
+#define BEGIN_TIMED_BLOCK(id)
+#define END_TIMED_BLOCK(id)
+#define PROFILE_COUNTER(name, value)
+#endif
+
+// NOTE(Charly): The calling thread starts recording. Frames are delimited by the thread itself.
+void RegisterProfilerThread(const char* name);
+void BeginProfilerFrame();
+void EndProfilerFrame();
+
+// NOTE(Charly): Registration index, NOT_A_PROFILE_BLOCK when the thread is not profiled
+uint32 GetProfilerThreadIndex();
+
+struct ProfileNode
+{
+	const char* name;
+	uint32      depth;
+	real32      calls; // NOTE(Charly): Per frame, on average
+
+	// NOTE(Charly): Milliseconds per frame, over the frames the block showed up in
+	real32 min;
+	real32 avg;
+	real32 max;
+};
+
+struct ProfilerReport
+{
+	const char* threadName;
+	uint32      nbFrames;
+
+	real32 frameMin;
+	real32 frameAvg;
+	real32 frameMax;
+
+	// NOTE(Charly): Depth first, children after their parent
+	ProfileNode nodes[MAX_PROFILE_NODES];
+	uint32      nbNodes;
+};
+
+// NOTE(Charly): Can be called from any thread, takes the lock of the profiled thread for the
+//               time of a copy
+uint32 GetProfilerThreadCount();
+void   GetProfilerReport(uint32 threadIdx, ProfilerReport* report);
+
+#endif // RELWARB_PROFILER_H
@@ -0,0 +1,929 @@
+#include "relwarb_render_commands.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "relwarb_debug.h"
+#include "relwarb_platform.h"
+#include "relwarb_renderer.h"
+
+#define RENDER_CAPTURE_MAGIC 0x43525752 // 'RWRC'
+#define RENDER_CAPTURE_VERSION 1
+
+struct RenderCaptureHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint32 nbFrames;
+    uint32 nbCommands;
+    uint64 size;
+};
+
+enum RenderCommandType
+{
+    RenderCommand_Viewport,
+    RenderCommand_Clear,
+    RenderCommand_Capability,
+    RenderCommand_DepthFunc,
+    RenderCommand_BlendFunc,
+    RenderCommand_UseProgram,
+    RenderCommand_BindTexture,
+    RenderCommand_CreateTexture,
+    RenderCommand_DeleteTexture,
+    RenderCommand_DrawMesh,
+    RenderCommand_DrawParticles,
+    RenderCommand_EndFrame,
+};
+
+// NOTE(Charly): size covers the command, its data and the padding to the next command
+struct RenderCommand
+{
+    uint32 type;
+    uint32 size;
+};
+
+#define RENDER_COMMAND_ALIGNMENT 8
+
+struct ViewportCommand
+{
+    RenderCommand header;
+    int32 x, y, width, height;
+};
+
+struct ClearCommand
+{
+    RenderCommand header;
+    real32 color[4];
+};
+
+struct CapabilityCommand
+{
+    RenderCommand header;
+    GLenum capability;
+    bool32 enabled;
+};
+
+struct DepthFuncCommand
+{
+    RenderCommand header;
+    GLenum func;
+};
+
+struct BlendFuncCommand
+{
+    RenderCommand header;
+    GLenum srcFactor;
+    GLenum dstFactor;
+};
+
+// NOTE(Charly): Bind and delete commands
+struct ObjectCommand
+{
+    RenderCommand header;
+    GLuint object;
+};
+
+// NOTE(Charly): Followed by the pixels, if any
+struct CreateTextureCommand
+{
+    RenderCommand header;
+    GLuint texture;
+    uint32 width, height;
+    GLenum format;
+    GLenum minFilter;
+    GLenum wrap;
+    bool32 hasPixels;
+};
+
+// NOTE(Charly): Followed by the vertices, then the indices
+struct DrawMeshCommand
+{
+    RenderCommand header;
+    real32 color[4];
+    uint32 nbVertices;
+    uint32 nbIndices;
+};
+
+// NOTE(Charly): Followed by the positions and sizes, then the colors
+struct DrawParticlesCommand
+{
+    RenderCommand header;
+    real32 worldSize[2];
+    uint32 nbParticles;
+};
+
+struct EndFrameCommand
+{
+    RenderCommand header;
+    uint32 frame;
+};
+
+global_variable RenderBackend g_renderBackend;
+global_variable RenderCommandStream* g_renderStream;
+global_variable GLuint g_nbRecordedTextures;
+
+// NOTE(Charly): Program bound with the GL backend, for the uniforms of the draws
+global_variable GLuint g_submitProgram;
+
+global_variable const GLfloat g_particleBillboard[] =
+{
+    -0.5f, -0.5f, 0.f, 0.f,
+     0.5f, -0.5f, 1.f, 0.f,
+    -0.5f,  0.5f, 0.f, 1.f,
+     0.5f,  0.5f, 1.f, 1.f,
+};
+
+void InitRenderCommandStream(RenderCommandStream* stream, void* memory, size_t size)
+{
+    *stream = {};
+    stream->base = (uint8*)memory;
+    stream->size = size;
+}
+
+void RewindRenderCommandStream(RenderCommandStream* stream, size_t offset)
+{
+    Assert(offset <= stream->used);
+
+    // NOTE(Charly): Counts are only kept for whole streams
+    if (offset == 0)
+    {
+        stream->nbCommands = 0;
+        stream->nbFrames = 0;
+    }
+    stream->used = offset;
+    stream->overflowed = false;
+}
+
+void SetRenderBackend(RenderBackend backend, RenderCommandStream* stream)
+{
+    Assert(backend != RenderBackend_Record || stream);
+
+    g_renderBackend = backend;
+    g_renderStream = stream;
+    g_nbRecordedTextures = 0;
+}
+
+RenderBackend GetRenderBackend()
+{
+    return g_renderBackend;
+}
+
+internal bool32 IsRecording()
+{
+    bool32 result = g_renderBackend == RenderBackend_Record;
+    return result;
+}
+
+// NOTE(Charly): Returns nullptr when the command does not fit, its data starts right after it
+template <typename T>
+internal T* PushRenderCommand(RenderCommandType type, size_t dataSize = 0)
+{
+    RenderCommandStream* stream = g_renderStream;
+
+    size_t size = sizeof(T) + dataSize;
+    size = (size + RENDER_COMMAND_ALIGNMENT - 1) & ~(size_t)(RENDER_COMMAND_ALIGNMENT - 1);
+    if (stream->used + size > stream->size)
+    {
+        if (!stream->overflowed)
+        {
+            Log(Log_Warning, "Render command stream full (%zu bytes), dropping commands", stream->size);
+            stream->overflowed = true;
+        }
+        return nullptr;
+    }
+
+    T* result = (T*)(stream->base + stream->used);
+    result->header.type = type;
+    result->header.size = (uint32)size;
+
+    stream->used += size;
+    ++stream->nbCommands;
+
+    return result;
+}
+
+template <typename T>
+internal uint8* GetCommandData(T* command)
+{
+    uint8* result = (uint8*)(command + 1);
+    return result;
+}
+
+template <typename T>
+internal const uint8* GetCommandData(const T* command)
+{
+    const uint8* result = (const uint8*)(command + 1);
+    return result;
+}
+
+internal size_t GetTextureSize(uint32 width, uint32 height, GLenum format)
+{
+    size_t result = (size_t)width * height * (format == GL_R8 ? 1 : 4);
+    return result;
+}
+
+// NOTE(Charly): GL side of the commands, shared by the GL backend and the replay
+
+internal void ExecuteClear(const real32* color)
+{
+    glClearColor(color[0], color[1], color[2], color[3]);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+internal void ExecuteCapability(GLenum capability, bool32 enabled)
+{
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+internal void ExecuteCreateTexture(GLuint texture, uint32 width, uint32 height, GLenum format,
+                                   GLenum minFilter, GLenum wrap, const void* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format,
+                 width, height,
+                 0, format == GL_R8 ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+internal void ExecuteDrawMesh(GLuint program, const real32* color, const Vertex* vertices, uint32 nbVertices,
+                              const GLuint* indices, uint32 nbIndices)
+{
+    GLuint vao = 0, vbo = 0, ibo = 0;
+    glGenVertexArrays(1, &vao);
+
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, nbVertices * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+
+    GLint64 ptr = 0;
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)ptr);
+    glEnableVertexAttribArray(0);
+    ptr += 2 * sizeof(GLfloat);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)ptr);
+    glEnableVertexAttribArray(1);
+
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nbIndices * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "u_tex"), 0);
+    glUniform4fv(glGetUniformLocation(program, "u_color"), 1, color);
+
+    glDrawElements(GL_TRIANGLES, nbIndices, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+internal void ExecuteDrawParticles(GLuint program, const real32* worldSize, const z::vec4* positionsSizes,
+                                   const z::vec4* colors, uint32 nbParticles)
+{
+    enum BufferIndex
+    {
+        BufferIndex_Billboard = 0,
+        BufferIndex_PosSize,
+        BufferIndex_Color,
+        BufferIndex_Count,
+    };
+
+    GLuint vao;
+    GLuint buffers[BufferIndex_Count];
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(BufferIndex_Count, buffers);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_Billboard]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(g_particleBillboard), g_particleBillboard, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_PosSize]);
+    glBufferData(GL_ARRAY_BUFFER, nbParticles * sizeof(z::vec4), positionsSizes, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_Color]);
+    glBufferData(GL_ARRAY_BUFFER, nbParticles * sizeof(z::vec4), colors, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, 0);
+
+    glVertexAttribDivisor(0, 0);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
+
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "u_tex"), 0);
+    glUniform2f(glGetUniformLocation(program, "u_worldSize"), worldSize[0], worldSize[1]);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, nbParticles);
+
+    glDeleteBuffers(BufferIndex_Count, buffers);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void SubmitViewport(int32 x, int32 y, int32 width, int32 height)
+{
+    if (IsRecording())
+    {
+        ViewportCommand* command = PushRenderCommand<ViewportCommand>(RenderCommand_Viewport);
+        if (command)
+        {
+            command->x = x;
+            command->y = y;
+            command->width = width;
+            command->height = height;
+        }
+    }
+    else
+    {
+        glViewport(x, y, width, height);
+    }
+}
+
+void SubmitClear(z::vec4 color)
+{
+    if (IsRecording())
+    {
+        ClearCommand* command = PushRenderCommand<ClearCommand>(RenderCommand_Clear);
+        if (command)
+        {
+            memcpy(command->color, color.data, sizeof(command->color));
+        }
+    }
+    else
+    {
+        ExecuteClear(color.data);
+    }
+}
+
+void SubmitCapability(GLenum capability, bool32 enabled)
+{
+    if (IsRecording())
+    {
+        CapabilityCommand* command = PushRenderCommand<CapabilityCommand>(RenderCommand_Capability);
+        if (command)
+        {
+            command->capability = capability;
+            command->enabled = enabled;
+        }
+    }
+    else
+    {
+        ExecuteCapability(capability, enabled);
+    }
+}
+
+void SubmitDepthFunc(GLenum func)
+{
+    if (IsRecording())
+    {
+        DepthFuncCommand* command = PushRenderCommand<DepthFuncCommand>(RenderCommand_DepthFunc);
+        if (command)
+        {
+            command->func = func;
+        }
+    }
+    else
+    {
+        glDepthFunc(func);
+    }
+}
+
+void SubmitBlendFunc(GLenum srcFactor, GLenum dstFactor)
+{
+    if (IsRecording())
+    {
+        BlendFuncCommand* command = PushRenderCommand<BlendFuncCommand>(RenderCommand_BlendFunc);
+        if (command)
+        {
+            command->srcFactor = srcFactor;
+            command->dstFactor = dstFactor;
+        }
+    }
+    else
+    {
+        glBlendFunc(srcFactor, dstFactor);
+    }
+}
+
+void SubmitUseProgram(GLuint program)
+{
+    if (IsRecording())
+    {
+        ObjectCommand* command = PushRenderCommand<ObjectCommand>(RenderCommand_UseProgram);
+        if (command)
+        {
+            command->object = program;
+        }
+    }
+    else
+    {
+        g_submitProgram = program;
+        glUseProgram(program);
+    }
+}
+
+void SubmitBindTexture(GLuint texture)
+{
+    if (IsRecording())
+    {
+        ObjectCommand* command = PushRenderCommand<ObjectCommand>(RenderCommand_BindTexture);
+        if (command)
+        {
+            command->object = texture;
+        }
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+GLuint SubmitCreateTexture(uint32 width, uint32 height, GLenum format, GLenum minFilter, GLenum wrap,
+                           const void* pixels)
+{
+    GLuint result = 0;
+
+    if (IsRecording())
+    {
+        // NOTE(Charly): Ids of the stream, never reused
+        result = ++g_nbRecordedTextures;
+
+        size_t dataSize = pixels ? GetTextureSize(width, height, format) : 0;
+        CreateTextureCommand* command = PushRenderCommand<CreateTextureCommand>(RenderCommand_CreateTexture,
+                                                                                dataSize);
+        if (command)
+        {
+            command->texture = result;
+            command->width = width;
+            command->height = height;
+            command->format = format;
+            command->minFilter = minFilter;
+            command->wrap = wrap;
+            command->hasPixels = pixels != nullptr;
+            memcpy(GetCommandData(command), pixels, dataSize);
+        }
+    }
+    else
+    {
+        glGenTextures(1, &result);
+        ExecuteCreateTexture(result, width, height, format, minFilter, wrap, pixels);
+    }
+
+    return result;
+}
+
+void SubmitDeleteTexture(GLuint texture)
+{
+    if (IsRecording())
+    {
+        ObjectCommand* command = PushRenderCommand<ObjectCommand>(RenderCommand_DeleteTexture);
+        if (command)
+        {
+            command->object = texture;
+        }
+    }
+    else
+    {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+void SubmitDrawMesh(z::vec4 color, const Vertex* vertices, uint32 nbVertices, const GLuint* indices,
+                    uint32 nbIndices)
+{
+    if (IsRecording())
+    {
+        size_t verticesSize = nbVertices * sizeof(Vertex);
+        size_t indicesSize = nbIndices * sizeof(GLuint);
+        DrawMeshCommand* command = PushRenderCommand<DrawMeshCommand>(RenderCommand_DrawMesh,
+                                                                      verticesSize + indicesSize);
+        if (command)
+        {
+            memcpy(command->color, color.data, sizeof(command->color));
+            command->nbVertices = nbVertices;
+            command->nbIndices = nbIndices;
+
+            uint8* data = GetCommandData(command);
+            memcpy(data, vertices, verticesSize);
+            memcpy(data + verticesSize, indices, indicesSize);
+        }
+    }
+    else
+    {
+        ExecuteDrawMesh(g_submitProgram, color.data, vertices, nbVertices, indices, nbIndices);
+    }
+}
+
+void SubmitDrawParticles(z::vec2 worldSize, const z::vec4* positionsSizes, const z::vec4* colors,
+                         uint32 nbParticles)
+{
+    if (IsRecording())
+    {
+        size_t arraySize = nbParticles * sizeof(z::vec4);
+        DrawParticlesCommand* command = PushRenderCommand<DrawParticlesCommand>(RenderCommand_DrawParticles,
+                                                                                2 * arraySize);
+        if (command)
+        {
+            command->worldSize[0] = worldSize.x;
+            command->worldSize[1] = worldSize.y;
+            command->nbParticles = nbParticles;
+
+            uint8* data = GetCommandData(command);
+            memcpy(data, positionsSizes, arraySize);
+            memcpy(data + arraySize, colors, arraySize);
+        }
+    }
+    else
+    {
+        real32 size[2] = {worldSize.x, worldSize.y};
+        ExecuteDrawParticles(g_submitProgram, size, positionsSizes, colors, nbParticles);
+    }
+}
+
+void SubmitEndFrame(uint32 frame)
+{
+    if (IsRecording())
+    {
+        EndFrameCommand* command = PushRenderCommand<EndFrameCommand>(RenderCommand_EndFrame);
+        if (command)
+        {
+            command->frame = frame;
+            ++g_renderStream->nbFrames;
+        }
+    }
+}
+
+size_t GetDrawMeshUploadSize(uint32 nbVertices, uint32 nbIndices)
+{
+    size_t result = nbVertices * sizeof(Vertex) + nbIndices * sizeof(GLuint);
+    return result;
+}
+
+size_t GetDrawParticlesUploadSize(uint32 nbParticles)
+{
+    size_t result = sizeof(g_particleBillboard) + 2 * nbParticles * sizeof(z::vec4);
+    return result;
+}
+
+bool32 SaveRenderCapture(const RenderCommandStream* stream, const char* filename)
+{
+    if (stream->overflowed)
+    {
+        Log(Log_Warning, "Saving an incomplete render capture in %s", filename);
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        Log(Log_Error, "Could not open %s", filename);
+        return false;
+    }
+
+    RenderCaptureHeader header = {};
+    header.magic = RENDER_CAPTURE_MAGIC;
+    header.version = RENDER_CAPTURE_VERSION;
+    header.nbFrames = stream->nbFrames;
+    header.nbCommands = stream->nbCommands;
+    header.size = stream->used;
+
+    bool32 result = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    fwrite(stream->base, 1, stream->used, file) == stream->used;
+    if (!result)
+    {
+        Log(Log_Error, "Could not write %s", filename);
+    }
+
+    fclose(file);
+    return result;
+}
+
+bool32 LoadRenderCapture(RenderCommandStream* stream, const char* filename)
+{
+    *stream = {};
+
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        Log(Log_Error, "Could not open %s", filename);
+        return false;
+    }
+
+    RenderCaptureHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != RENDER_CAPTURE_MAGIC ||
+        header.version != RENDER_CAPTURE_VERSION)
+    {
+        Log(Log_Error, "%s is not a render capture", filename);
+        fclose(file);
+        return false;
+    }
+
+    // NOTE(Charly): Never empty, the memory is given back with the stream size
+    size_t size = header.size > 0 ? (size_t)header.size : 1;
+    void* memory = PlatformAllocateMemory(size);
+    if (!memory)
+    {
+        fclose(file);
+        return false;
+    }
+
+    InitRenderCommandStream(stream, memory, size);
+    if (fread(stream->base, 1, header.size, file) != header.size)
+    {
+        Log(Log_Error, "%s is truncated", filename);
+        fclose(file);
+        FreeRenderCapture(stream);
+        return false;
+    }
+    fclose(file);
+
+    stream->used = header.size;
+    stream->nbCommands = header.nbCommands;
+    stream->nbFrames = header.nbFrames;
+
+    return true;
+}
+
+void FreeRenderCapture(RenderCommandStream* stream)
+{
+    if (stream->base)
+    {
+        PlatformFreeMemory(stream->base, stream->size);
+    }
+    *stream = {};
+}
+
+void BeginRenderReplay(RenderReplayer* replayer)
+{
+    *replayer = {};
+    LoadRenderPrograms(replayer->programs);
+}
+
+internal GLuint GetReplayProgram(const RenderReplayer* replayer, GLuint program)
+{
+    GLuint result = program < RenderProgram_Count ? replayer->programs[program] : 0;
+    return result;
+}
+
+internal GLuint GetReplayTexture(const RenderReplayer* replayer, GLuint texture)
+{
+    GLuint result = texture < MAX_REPLAY_TEXTURES ? replayer->textures[texture] : 0;
+    return result;
+}
+
+// NOTE(Charly): Saturates instead of overflowing, counts read from a capture may be anything
+internal uint64 AddCommandArraySize(uint64 size, uint64 count, uint64 elementSize)
+{
+    uint64 result = UINT64_MAX;
+    if (elementSize == 0 || count <= (UINT64_MAX - size) / elementSize)
+    {
+        result = size + count * elementSize;
+    }
+    return result;
+}
+
+// NOTE(Charly): What the command needs to hold its struct and its data. Only called once the
+//               header size is known to fit in the stream, the struct is read when it fits too.
+internal uint64 GetReplayCommandSize(const RenderCommand* header)
+{
+    uint64 result = sizeof(RenderCommand);
+    switch (header->type)
+    {
+        case RenderCommand_Viewport:
+        {
+            result = sizeof(ViewportCommand);
+        } break;
+
+        case RenderCommand_Clear:
+        {
+            result = sizeof(ClearCommand);
+        } break;
+
+        case RenderCommand_Capability:
+        {
+            result = sizeof(CapabilityCommand);
+        } break;
+
+        case RenderCommand_DepthFunc:
+        {
+            result = sizeof(DepthFuncCommand);
+        } break;
+
+        case RenderCommand_BlendFunc:
+        {
+            result = sizeof(BlendFuncCommand);
+        } break;
+
+        case RenderCommand_UseProgram:
+        case RenderCommand_BindTexture:
+        case RenderCommand_DeleteTexture:
+        {
+            result = sizeof(ObjectCommand);
+        } break;
+
+        case RenderCommand_CreateTexture:
+        {
+            result = sizeof(CreateTextureCommand);
+            const CreateTextureCommand* command = (const CreateTextureCommand*)header;
+            if (header->size >= result && command->hasPixels)
+            {
+                result = AddCommandArraySize(result,
+                                             (uint64)command->width * command->height,
+                                             command->format == GL_R8 ? 1 : 4);
+            }
+        } break;
+
+        case RenderCommand_DrawMesh:
+        {
+            result = sizeof(DrawMeshCommand);
+            const DrawMeshCommand* command = (const DrawMeshCommand*)header;
+            if (header->size >= result)
+            {
+                result = AddCommandArraySize(result, command->nbVertices, sizeof(Vertex));
+                result = AddCommandArraySize(result, command->nbIndices, sizeof(GLuint));
+            }
+        } break;
+
+        case RenderCommand_DrawParticles:
+        {
+            result = sizeof(DrawParticlesCommand);
+            const DrawParticlesCommand* command = (const DrawParticlesCommand*)header;
+            if (header->size >= result)
+            {
+                result = AddCommandArraySize(result, 2 * (uint64)command->nbParticles, sizeof(z::vec4));
+            }
+        } break;
+
+        case RenderCommand_EndFrame:
+        {
+            result = sizeof(EndFrameCommand);
+        } break;
+    }
+
+    return result;
+}
+
+bool32 ReplayRenderFrame(RenderReplayer* replayer, const RenderCommandStream* stream)
+{
+    while (replayer->offset + sizeof(RenderCommand) <= stream->used)
+    {
+        const RenderCommand* header = (const RenderCommand*)(stream->base + replayer->offset);
+        if (header->size < sizeof(RenderCommand) || header->size % RENDER_COMMAND_ALIGNMENT != 0 ||
+            replayer->offset + header->size > stream->used || header->size < GetReplayCommandSize(header))
+        {
+            Log(Log_Error, "Corrupted render command at offset %zu", replayer->offset);
+            replayer->offset = stream->used;
+            return false;
+        }
+        replayer->offset += header->size;
+
+        switch (header->type)
+        {
+            case RenderCommand_Viewport:
+            {
+                const ViewportCommand* command = (const ViewportCommand*)header;
+                glViewport(command->x, command->y, command->width, command->height);
+            } break;
+
+            case RenderCommand_Clear:
+            {
+                ExecuteClear(((const ClearCommand*)header)->color);
+            } break;
+
+            case RenderCommand_Capability:
+            {
+                const CapabilityCommand* command = (const CapabilityCommand*)header;
+                ExecuteCapability(command->capability, command->enabled);
+            } break;
+
+            case RenderCommand_DepthFunc:
+            {
+                glDepthFunc(((const DepthFuncCommand*)header)->func);
+            } break;
+
+            case RenderCommand_BlendFunc:
+            {
+                const BlendFuncCommand* command = (const BlendFuncCommand*)header;
+                glBlendFunc(command->srcFactor, command->dstFactor);
+            } break;
+
+            case RenderCommand_UseProgram:
+            {
+                replayer->program = GetReplayProgram(replayer, ((const ObjectCommand*)header)->object);
+                glUseProgram(replayer->program);
+            } break;
+
+            case RenderCommand_BindTexture:
+            {
+                glBindTexture(GL_TEXTURE_2D, GetReplayTexture(replayer, ((const ObjectCommand*)header)->object));
+            } break;
+
+            case RenderCommand_CreateTexture:
+            {
+                const CreateTextureCommand* command = (const CreateTextureCommand*)header;
+                if (command->texture >= MAX_REPLAY_TEXTURES)
+                {
+                    Log(Log_Error, "Too many textures in the render capture, skipping texture %u", command->texture);
+                    break;
+                }
+
+                GLuint* texture = &replayer->textures[command->texture];
+                if (*texture == 0)
+                {
+                    glGenTextures(1, texture);
+                }
+                ExecuteCreateTexture(*texture,
+                                     command->width,
+                                     command->height,
+                                     command->format,
+                                     command->minFilter,
+                                     command->wrap,
+                                     command->hasPixels ? GetCommandData(command) : nullptr);
+            } break;
+
+            case RenderCommand_DeleteTexture:
+            {
+                GLuint texture = ((const ObjectCommand*)header)->object;
+                if (texture < MAX_REPLAY_TEXTURES && replayer->textures[texture])
+                {
+                    glDeleteTextures(1, &replayer->textures[texture]);
+                    replayer->textures[texture] = 0;
+                }
+            } break;
+
+            case RenderCommand_DrawMesh:
+            {
+                const DrawMeshCommand* command = (const DrawMeshCommand*)header;
+                const uint8* data = GetCommandData(command);
+                ExecuteDrawMesh(replayer->program,
+                                command->color,
+                                (const Vertex*)data,
+                                command->nbVertices,
+                                (const GLuint*)(data + command->nbVertices * sizeof(Vertex)),
+                                command->nbIndices);
+            } break;
+
+            case RenderCommand_DrawParticles:
+            {
+                const DrawParticlesCommand* command = (const DrawParticlesCommand*)header;
+                const z::vec4* positionsSizes = (const z::vec4*)GetCommandData(command);
+                ExecuteDrawParticles(replayer->program,
+                                     command->worldSize,
+                                     positionsSizes,
+                                     positionsSizes + command->nbParticles,
+                                     command->nbParticles);
+            } break;
+
+            case RenderCommand_EndFrame:
+            {
+                ++replayer->frame;
+                return true;
+            }
+
+            default:
+            {
+                Log(Log_Error, "Unknown render command %u at offset %zu", header->type,
+                    replayer->offset - header->size);
+            }
+        }
+    }
+
+    return false;
+}
+
+void EndRenderReplay(RenderReplayer* replayer)
+{
+    for (uint32 textureIdx = 0; textureIdx < MAX_REPLAY_TEXTURES; ++textureIdx)
+    {
+        if (replayer->textures[textureIdx])
+        {
+            glDeleteTextures(1, &replayer->textures[textureIdx]);
+        }
+    }
+
+    for (uint32 programIdx = RenderProgram_None + 1; programIdx < RenderProgram_Count; ++programIdx)
+    {
+        glDeleteProgram(replayer->programs[programIdx]);
+    }
+
+    *replayer = {};
+}
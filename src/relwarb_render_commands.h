@@ -0,0 +1,109 @@
+#ifndef RELWARB_RENDER_COMMANDS_H
+#define RELWARB_RENDER_COMMANDS_H
+
+#include "relwarb_defines.h"
+#include "relwarb_math.h"
+#include "relwarb_opengl.h"
+
+struct Vertex;
+
+// NOTE(Charly): Everything the renderer asks GL for, once the frame is built, goes through the
+//               Submit functions below. With the GL backend they call GL right away, with the
+//               record backend they are appended to a command stream and GL is never called:
+//               no context is needed, and what is left of a frame is the CPU side of the
+//               renderer. The stream can be saved, and replayed later in a real context.
+enum RenderBackend
+{
+    RenderBackend_OpenGL,
+    RenderBackend_Record,
+};
+
+// NOTE(Charly): Recorded streams refer to programs by their index, the replay compiles its own
+enum RenderProgram
+{
+    RenderProgram_None,
+    RenderProgram_Bitmap,
+    RenderProgram_Color,
+    RenderProgram_Text,
+    RenderProgram_Particles,
+
+    RenderProgram_Count,
+};
+
+// NOTE(Charly): Commands are packed one after the other, each one followed by its data (vertices,
+//               pixels...). The stream never grows, commands that do not fit are dropped and
+//               the stream is marked as overflowed.
+struct RenderCommandStream
+{
+    uint8* base;
+    size_t size;
+    size_t used;
+
+    uint32 nbCommands;
+    uint32 nbFrames;
+    bool32 overflowed;
+};
+
+void InitRenderCommandStream(RenderCommandStream* stream, void* memory, size_t size);
+// NOTE(Charly): Forgets what was recorded after offset, to record frames without keeping them
+void RewindRenderCommandStream(RenderCommandStream* stream, size_t offset);
+
+// NOTE(Charly): Must be set before InitializeRenderer, resources created with one backend do not
+//               exist for the other. The stream is only used by the record backend.
+void SetRenderBackend(RenderBackend backend, RenderCommandStream* stream);
+RenderBackend GetRenderBackend();
+
+void SubmitViewport(int32 x, int32 y, int32 width, int32 height);
+void SubmitClear(z::vec4 color);
+void SubmitCapability(GLenum capability, bool32 enabled);
+void SubmitDepthFunc(GLenum func);
+void SubmitBlendFunc(GLenum srcFactor, GLenum dstFactor);
+void SubmitUseProgram(GLuint program);
+void SubmitBindTexture(GLuint texture);
+
+// NOTE(Charly): format is GL_RGBA8 or GL_R8. Binds the new texture, and leaves no texture bound.
+GLuint SubmitCreateTexture(uint32 width, uint32 height, GLenum format, GLenum minFilter, GLenum wrap,
+                           const void* pixels);
+void SubmitDeleteTexture(GLuint texture);
+
+// NOTE(Charly): Draw with the bound program and texture, the geometry is uploaded in buffers that
+//               only live for the draw
+void SubmitDrawMesh(z::vec4 color, const Vertex* vertices, uint32 nbVertices, const GLuint* indices,
+                    uint32 nbIndices);
+void SubmitDrawParticles(z::vec2 worldSize, const z::vec4* positionsSizes, const z::vec4* colors,
+                         uint32 nbParticles);
+
+void SubmitEndFrame(uint32 frame);
+
+// NOTE(Charly): Bytes sent to GL by the draws, the billboard of the particles included
+size_t GetDrawMeshUploadSize(uint32 nbVertices, uint32 nbIndices);
+size_t GetDrawParticlesUploadSize(uint32 nbParticles);
+
+// NOTE(Charly): Capture files are the header followed by the stream as is
+bool32 SaveRenderCapture(const RenderCommandStream* stream, const char* filename);
+// NOTE(Charly): The stream memory comes from PlatformAllocateMemory, release it with
+//               FreeRenderCapture
+bool32 LoadRenderCapture(RenderCommandStream* stream, const char* filename);
+void FreeRenderCapture(RenderCommandStream* stream);
+
+#define MAX_REPLAY_TEXTURES 1024
+
+// NOTE(Charly): GL objects of a replay, the ids of the stream index these tables
+struct RenderReplayer
+{
+    GLuint programs[RenderProgram_Count];
+    GLuint textures[MAX_REPLAY_TEXTURES];
+    GLuint program;
+
+    size_t offset;
+    uint32 frame;
+};
+
+// NOTE(Charly): Needs a current GL context
+void BeginRenderReplay(RenderReplayer* replayer);
+// NOTE(Charly): Submits the commands up to the end of the next frame, returns false once the
+//               whole stream has been replayed
+bool32 ReplayRenderFrame(RenderReplayer* replayer, const RenderCommandStream* stream);
+void EndRenderReplay(RenderReplayer* replayer);
+
+#endif // RELWARB_RENDER_COMMANDS_H
@@ -0,0 +1,168 @@
+#include "relwarb_render_queue.h"
+
+#include <algorithm>
+
+#include "relwarb.h"
+#include "relwarb_debug.h"
+#include "relwarb_profiler.h"
+
+bool MeshLess(const Mesh& a, const Mesh& b)
+{
+    bool result =
+        a.program < b.program ? true
+        : a.program > b.program ? false
+        : a.renderMode < b.renderMode ? true
+        : a.renderMode > b.renderMode ? false
+        : a.texture < b.texture ? true
+        : a.texture > b.texture ? false
+        : a.order < b.order;
+
+    return result;
+}
+
+uint32 ReserveRenderOrders(RenderQueue* renderQueue, uint32 count)
+{
+    uint32 result = renderQueue->nbOrders;
+    renderQueue->nbOrders += count;
+    return result;
+}
+
+void PushRenderBucket(RenderQueue* renderQueue, RenderBucket bucket)
+{
+    if (renderQueue->nbBuckets < MAX_RENDER_BUCKETS)
+    {
+        renderQueue->buckets[renderQueue->nbBuckets++] = bucket;
+    }
+    else
+    {
+        // NOTE(Charly): The orders are already set, the merge sorts them back in place
+        renderQueue->meshes.insert(renderQueue->meshes.end(), bucket.meshes, bucket.meshes + bucket.nbMeshes);
+    }
+}
+
+// NOTE(Charly): Every bucket is already sorted, merges them pairwise until one is left
+uint32 MergeRenderQueue(RenderQueue* renderQueue, Mesh** result)
+{
+    TIMED_FUNCTION();
+
+    std::sort(renderQueue->meshes.begin(), renderQueue->meshes.end(), MeshLess);
+
+    RenderBucket runs[MAX_RENDER_BUCKETS + 1];
+    uint32 nbRuns = 0;
+    uint32 nbMeshes = 0;
+    if (!renderQueue->meshes.empty())
+    {
+        runs[nbRuns++] = {renderQueue->meshes.data(), (uint32)renderQueue->meshes.size()};
+        nbMeshes += (uint32)renderQueue->meshes.size();
+    }
+    for (uint32 bucketIdx = 0; bucketIdx < renderQueue->nbBuckets; ++bucketIdx)
+    {
+        if (renderQueue->buckets[bucketIdx].nbMeshes > 0)
+        {
+            runs[nbRuns++] = renderQueue->buckets[bucketIdx];
+            nbMeshes += renderQueue->buckets[bucketIdx].nbMeshes;
+        }
+    }
+
+    if (nbRuns <= 1)
+    {
+        *result = nbRuns ? runs[0].meshes : nullptr;
+        return nbMeshes;
+    }
+
+    Mesh* merged = PushArray(GetFrameArena(), nbMeshes, Mesh);
+    Mesh* scratch = PushArray(GetFrameArena(), nbMeshes, Mesh);
+    if (!merged || !scratch)
+    {
+        *result = nullptr;
+        return 0;
+    }
+
+    // NOTE(Charly): The first pass reads the runs where they are, the next ones ping-pong
+    //               between the two arrays
+    Mesh* target = merged;
+    while (nbRuns > 1)
+    {
+        Mesh* out = target;
+        uint32 nbMerged = 0;
+        for (uint32 runIdx = 0; runIdx < nbRuns; runIdx += 2)
+        {
+            RenderBucket mergedRun = {out, runs[runIdx].nbMeshes};
+            if (runIdx + 1 < nbRuns)
+            {
+                mergedRun.nbMeshes += runs[runIdx + 1].nbMeshes;
+                std::merge(runs[runIdx].meshes, runs[runIdx].meshes + runs[runIdx].nbMeshes,
+                           runs[runIdx + 1].meshes, runs[runIdx + 1].meshes + runs[runIdx + 1].nbMeshes,
+                           out, MeshLess);
+            }
+            else
+            {
+                std::copy(runs[runIdx].meshes, runs[runIdx].meshes + runs[runIdx].nbMeshes, out);
+            }
+
+            out += mergedRun.nbMeshes;
+            runs[nbMerged++] = mergedRun;
+        }
+
+        nbRuns = nbMerged;
+        target = target == merged ? scratch : merged;
+    }
+
+    *result = runs[0].meshes;
+    return nbMeshes;
+}
+
+z::affine2 GetTransformMatrix(RenderMode renderMode, Transform* transform)
+{
+    z::vec2 scale = transform->size;
+    if (transform->orientation < 0)
+    {
+        scale.x *= -1;
+    }
+
+    // NOTE(Charly): Not sure if this is a hack or not ...
+    if (renderMode == RenderMode_World)
+    {
+        scale.y *= -1;
+    }
+
+    z::affine2 result = z::Affine2(transform->position, transform->rotation, scale, transform->origin);
+    return result;
+}
+
+z::affine2 GetProjectionMatrix(RenderMode renderMode, GameState* gameState)
+{
+    z::affine2 result = z::Affine2(1);
+
+    switch (renderMode)
+    {
+        case RenderMode_ScreenAbsolute:
+        {
+            result.xx = 2 / gameState->viewportSize.x;
+            result.tx = -1;
+            result.yy = -2 / gameState->viewportSize.y;
+            result.ty = 1;
+        } break;
+
+        case RenderMode_ScreenRelative:
+        {
+            result.xx = 2;
+            result.tx = -1;
+            result.yy = -2;
+            result.ty = 1;
+        } break;
+
+        case RenderMode_World:
+        {
+            result.xx = 2 / gameState->worldSize.x;
+            result.yy = 2 / gameState->worldSize.y;
+        } break;
+
+        default:
+        {
+            Assert(!"Wrong code path");
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef RELWARB_RENDER_QUEUE_H
+#define RELWARB_RENDER_QUEUE_H
+
+#include "relwarb_defines.h"
+#include "relwarb_memory.h"
+#include "relwarb_renderer.h"
+
+// NOTE(Charly): CPU side of the renderer, nothing in here talks to GL: it can be built and
+//               measured without a context (see relwarb_bench.cpp).
+
+// NOTE(Charly): Meshes generated by jobs go in buckets, one per job, each sorted by the job that
+//               filled it. Meshes queued one at a time (text, HUD...) go in the queue's own vector.
+//               All of them are merged in a single sorted list right before the submission.
+//               A mesh's order is reserved in the queue before it is generated, so the merged
+//               list does not depend on how the work was split.
+struct RenderBucket
+{
+    Mesh* meshes;
+    uint32 nbMeshes;
+};
+
+#define MAX_RENDER_BUCKETS 64
+
+struct RenderQueue
+{
+    FrameVector<Mesh> meshes;
+
+    RenderBucket buckets[MAX_RENDER_BUCKETS];
+    uint32 nbBuckets;
+
+    uint32 nbOrders;
+};
+
+// NOTE(Charly): Avoid state changes as much as possible
+bool MeshLess(const Mesh& a, const Mesh& b);
+
+uint32 ReserveRenderOrders(RenderQueue* renderQueue, uint32 count);
+void PushRenderBucket(RenderQueue* renderQueue, RenderBucket bucket);
+
+// NOTE(Charly): Sorts the queued meshes and merges them with the buckets, the result lives in
+//               the frame arena (or in the queue itself when there is a single run)
+uint32 MergeRenderQueue(RenderQueue* renderQueue, Mesh** result);
+
+#endif // RELWARB_RENDER_QUEUE_H
@@ -0,0 +1,242 @@
+#include "relwarb_render_snapshot.h"
+
+#include <string.h>
+
+#include "relwarb_debug.h"
+#include "relwarb_entity.h"
+#include "relwarb_game.h"
+#include "relwarb_input.h"
+#include "relwarb_profiler.h"
+
+#define SNAPSHOT_FRESH_BIT 0x80000000u
+
+void InitRenderSnapshotBuffer(RenderSnapshotBuffer* buffer, void* memory, size_t size)
+{
+	size_t snapshotSize = size / 3;
+	for (uint32 snapshotIdx = 0; snapshotIdx < 3; ++snapshotIdx)
+	{
+		RenderSnapshot* snapshot = buffer->snapshots + snapshotIdx;
+		*snapshot                = {};
+		InitializeArena(&snapshot->arena, (uint8*)memory + snapshotIdx * snapshotSize, snapshotSize);
+	}
+
+	buffer->writeIdx = 0;
+	buffer->middle.store(1, std::memory_order_relaxed);
+	buffer->readIdx  = 2;
+	buffer->hasRead  = false;
+}
+
+RenderSnapshot* GetRenderSnapshotToWrite(RenderSnapshotBuffer* buffer)
+{
+	RenderSnapshot* result = buffer->snapshots + buffer->writeIdx;
+	return result;
+}
+
+void PublishRenderSnapshot(RenderSnapshotBuffer* buffer)
+{
+	uint32 previous  = buffer->middle.exchange(buffer->writeIdx | SNAPSHOT_FRESH_BIT,
+	                                              std::memory_order_acq_rel);
+	buffer->writeIdx = previous & ~SNAPSHOT_FRESH_BIT;
+}
+
+const RenderSnapshot* AcquireRenderSnapshot(RenderSnapshotBuffer* buffer)
+{
+	if (buffer->middle.load(std::memory_order_relaxed) & SNAPSHOT_FRESH_BIT)
+	{
+		uint32 previous = buffer->middle.exchange(buffer->readIdx, std::memory_order_acq_rel);
+		buffer->readIdx = previous & ~SNAPSHOT_FRESH_BIT;
+		buffer->hasRead = true;
+	}
+
+	const RenderSnapshot* result = buffer->hasRead ? buffer->snapshots + buffer->readIdx : nullptr;
+	return result;
+}
+
+// NOTE(Charly): Arrays are clamped to what is left in the snapshot memory rather than asserting,
+//               a crowded frame loses particles, not the game.
+internal uint32 GetSnapshotCapacity(MemoryArena* arena, size_t elementSize)
+{
+	size_t available = arena->size - arena->used;
+	size_t result    = available > 64 ? (available - 64) / elementSize : 0;
+	return (uint32)result;
+}
+
+internal void SnapshotSprites(GameState* gameState, RenderSnapshot* snapshot)
+{
+	uint32 capacity = GetSnapshotCapacity(&snapshot->arena, sizeof(SnapshotSprite));
+	uint32 count    = gameState->nbEntities < capacity ? gameState->nbEntities : capacity;
+
+	snapshot->sprites   = PushArray(&snapshot->arena, count, SnapshotSprite);
+	snapshot->nbSprites = 0;
+	for (uint32 entityIdx = 0; entityIdx < gameState->nbEntities && snapshot->nbSprites < count;
+	     ++entityIdx)
+	{
+		Entity* entity = &gameState->entities[entityIdx];
+		if (!EntityHasComponent(entity, ComponentFlag_Renderable))
+		{
+			continue;
+		}
+
+		SnapshotSprite* sprite = snapshot->sprites + snapshot->nbSprites++;
+		sprite->pattern        = entity->pattern;
+		sprite->bitmap         = nullptr;
+		sprite->size           = entity->shape->size;
+		if (entity->pattern->patternType == RenderingPattern_Unique)
+		{
+			sprite->bitmap = GetSpriteBitmap(entity->pattern->unique);
+		}
+
+		sprite->transform = GetWorldTransform(entity->p);
+
+		// TODO(Thomas): Handle drawing size with a drawing size
+		if (EntityHasComponent(entity, ComponentFlag_Collidable))
+		{
+			sprite->transform.size = entity->shape->size;
+			sprite->transform.origin += entity->shape->offset;
+		}
+
+		if (entity->entityType == EntityType_Player)
+		{
+			sprite->transform.orientation = entity->orientation < 0.f ? -1 : 1;
+		}
+	}
+}
+
+internal void SnapshotParticles(GameState* gameState, RenderSnapshot* snapshot)
+{
+	uint32 nbParticles = 0;
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		nbParticles += gameState->particleSystems[systemIdx].nbParticles;
+	}
+
+	uint32 capacity = GetSnapshotCapacity(&snapshot->arena, sizeof(SnapshotParticle));
+	if (nbParticles > capacity)
+	{
+		nbParticles = capacity;
+	}
+
+	snapshot->particles   = PushArray(&snapshot->arena, nbParticles, SnapshotParticle);
+	snapshot->nbParticles = 0;
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		ParticleSystem* system = gameState->particleSystems + systemIdx;
+		for (uint32 particleIdx = 0;
+		     particleIdx < system->nbParticles && snapshot->nbParticles < nbParticles;
+		     ++particleIdx)
+		{
+			SnapshotParticle* particle = snapshot->particles + snapshot->nbParticles++;
+			particle->p                = system->particles[particleIdx].p;
+			particle->color            = system->particles[particleIdx].color;
+		}
+	}
+}
+
+internal void SnapshotPlayers(GameState* gameState, RenderSnapshot* snapshot)
+{
+	snapshot->nbPlayers      = gameState->nbPlayers;
+	snapshot->nbSkillEffects = 0;
+	for (uint32 playerIdx = 0; playerIdx < gameState->nbPlayers; ++playerIdx)
+	{
+		Entity*         player = gameState->players[playerIdx];
+		SnapshotPlayer* hud    = snapshot->players + playerIdx;
+		hud->avatar            = player->avatar;
+		hud->health            = player->health;
+		hud->maxHealth         = player->max_health;
+		hud->mana              = player->mana;
+		hud->maxMana           = player->max_mana;
+
+		for (uint32 skillIdx = 0; skillIdx < NB_SKILLS; ++skillIdx)
+		{
+			Skill* skill = player->skills + skillIdx;
+			if (!skill->isActive)
+			{
+				continue;
+			}
+
+			if (skill->applyHandle == DashApply)
+			{
+				SnapshotSkillEffect* effect = snapshot->skillEffects + snapshot->nbSkillEffects++;
+
+				real32 interpolate = skill->dash.elapsed * 5.0;
+				effect->text       = "Dash !";
+				effect->position   = skill->dash.initialPos;
+				effect->color      = z::Vec4(1.f - interpolate, interpolate, 0.f, 1.f);
+			}
+			else if (skill->applyHandle == ManaApply)
+			{
+				SnapshotSkillEffect* effect = snapshot->skillEffects + snapshot->nbSkillEffects++;
+
+				z::vec4 indigo{0.3f, 0.0f, 0.51f, 1.0f};
+				z::vec4 turquoise{0.0f, 0.8f, 0.81f, 1.0f};
+				real32  elapsed2    = skill->mana.elapsed * 2.f;
+				real32  interpolate = (elapsed2 < 1.f) ? (elapsed2) : (2.f - elapsed2);
+				effect->text        = "Mana !";
+				effect->position    = player->p + player->shape->size * z::vec2{0.0, 1.0};
+				effect->color       = indigo * interpolate + turquoise * (1.f - interpolate);
+			}
+		}
+	}
+}
+
+internal void SnapshotEditor(GameState* gameState, RenderSnapshot* snapshot)
+{
+	snapshot->editor              = gameState->editor;
+	snapshot->editor.tiles        = nullptr;
+	snapshot->cursorWorldPosition = GetCursorWorldPosition(gameState);
+
+	uint32 nbTiles = gameState->editor.width * gameState->editor.height;
+	if (gameState->editor.tiles && nbTiles <= GetSnapshotCapacity(&snapshot->arena, sizeof(int)))
+	{
+		snapshot->editor.tiles = PushArray(&snapshot->arena, nbTiles, int);
+		memcpy(snapshot->editor.tiles, gameState->editor.tiles, nbTiles * sizeof(int));
+	}
+	else
+	{
+		snapshot->editor.width  = 0;
+		snapshot->editor.height = 0;
+	}
+}
+
+void BuildRenderSnapshot(GameState* gameState, RenderSnapshot* snapshot)
+{
+	TIMED_FUNCTION();
+
+	ResetArena(&snapshot->arena);
+
+	snapshot->tick            = gameState->tick;
+	snapshot->mode            = gameState->mode;
+	snapshot->showProfiler    = gameState->showProfiler;
+	snapshot->showRenderStats = gameState->showRenderStats;
+	snapshot->showLatency     = gameState->showLatency;
+	snapshot->jumpLatency     = gameState->jumpLatency;
+
+	snapshot->nbSprites      = 0;
+	snapshot->nbParticles    = 0;
+	snapshot->nbPlayers      = 0;
+	snapshot->nbSkillEffects = 0;
+
+	switch (gameState->mode)
+	{
+		case GameMode_Game:
+		{
+			SnapshotSprites(gameState, snapshot);
+			SnapshotParticles(gameState, snapshot);
+			SnapshotPlayers(gameState, snapshot);
+		}
+		break;
+
+		case GameMode_Editor:
+		{
+			SnapshotEditor(gameState, snapshot);
+		}
+		break;
+
+		default:
+		{
+			Assert(!"Wrong code path");
+		}
+	}
+
+	PROFILE_COUNTER("Particles", snapshot->nbParticles);
+}
@@ -0,0 +1,108 @@
+#ifndef RELWARB_RENDER_SNAPSHOT_H
+#define RELWARB_RENDER_SNAPSHOT_H
+
+#include <atomic>
+
+#include "relwarb_defines.h"
+#include "relwarb_math.h"
+#include "relwarb_memory.h"
+#include "relwarb_renderer.h"
+#include "relwarb_editor.h"
+#include "relwarb.h"
+
+// NOTE(Charly): Everything the renderer needs from one tick of the simulation, so that the
+//               simulation can run on its own thread. The snapshot only points to data that
+//               does not change once the game is loaded (bitmaps, patterns, avatars...), what
+//               the simulation writes is copied.
+
+struct SnapshotSprite
+{
+	// NOTE(Charly): Fill patterns are drawn from their tiles, other patterns from the bitmap
+	//               their sprite showed on that tick
+	RenderingPattern* pattern;
+	Bitmap*           bitmap;
+	Transform         transform;
+	z::vec2           size;
+};
+
+struct SnapshotParticle
+{
+	z::vec2 p;
+	z::vec4 color;
+};
+
+struct SnapshotPlayer
+{
+	Bitmap* avatar;
+	uint32  health;
+	uint32  maxHealth;
+	uint32  mana;
+	uint32  maxMana;
+};
+
+// NOTE(Charly): Feedback text of the skills being cast
+struct SnapshotSkillEffect
+{
+	const char* text;
+	z::vec2     position; // World space
+	z::vec4     color;
+};
+
+struct RenderSnapshot
+{
+	uint32   tick;
+	GameMode mode;
+	bool32   showProfiler;
+	bool32   showRenderStats;
+	bool32   showLatency;
+
+	LatencyEvent jumpLatency;
+
+	SnapshotSprite* sprites;
+	uint32          nbSprites;
+
+	SnapshotParticle* particles;
+	uint32            nbParticles;
+
+	SnapshotPlayer players[MAX_PLAYERS];
+	uint32         nbPlayers;
+
+	SnapshotSkillEffect skillEffects[MAX_PLAYERS * NB_SKILLS];
+	uint32              nbSkillEffects;
+
+	// NOTE(Charly): Editor mode only, tiles point in the snapshot memory
+	EditorState editor;
+	z::vec2     cursorWorldPosition;
+
+	// NOTE(Charly): Storage of the arrays above, reset every time the snapshot is built
+	MemoryArena arena;
+};
+
+// NOTE(Charly): Lock-free triple buffer. The simulation always has a snapshot to write, the
+//               renderer always has the latest complete one to read, neither ever waits. The
+//               middle slot is exchanged with a single atomic, the high bit says it holds a
+//               snapshot the renderer has not seen yet.
+struct RenderSnapshotBuffer
+{
+	RenderSnapshot snapshots[3];
+
+	std::atomic<uint32> middle;
+	uint32              writeIdx; // NOTE(Charly): Owned by the simulation
+	uint32              readIdx;  // NOTE(Charly): Owned by the renderer
+	bool32              hasRead;
+};
+
+// NOTE(Charly): memory is split between the three snapshots
+void InitRenderSnapshotBuffer(RenderSnapshotBuffer* buffer, void* memory, size_t size);
+
+// NOTE(Charly): Simulation side
+RenderSnapshot* GetRenderSnapshotToWrite(RenderSnapshotBuffer* buffer);
+void            PublishRenderSnapshot(RenderSnapshotBuffer* buffer);
+
+// NOTE(Charly): Renderer side. Returns the latest published snapshot, nullptr until the first
+//               one. Stays valid until the next call.
+const RenderSnapshot* AcquireRenderSnapshot(RenderSnapshotBuffer* buffer);
+
+void BuildRenderSnapshot(GameState* gameState, RenderSnapshot* snapshot);
+
+#endif // RELWARB_RENDER_SNAPSHOT_H
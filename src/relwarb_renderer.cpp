@@ -3,13 +3,22 @@
 #include "relwarb.h"
 #include "relwarb_opengl.h"
 #include "relwarb_debug.h"
+#include "relwarb_memory.h"
+#include "relwarb_game.h"
+#include "relwarb_editor.h"
+#include "relwarb_jobs.h"
+#include "relwarb_profiler.h"
+#include "relwarb_render_snapshot.h"
+#include "relwarb_render_queue.h"
+#include "relwarb_render_commands.h"
+#include "relwarb_latency.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
 #include <stdio.h>
-#include <vector> // TODO(Charly): Remove this
 #include <algorithm>
+#include <mutex>
 
 #if defined(RELWARB_DEBUG)
 #define GLAssert(x)                                 \
@@ -25,8 +34,6 @@
 #define GLAssert(x) x
 #endif
 
-typedef std::vector<Mesh> RenderQueue;
-
 global_variable RenderQueue g_defaultRenderQueue;
 global_variable RenderQueue g_debugRenderQueue;
 global_variable RenderQueue g_uiRenderQueue;
@@ -38,6 +45,32 @@ global_variable GLuint g_particlesProg;
 
 global_variable size_t g_renderPeak;
 
+// NOTE(Charly): Filled by the render thread until the end of FlushRenderQueue, then published
+//               in g_lastRenderStats for the other threads
+global_variable RenderStats g_renderStats;
+global_variable RenderStats g_lastRenderStats;
+global_variable std::mutex g_renderStatsMutex;
+global_variable FILE* g_renderStatsFile;
+
+// NOTE(Charly): GL_TIME_ELAPSED queries of the passes, one set per frame in flight. A set is
+//               read back when it comes around again, and dropped if the GPU is still not done.
+#define GPU_TIMER_FRAMES 4
+global_variable GLuint g_gpuTimers[GPU_TIMER_FRAMES][RenderPass_Count];
+global_variable int32 g_gpuTimerFrames[GPU_TIMER_FRAMES];
+
+// NOTE(Charly): What we last bound, to tell state changes from redundant binds
+global_variable GLuint g_boundProgram;
+global_variable GLuint g_boundTexture;
+global_variable bool32 g_blendEnabled;
+
+global_variable const Vertex g_quadVertices[] = {
+    {z::Vec2(0, 0), z::Vec2(0, 1)},
+    {z::Vec2(1, 0), z::Vec2(1, 1)},
+    {z::Vec2(1, 1), z::Vec2(1, 0)},
+    {z::Vec2(0, 1), z::Vec2(0, 0)},
+};
+global_variable const GLuint g_quadIndices[] = {0, 1, 2, 0, 2, 3};
+
 global_variable const char* bitmapVert = R"(
 #version 330
 
@@ -166,272 +199,419 @@ internal GLuint CompileShader(const char* src, GLenum type)
     return shader;
 }
 
-Sprite* CreateStillSprite(GameState* gameState, Bitmap* bitmap)
+GLuint LoadProgram(const char* vertShader, const char* fragShader)
 {
-    ComponentID id = gameState->nbSprites++;
-    Assert(id < WORLD_SIZE);
+    GLuint vshader = CompileShader(vertShader, GL_VERTEX_SHADER);
+    GLuint fshader = CompileShader(fragShader, GL_FRAGMENT_SHADER);
+
+    Assert(glIsShader(vshader));
+    Assert(glIsShader(fshader));
 
-    Sprite* result = &gameState->sprites[id];
-    result->spriteType = SpriteType_Still;
-    result->stillSprite = bitmap;
+    GLuint result = glCreateProgram();
+    glAttachShader(result, vshader);
+    glAttachShader(result, fshader);
+    glLinkProgram(result);
+
+    GLint linked;
+    glGetProgramiv(result, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        GLsizei length;
+        GLchar message[1024];
+        glGetProgramInfoLog(result, 1024, &length, message);
+        Log(Log_Error, "Program not linked : %s", message);
+    }
+
+    glDetachShader(result, vshader);
+    glDetachShader(result, fshader);
+
+    glDeleteShader(vshader);
+    glDeleteShader(fshader);
 
     return result;
 }
 
-Sprite* CreateTimeSprite(GameState* gameState, uint32 nbBitmaps, Bitmap** bitmaps, real32 stepTime, bool32 active)
+void LoadRenderPrograms(GLuint* programs)
 {
-    ComponentID id = gameState->nbSprites++;
-    Assert(id < WORLD_SIZE);
-
-    Sprite* result = &gameState->sprites[id];
-    result->spriteType = SpriteType_Timed;
-    result->nbSteps = nbBitmaps;
-    result->steps = new Bitmap*[nbBitmaps];
-    memcpy(result->steps, bitmaps, nbBitmaps * sizeof(Bitmap*));
-    result->currentStep = 0;
-    result->stepTime = stepTime;
-    result->active = active;
+    programs[RenderProgram_None] = 0;
+    programs[RenderProgram_Bitmap] = LoadProgram(bitmapVert, bitmapFrag);
+    programs[RenderProgram_Color] = LoadProgram(bitmapVert, colorFrag);
+    programs[RenderProgram_Text] = LoadProgram(bitmapVert, textFrag);
+    programs[RenderProgram_Particles] = LoadProgram(particlesVert, particlesFrag);
 
-    return result;
+    for (uint32 programIdx = RenderProgram_None + 1; programIdx < RenderProgram_Count; ++programIdx)
+    {
+        Assert(glIsProgram(programs[programIdx]));
+    }
 }
 
-Bitmap* GetSpriteBitmap(const Sprite* sprite)
+void InitializeRenderer(GameState* gameState)
 {
-    switch (sprite->spriteType)
+    GLuint programs[RenderProgram_Count];
+    if (GetRenderBackend() == RenderBackend_Record)
     {
-        case SpriteType_Still:
-        {
-            return sprite->stillSprite;
-        } break;
-        case SpriteType_Timed:
+        // NOTE(Charly): Recorded streams refer to programs by their index
+        for (uint32 programIdx = 0; programIdx < RenderProgram_Count; ++programIdx)
         {
-            return sprite->steps[sprite->currentStep];
-        } break;
-        default:
-            Assert(false);
-            return nullptr;
+            programs[programIdx] = programIdx;
+        }
+    }
+    else
+    {
+        LoadRenderPrograms(programs);
+        glGenQueries(GPU_TIMER_FRAMES * RenderPass_Count, &g_gpuTimers[0][0]);
+    }
+
+    g_bitmapProg = programs[RenderProgram_Bitmap];
+    g_colorProg = programs[RenderProgram_Color];
+    g_textProg = programs[RenderProgram_Text];
+    g_particlesProg = programs[RenderProgram_Particles];
+
+    for (uint32 timerIdx = 0; timerIdx < GPU_TIMER_FRAMES; ++timerIdx)
+    {
+        g_gpuTimerFrames[timerIdx] = -1;
     }
 }
 
-RenderingPattern* CreateUniqueRenderingPattern( GameState* gameState,
-                                                Sprite* sprite)
+internal void UseProgram(GLuint program)
 {
-    ComponentID id = gameState->nbPatterns++;
-    Assert(id < WORLD_SIZE);
+    if (program != g_boundProgram)
+    {
+        ++g_renderStats.programChanges;
+        g_boundProgram = program;
+    }
+    SubmitUseProgram(program);
+}
 
-    RenderingPattern* result = &gameState->patterns[id];
-    result->patternType = RenderingPattern_Unique;
-    result->unique = sprite;
+internal void BindTexture(GLuint texture)
+{
+    if (texture != g_boundTexture)
+    {
+        ++g_renderStats.textureChanges;
+        g_boundTexture = texture;
+    }
+    SubmitBindTexture(texture);
+}
 
-    return result;
+internal void EnableBlend()
+{
+    if (!g_blendEnabled)
+    {
+        ++g_renderStats.blendChanges;
+        g_blendEnabled = true;
+    }
+    SubmitCapability(GL_BLEND, true);
+    SubmitBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void UpdateSpriteTime(Sprite* sprite, real32 dt)
+// NOTE(Charly): No timers without GL, the passes are not timed while recording
+internal void BeginGpuTimer(RenderPass pass)
 {
-    if (sprite->spriteType == SpriteType_Timed && sprite->active)
+    if (GetRenderBackend() == RenderBackend_OpenGL)
     {
-        sprite->elapsed += dt;
-        if (sprite->elapsed > sprite->stepTime)
-        {
-            sprite->currentStep++;
-            sprite->elapsed -= sprite->stepTime;
-            if (sprite->currentStep >= sprite->nbSteps)
+        glBeginQuery(GL_TIME_ELAPSED, g_gpuTimers[g_renderStats.frame % GPU_TIMER_FRAMES][pass]);
+    }
+}
 
+internal void EndGpuTimer()
+{
+    if (GetRenderBackend() == RenderBackend_OpenGL)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+}
+
+// NOTE(Charly): Frees the timers of the current frame, reading back what they measured
+//               GPU_TIMER_FRAMES frames ago when the GPU is done with it
+internal void ReadGpuTimers()
+{
+    uint32 timerIdx = g_renderStats.frame % GPU_TIMER_FRAMES;
+    GLuint* timers = g_gpuTimers[timerIdx];
+
+    g_renderStats.gpuFrame = -1;
+    if (GetRenderBackend() == RenderBackend_OpenGL && g_gpuTimerFrames[timerIdx] >= 0)
+    {
+        // NOTE(Charly): Queries complete in order, the last one tells for all of them
+        GLint available = 0;
+        glGetQueryObjectiv(timers[RenderPass_Count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            for (uint32 passIdx = 0; passIdx < RenderPass_Count; ++passIdx)
             {
-                sprite->currentStep = 0;
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(timers[passIdx], GL_QUERY_RESULT, &elapsed);
+                g_renderStats.gpuPassMs[passIdx] = (real32)(elapsed / 1e6);
             }
+            g_renderStats.gpuFrame = g_gpuTimerFrames[timerIdx];
         }
     }
+
+    g_gpuTimerFrames[timerIdx] = (int32)g_renderStats.frame;
 }
 
-RenderingPattern* CreateFillRenderingPattern(GameState* gameState,
-                                             z::vec2 size,
-                                             uint8* pattern,
-                                             uint8 nbBitmaps,
-                                             Bitmap** bitmaps)
+internal uint32 GetQueuedMeshCount(const RenderQueue* renderQueue)
 {
-    ComponentID id = gameState->nbPatterns++;
-    Assert(id < WORLD_SIZE);
-
-    RenderingPattern* result = &gameState->patterns[id];
-    result->size = size;
-    result->patternType = RenderingPattern_Fill;
-    result->pattern = new uint8[(int32)(size.x * size.y)];
-    memcpy(result->pattern, pattern, size.x * size.y * sizeof(uint8));
-    result->tiles = new Bitmap*[nbBitmaps];
-    memcpy(result->tiles, bitmaps, nbBitmaps * sizeof(Bitmap*));
-
-    return result;
+    size_t result = renderQueue->meshes.size();
+    for (uint32 bucketIdx = 0; bucketIdx < renderQueue->nbBuckets; ++bucketIdx)
+    {
+        result += renderQueue->buckets[bucketIdx].nbMeshes;
+    }
+    return (uint32)result;
 }
 
-void AddRenderingPatternToEntity(Entity* entity, RenderingPattern* pattern)
+internal void WriteRenderStatsLine(FILE* file, const RenderStats* stats)
 {
-    entity->pattern = pattern;
-    SetEntityComponent(entity, ComponentFlag_Renderable);
+    fprintf(file, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%llu,%u,%d,%.4f,%.4f,%.4f,%.4f\n",
+            stats->frame,
+            stats->queuedMeshes[ObjectType_Default],
+            stats->queuedMeshes[ObjectType_UI],
+            stats->queuedMeshes[ObjectType_Debug],
+            stats->batches,
+            stats->drawCalls,
+            stats->programChanges,
+            stats->textureChanges,
+            stats->blendChanges,
+            stats->vertices,
+            stats->indices,
+            (unsigned long long)stats->bytesUploaded,
+            stats->particles,
+            stats->gpuFrame,
+            stats->gpuPassMs[RenderPass_Default],
+            stats->gpuPassMs[RenderPass_Particles],
+            stats->gpuPassMs[RenderPass_UI],
+            stats->gpuPassMs[RenderPass_Debug]);
 }
 
-GLuint LoadProgram(const char* vertShader, const char* fragShader)
+// NOTE(Charly): Ends the stats of the frame, what happens until the next flush (texture loads
+//               for instance) goes to the next one
+internal void PublishRenderStats()
 {
-    GLuint vshader = CompileShader(vertShader, GL_VERTEX_SHADER);
-    GLuint fshader = CompileShader(fragShader, GL_FRAGMENT_SHADER);
+    {
+        std::lock_guard<std::mutex> lock(g_renderStatsMutex);
+        g_lastRenderStats = g_renderStats;
+        if (g_renderStatsFile)
+        {
+            WriteRenderStatsLine(g_renderStatsFile, &g_renderStats);
+        }
+    }
 
-    Assert(glIsShader(vshader));
-    Assert(glIsShader(fshader));
+    uint32 frame = g_renderStats.frame;
+    g_renderStats = {};
+    g_renderStats.frame = frame + 1;
+}
 
-    GLuint result = glCreateProgram();
-    glAttachShader(result, vshader);
-    glAttachShader(result, fshader);
-    glLinkProgram(result);
+void GetRenderStats(RenderStats* stats)
+{
+    std::lock_guard<std::mutex> lock(g_renderStatsMutex);
+    *stats = g_lastRenderStats;
+}
 
-    GLint linked;
-    glGetProgramiv(result, GL_LINK_STATUS, &linked);
-    if (linked != GL_TRUE)
+bool32 BeginRenderStatsCapture(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
     {
-        GLsizei length;
-        GLchar message[1024];
-        glGetProgramInfoLog(result, 1024, &length, message);
-        Log(Log_Error, "Program not linked : %s", message);
+        Log(Log_Error, "Could not open %s", filename);
+        return false;
     }
 
-    glDetachShader(result, vshader);
-    glDetachShader(result, fshader);
+    fprintf(file,
+            "frame,default_meshes,ui_meshes,debug_meshes,batches,draw_calls,program_changes,"
+            "texture_changes,blend_changes,vertices,indices,bytes_uploaded,particles,"
+            "gpu_frame,gpu_default_ms,gpu_particles_ms,gpu_ui_ms,gpu_debug_ms\n");
 
-    glDeleteShader(vshader);
-    glDeleteShader(fshader);
+    std::lock_guard<std::mutex> lock(g_renderStatsMutex);
+    if (g_renderStatsFile)
+    {
+        fclose(g_renderStatsFile);
+    }
+    g_renderStatsFile = file;
 
-    return result;
+    return true;
 }
 
-void InitializeRenderer(GameState* gameState)
+void EndRenderStatsCapture()
 {
-    g_bitmapProg = LoadProgram(bitmapVert, bitmapFrag);
-    g_colorProg = LoadProgram(bitmapVert, colorFrag);
-    g_textProg = LoadProgram(bitmapVert, textFrag);
-    g_particlesProg = LoadProgram(particlesVert, particlesFrag);
-
-    Assert(glIsProgram(g_bitmapProg));
-    Assert(glIsProgram(g_colorProg));
-    Assert(glIsProgram(g_textProg));
-    Assert(glIsProgram(g_particlesProg));
+    std::lock_guard<std::mutex> lock(g_renderStatsMutex);
+    if (g_renderStatsFile)
+    {
+        fclose(g_renderStatsFile);
+        g_renderStatsFile = nullptr;
+    }
 }
 
 internal void FlushRenderQueue(RenderQueue* renderQueue, GameState* gameState)
 {
-    // Avoid state changes as much as possible
-    std::sort(renderQueue->begin(), renderQueue->end(),
-              [](const Mesh& a, const Mesh& b)
-              {
-                  bool result =
-                      a.program < b.program ? true
-                      : a.program > b.program ? false
-                      : a.renderMode < b.renderMode ? true
-                      : a.renderMode > b.renderMode ? false
-                      : a.texture < b.texture ? true : false;
-
-                  return result;
-              });
+    Mesh* queue;
+    const int queueSize = (int)MergeRenderQueue(renderQueue, &queue);
 
     int start = 0;
-    const int queueSize = (int)renderQueue->size();
 
     while (start < queueSize)
     {
         int end = start + 1;
-        RenderMode currMode = (*renderQueue)[start].renderMode;
-        GLuint currTexture = (*renderQueue)[start].texture;
-        z::vec4 currColor = (*renderQueue)[start].color;
+        RenderMode currMode = queue[start].renderMode;
+        GLuint currTexture = queue[start].texture;
+        z::vec4 currColor = queue[start].color;
 
         // NOTE(Charly): Find all meshes that share a texture
         while (end < queueSize &&
-               (*renderQueue)[end].renderMode == currMode &&
-               (*renderQueue)[end].texture == currTexture &&
-               (*renderQueue)[end].color == currColor)
+               queue[end].renderMode == currMode &&
+               queue[end].texture == currTexture &&
+               queue[end].color == currColor)
         {
             ++end;
         }
 
+        uint32 nbVertices = 0;
+        uint32 nbIndices = 0;
+        for (int i = start; i < end; ++i)
+        {
+            nbVertices += queue[i].nbVertices;
+            nbIndices += queue[i].nbIndices;
+        }
+
+        Vertex* vertices = PushArray(GetFrameArena(), nbVertices, Vertex);
+        GLuint* indices = PushArray(GetFrameArena(), nbIndices, GLuint);
+        if (!vertices || !indices)
+        {
+            break;
+        }
+
         Mesh mesh;
-        mesh.program = (*renderQueue)[start].program;
+        mesh.program = queue[start].program;
         mesh.texture = currTexture;
         mesh.color = currColor;
+        mesh.vertices = vertices;
+        mesh.nbVertices = nbVertices;
+        mesh.indices = indices;
+        mesh.nbIndices = nbIndices;
 
-        z::mat3 projMatrix = GetProjectionMatrix(currMode, gameState);
+        z::affine2 projMatrix = GetProjectionMatrix(currMode, gameState);
 
         GLuint startIdx = 0;
         for (int i = start; i < end; ++i)
         {
-            Mesh* currMesh = &(*renderQueue)[i];
-            for (const auto& vert : currMesh->vertices)
-            {
-                z::vec2 p = projMatrix * currMesh->worldTransform * vert.position;
-                Vertex v = {p, vert.texcoord};
-                mesh.vertices.push_back(v);
-            }
+            Mesh* currMesh = &queue[i];
+            z::affine2 transform = projMatrix * currMesh->worldTransform;
+
+            // NOTE(Charly): Copied as is, then the positions are transformed in place
+            std::copy(currMesh->vertices, currMesh->vertices + currMesh->nbVertices, vertices);
+            z::TransformPoints(transform, &vertices->position, &vertices->position,
+                               currMesh->nbVertices, sizeof(Vertex));
+            vertices += currMesh->nbVertices;
 
-            for (const auto& idx : currMesh->indices)
+            for (uint32 idx = 0; idx < currMesh->nbIndices; ++idx)
             {
-                mesh.indices.push_back(startIdx + idx);
+                *indices++ = startIdx + currMesh->indices[idx];
             }
-            startIdx += (GLuint)currMesh->vertices.size();
+            startIdx += currMesh->nbVertices;
         }
 
         RenderMesh(&mesh, projMatrix);
+        ++g_renderStats.batches;
 
         start = end;
     }
 
-    renderQueue->clear();
+    // NOTE(Charly): Give the storage back, it belongs to the frame arena
+    FrameVector<Mesh>().swap(renderQueue->meshes);
+    renderQueue->nbBuckets = 0;
+    renderQueue->nbOrders = 0;
 }
 
-void FlushRenderQueue(GameState* gameState)
+void FlushRenderQueue(GameState* gameState, const RenderSnapshot* snapshot)
 {
-    if (g_defaultRenderQueue.size() > g_renderPeak)
+    TIMED_FUNCTION();
+
+    g_renderStats.queuedMeshes[ObjectType_Default] = GetQueuedMeshCount(&g_defaultRenderQueue);
+    g_renderStats.queuedMeshes[ObjectType_UI] = GetQueuedMeshCount(&g_uiRenderQueue);
+    g_renderStats.queuedMeshes[ObjectType_Debug] = GetQueuedMeshCount(&g_debugRenderQueue);
+
+    size_t nbMeshes = g_renderStats.queuedMeshes[ObjectType_Default];
+    if (nbMeshes > g_renderPeak)
     {
-        g_renderPeak = g_defaultRenderQueue.size();
+        g_renderPeak = nbMeshes;
         Log(Log_Info, "New render count peak: %zu", g_renderPeak);
     }
 
-    glViewport(0, 0, gameState->viewportSize.x, gameState->viewportSize.y);
-    glClearColor(0.3f, 0.8f, 0.7f, 0.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    ReadGpuTimers();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    SubmitViewport(0, 0, gameState->viewportSize.x, gameState->viewportSize.y);
+    SubmitClear(z::Vec4(0.3f, 0.8f, 0.7f, 0.f));
+
+    SubmitCapability(GL_DEPTH_TEST, true);
+    SubmitDepthFunc(GL_LEQUAL);
+    EnableBlend();
+    BeginGpuTimer(RenderPass_Default);
     FlushRenderQueue(&g_defaultRenderQueue, gameState);
+    EndGpuTimer();
 
-    RenderParticles(gameState);
+    BeginGpuTimer(RenderPass_Particles);
+    RenderParticles(gameState, snapshot);
+    EndGpuTimer();
 
-    glDisable(GL_DEPTH_TEST);
+    SubmitCapability(GL_DEPTH_TEST, false);
 
+    BeginGpuTimer(RenderPass_UI);
     FlushRenderQueue(&g_uiRenderQueue, gameState);
+    EndGpuTimer();
+
+    BeginGpuTimer(RenderPass_Debug);
     FlushRenderQueue(&g_debugRenderQueue, gameState);
-}
+    EndGpuTimer();
 
-void RenderPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size)
-{
-    switch (pattern->patternType)
+    PROFILE_COUNTER("Meshes", (real64)nbMeshes);
+    PROFILE_COUNTER("DrawCalls", g_renderStats.drawCalls);
+    if (g_renderStats.gpuFrame >= 0)
     {
-        case RenderingPattern_Unique:
-        {
-            RenderBitmap(GetSpriteBitmap(pattern->unique), RenderMode_World, transform);
-        } break;
-        case RenderingPattern_Fill:
-        {
-            RenderFillPattern(pattern, transform, size);
-        } break;
-
-        default:
+        real32 gpuMs = 0.f;
+        for (uint32 passIdx = 0; passIdx < RenderPass_Count; ++passIdx)
         {
-            // Unknown render pattern type
-            Assert(!"Wrong code path");
-        };
+            gpuMs += g_renderStats.gpuPassMs[passIdx];
+        }
+        PROFILE_COUNTER("GpuMs", gpuMs);
     }
+
+    SubmitEndFrame(g_renderStats.frame);
+    PublishRenderStats();
 }
 
-void RenderFillPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size)
+internal void PushMesh(RenderQueue* renderQueue, const Mesh& mesh)
+{
+    renderQueue->meshes.push_back(mesh);
+    renderQueue->meshes.back().order = ReserveRenderOrders(renderQueue, 1);
+}
+
+internal Mesh MakeBitmapMesh(Bitmap* bitmap, RenderMode mode, Transform* transform, z::vec4 color = z::Vec4(1))
+{
+    Mesh result;
+    result.renderMode = mode;
+    result.program = g_bitmapProg;
+    result.texture = bitmap->texture;
+    result.worldTransform = GetTransformMatrix(mode, transform);
+    result.color = z::Saturate(color);
+
+    result.vertices = g_quadVertices;
+    result.nbVertices = 4;
+    result.indices = g_quadIndices;
+    result.nbIndices = 6;
+
+    return result;
+}
+
+// NOTE(Charly): Upper bound of the tiles drawn to fill size, one per unit plus the rounding
+internal uint32 GetFillPatternMaxMeshCount(z::vec2 size)
 {
+    uint32 result = ((uint32)size.x + 1) * ((uint32)size.y + 1);
+    return result;
+}
+
+// NOTE(Charly): No GL and no queue, only fills meshes. Safe to call from any thread.
+internal uint32 MakeFillPatternMeshes(RenderingPattern* pattern, Transform* transform, z::vec2 size, Mesh* meshes)
+{
+    uint32 result = 0;
+
     uint32 middleTileX = pattern->size.x * 0.5f;
     uint32 middleTileY = pattern->size.y * 0.5f;
     uint32 deltaX = size.x - pattern->size.x;
@@ -450,8 +630,8 @@ void RenderFillPattern(RenderingPattern* pattern, Transform* transform, z::vec2
             // TODO(Thomas): Do properly.
             currentTransform.size = z::Vec2(1);
             currentTransform.position += z::Vec2(i, j);
-            RenderBitmap(pattern->tiles[indexY * uint32(pattern->size.x) + indexX],
-                         RenderMode_World, &currentTransform);
+            meshes[result++] = MakeBitmapMesh(pattern->tiles[indexY * uint32(pattern->size.x) + indexX],
+                                              RenderMode_World, &currentTransform);
 
             if (indexY == middleTileY && deltaY > 0)
             {
@@ -466,6 +646,65 @@ void RenderFillPattern(RenderingPattern* pattern, Transform* transform, z::vec2
             --deltaX;
         }
     }
+
+    return result;
+}
+
+internal uint32 GetPatternMaxMeshCount(RenderingPattern* pattern, z::vec2 size)
+{
+    uint32 result = pattern->patternType == RenderingPattern_Fill ? GetFillPatternMaxMeshCount(size) : 1;
+    return result;
+}
+
+internal uint32 MakePatternMeshes(RenderingPattern* pattern, Transform* transform, z::vec2 size, Mesh* meshes)
+{
+    uint32 result = 0;
+
+    switch (pattern->patternType)
+    {
+        case RenderingPattern_Unique:
+        {
+            meshes[result++] = MakeBitmapMesh(GetSpriteBitmap(pattern->unique), RenderMode_World, transform);
+        } break;
+        case RenderingPattern_Fill:
+        {
+            result = MakeFillPatternMeshes(pattern, transform, size, meshes);
+        } break;
+
+        default:
+        {
+            // Unknown render pattern type
+            Assert(!"Wrong code path");
+        };
+    }
+
+    return result;
+}
+
+internal void PushMeshes(RenderQueue* renderQueue, const Mesh* meshes, uint32 nbMeshes)
+{
+    for (uint32 meshIdx = 0; meshIdx < nbMeshes; ++meshIdx)
+    {
+        PushMesh(renderQueue, meshes[meshIdx]);
+    }
+}
+
+void RenderPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size)
+{
+    Mesh* meshes = PushArray(GetFrameArena(), GetPatternMaxMeshCount(pattern, size), Mesh);
+    if (meshes)
+    {
+        PushMeshes(&g_defaultRenderQueue, meshes, MakePatternMeshes(pattern, transform, size, meshes));
+    }
+}
+
+void RenderFillPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size)
+{
+    Mesh* meshes = PushArray(GetFrameArena(), GetFillPatternMaxMeshCount(size), Mesh);
+    if (meshes)
+    {
+        PushMeshes(&g_defaultRenderQueue, meshes, MakeFillPatternMeshes(pattern, transform, size, meshes));
+    }
 }
 
 void InsertMesh(const Mesh& mesh, ObjectType type)
@@ -474,17 +713,17 @@ void InsertMesh(const Mesh& mesh, ObjectType type)
     {
         case ObjectType_Default:
         {
-            g_defaultRenderQueue.push_back(mesh);
+            PushMesh(&g_defaultRenderQueue, mesh);
         } break;
 
         case ObjectType_UI:
         {
-            g_uiRenderQueue.push_back(mesh);
+            PushMesh(&g_uiRenderQueue, mesh);
         } break;
 
         case ObjectType_Debug:
         {
-            g_debugRenderQueue.push_back(mesh);
+            PushMesh(&g_debugRenderQueue, mesh);
         } break;
 
         default:
@@ -496,138 +735,69 @@ void InsertMesh(const Mesh& mesh, ObjectType type)
 
 void RenderBitmap(Bitmap* bitmap, RenderMode mode, Transform* transform, z::vec4 color)
 {
-    glDisable(GL_DEPTH_TEST);
-
-    Mesh mesh;
-    mesh.renderMode = mode;
-    mesh.program = g_bitmapProg;
-    mesh.texture = bitmap->texture;
-    mesh.worldTransform = GetTransformMatrix(mode, transform);
-    mesh.color = z::Saturate(color);
-
-    mesh.vertices.push_back({z::Vec2(0, 0), z::Vec2(0, 1)});
-    mesh.vertices.push_back({z::Vec2(1, 0), z::Vec2(1, 1)});
-    mesh.vertices.push_back({z::Vec2(1, 1), z::Vec2(1, 0)});
-    mesh.vertices.push_back({z::Vec2(0, 1), z::Vec2(0, 0)});
-
-    mesh.indices = std::vector<GLuint>({0, 1, 2, 0, 2, 3});
-
-    g_defaultRenderQueue.push_back(mesh);
+    PushMesh(&g_defaultRenderQueue, MakeBitmapMesh(bitmap, mode, transform, color));
 }
 
-void RenderParticles(GameState* gameState)
+void RenderParticles(GameState* gameState, const RenderSnapshot* snapshot)
 {
-    GLuint vao;
-
-    enum BufferIndex
-    {
-        BufferIndex_Billboard = 0,
-        BufferIndex_PosSize,
-        BufferIndex_Color,
-        BufferIndex_Count,
-    };
+    TIMED_FUNCTION();
 
-    GLuint buffers[BufferIndex_Count];
-    // 0: Billboard -> vec4
-    // 1: PosSize -> vec4
-    // 2: Color -> vec4
+    GLsizei particleCount = (GLsizei)snapshot->nbParticles;
 
-    local_persist GLfloat billboard[] =
+    if (particleCount == 0)
     {
-        -0.5f, -0.5f, 0.f, 0.f,
-         0.5f, -0.5f, 1.f, 0.f,
-        -0.5f,  0.5f, 0.f, 1.f,
-         0.5f,  0.5f, 1.f, 1.f,
-    };
-
-    std::vector<z::vec4> positionsSizes;
-    std::vector<z::vec4> colors;
-    GLsizei particleCount = 0;
+        return;
+    }
 
-    z::mat3 projMatrix = GetProjectionMatrix(RenderMode_World, gameState);
-    for (int systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+    z::vec4* positionsSizes = PushArray(GetFrameArena(), particleCount, z::vec4);
+    z::vec4* colors = PushArray(GetFrameArena(), particleCount, z::vec4);
+    if (!positionsSizes || !colors)
     {
-        ParticleSystem* system = gameState->particleSystems + systemIdx;
-        for (const auto& particle : system->particles)
-        {
-            ++particleCount;
-
-            colors.push_back(particle.color);
-
-            z::mat3 worldMatrix = z::Translation(particle.p);
-            z::mat3 transformMatrix = projMatrix * worldMatrix;
-
-            z::vec3 pos = transformMatrix * z::Vec3(0, 0, 1);
-            z::vec3 size = transformMatrix * z::Vec3(0.5, 0.5, 0);
-            z::vec4 ps = z::Vec4(pos.x, pos.y, size.x, size.y);
-            positionsSizes.push_back(ps);
-        }
+        return;
     }
 
-    if (particleCount > 0)
-        Log(Log_Info, "Rendering %i particles", particleCount);
-
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    glGenBuffers(BufferIndex_Count, buffers);
-
-    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_Billboard]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(billboard), billboard, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_PosSize]);
-    glBufferData(GL_ARRAY_BUFFER, positionsSizes.size() * sizeof(z::vec4), positionsSizes.data(), GL_STREAM_DRAW);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, buffers[BufferIndex_Color]);
-    glBufferData(GL_ARRAY_BUFFER, particleCount * sizeof(z::vec4), colors.data(), GL_STREAM_DRAW);
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    // NOTE(Charly): Particles are only translated, they all have the same size
+    z::affine2 projMatrix = GetProjectionMatrix(RenderMode_World, gameState);
+    z::vec2 size = z::TransformVector(projMatrix, z::Vec2(0.5, 0.5));
+    for (GLsizei particleIdx = 0; particleIdx < particleCount; ++particleIdx)
+    {
+        const SnapshotParticle& particle = snapshot->particles[particleIdx];
+        colors[particleIdx] = particle.color;
 
-    glVertexAttribDivisor(0, 0);
-    glVertexAttribDivisor(1, 1);
-    glVertexAttribDivisor(2, 1);
+        z::vec2 pos = projMatrix * particle.p;
+        positionsSizes[particleIdx] = z::Vec4(pos.x, pos.y, size.x, size.y);
+    }
 
-    glUseProgram(g_particlesProg);
-    glBindTexture(GL_TEXTURE_2D, gameState->particleBitmap.texture);
-    glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(g_particlesProg, "u_tex"), 0);
-    glUniform2f(glGetUniformLocation(g_particlesProg, "u_worldSize"),
-                gameState->worldSize.x, gameState->worldSize.y);
-    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, particleCount);
-    glUseProgram(0);
+    Log(Log_Debug, "Rendering %i particles", particleCount);
 
-    glDeleteBuffers(BufferIndex_Count, buffers);
-    glDeleteVertexArrays(1, &vao);
+    UseProgram(g_particlesProg);
+    BindTexture(gameState->particleBitmap.texture);
+    SubmitDrawParticles(gameState->worldSize, positionsSizes, colors, particleCount);
+    ++g_renderStats.drawCalls;
+    g_renderStats.vertices += 4;
+    g_renderStats.particles += particleCount;
+    g_renderStats.bytesUploaded += GetDrawParticlesUploadSize(particleCount);
+    UseProgram(0);
 }
 
 void LoadTexture(Bitmap* bitmap)
 {
-    if (!glIsTexture(bitmap->texture))
+    if (bitmap->texture == 0)
     {
-        glGenTextures(1, &bitmap->texture);
-        glBindTexture(GL_TEXTURE_2D, bitmap->texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-                     bitmap->width, bitmap->height,
-                     0, GL_RGBA, GL_UNSIGNED_BYTE,
-                     bitmap->data);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        bitmap->texture = SubmitCreateTexture(bitmap->width, bitmap->height, GL_RGBA8,
+                                              GL_LINEAR_MIPMAP_LINEAR, GL_CLAMP_TO_EDGE,
+                                              bitmap->data);
+        g_renderStats.bytesUploaded += 4 * bitmap->width * bitmap->height;
+        g_boundTexture = 0;
     }
 }
 
 void ReleaseTexture(Bitmap* bitmap)
 {
-    if (glIsTexture(bitmap->texture))
+    if (bitmap->texture != 0)
     {
-        glDeleteTextures(1, &bitmap->texture);
+        SubmitDeleteTexture(bitmap->texture);
+        bitmap->texture = 0;
     }
 }
 
@@ -636,9 +806,13 @@ static GLuint fontTexture;
 
 void LoadFont(const char* font)
 {
+    TIMED_FUNCTION();
+
     FILE* fontFile = fopen(font, "rb");
     if (fontFile)
     {
+        AllowFrameHeapAllocations();
+
         unsigned char* ttfBuffer = new unsigned char[1 << 20];
         unsigned char* tmpBitmap = new unsigned char[512 * 512];
 
@@ -647,12 +821,9 @@ void LoadFont(const char* font)
         // NOTE(Charly): No guarantee this fits !
         stbtt_BakeFontBitmap(ttfBuffer, 0, 32.0, tmpBitmap, 512, 512, 32, 96, cdata);
 
-        glGenTextures(1, &fontTexture);
-        glBindTexture(GL_TEXTURE_2D, fontTexture);
-        GLAssert(glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, 512, 512, 0, GL_RED, GL_UNSIGNED_BYTE, tmpBitmap));
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        fontTexture = SubmitCreateTexture(512, 512, GL_R8, GL_LINEAR, GL_REPEAT, tmpBitmap);
+        g_renderStats.bytesUploaded += 512 * 512;
+        g_boundTexture = 0;
 
         delete[] tmpBitmap;
         delete[] ttfBuffer;
@@ -671,9 +842,26 @@ void RenderText(const char* text, z::vec2 pos, z::vec4 color, GameState* state,
         LoadFont("assets/fonts/Righteous-Regular.ttf");
     }
 
-    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    BindTexture(fontTexture);
+
+    uint32 nbGlyphs = 0;
+    for (const char* c = text; *c; ++c)
+    {
+        if (*c >= 32)
+        {
+            ++nbGlyphs;
+        }
+    }
+
+    Vertex* vertices = PushArray(GetFrameArena(), 4 * nbGlyphs, Vertex);
+    GLuint* indices = PushArray(GetFrameArena(), 6 * nbGlyphs, GLuint);
+    if (!vertices || !indices)
+    {
+        return;
+    }
 
     GLuint idx = 0;
+    GLuint* index = indices;
     Mesh mesh;
 
     real32 x = 0, y = 0;
@@ -688,30 +876,36 @@ void RenderText(const char* text, z::vec2 pos, z::vec4 color, GameState* state,
 
             miny = z::Min(q.y0, miny);
 
-            mesh.vertices.push_back({z::Vec2(q.x0, q.y0), z::Vec2(q.s0, q.t0)});
-            mesh.vertices.push_back({z::Vec2(q.x1, q.y0), z::Vec2(q.s1, q.t0)});
-            mesh.vertices.push_back({z::Vec2(q.x1, q.y1), z::Vec2(q.s1, q.t1)});
-            mesh.vertices.push_back({z::Vec2(q.x0, q.y1), z::Vec2(q.s0, q.t1)});
+            vertices[idx + 0] = {z::Vec2(q.x0, q.y0), z::Vec2(q.s0, q.t0)};
+            vertices[idx + 1] = {z::Vec2(q.x1, q.y0), z::Vec2(q.s1, q.t0)};
+            vertices[idx + 2] = {z::Vec2(q.x1, q.y1), z::Vec2(q.s1, q.t1)};
+            vertices[idx + 3] = {z::Vec2(q.x0, q.y1), z::Vec2(q.s0, q.t1)};
 
-            mesh.indices.push_back(idx + 0);
-            mesh.indices.push_back(idx + 1);
-            mesh.indices.push_back(idx + 2);
+            *index++ = idx + 0;
+            *index++ = idx + 1;
+            *index++ = idx + 2;
 
-            mesh.indices.push_back(idx + 0);
-            mesh.indices.push_back(idx + 2);
-            mesh.indices.push_back(idx + 3);
+            *index++ = idx + 0;
+            *index++ = idx + 2;
+            *index++ = idx + 3;
 
             idx += 4;
         }
         ++text;
     }
 
-    for (auto& v : mesh.vertices)
+    for (uint32 vertIdx = 0; vertIdx < idx; ++vertIdx)
     {
+        Vertex& v = vertices[vertIdx];
         v.position.y -= miny;
         v.position /= state->viewportSize;
     }
 
+    mesh.vertices = vertices;
+    mesh.nbVertices = idx;
+    mesh.indices = indices;
+    mesh.nbIndices = 6 * nbGlyphs;
+
     Transform t;
     t.position = pos;
     mesh.worldTransform = GetTransformMatrix(RenderMode_ScreenRelative, &t);
@@ -723,130 +917,431 @@ void RenderText(const char* text, z::vec2 pos, z::vec4 color, GameState* state,
     InsertMesh(mesh, type);
 }
 
-void RenderMesh(const Mesh* mesh, z::mat3 proj)
+void RenderMesh(const Mesh* mesh, z::affine2 proj)
+{
+    SubmitCapability(GL_DEPTH_TEST, false);
+
+    UseProgram(mesh->program);
+    BindTexture(mesh->texture);
+    SubmitDrawMesh(mesh->color, mesh->vertices, mesh->nbVertices, mesh->indices, mesh->nbIndices);
+    ++g_renderStats.drawCalls;
+    g_renderStats.vertices += mesh->nbVertices;
+    g_renderStats.indices += mesh->nbIndices;
+    g_renderStats.bytesUploaded += GetDrawMeshUploadSize(mesh->nbVertices, mesh->nbIndices);
+    BindTexture(0);
+
+    SubmitCapability(GL_DEPTH_TEST, true);
+}
+
+// NOTE(Charly): Feedback of the skills being cast, the simulation puts them in the snapshot
+internal void RenderSkillEffects(GameState* gameState, const RenderSnapshot* snapshot)
 {
-    GLuint vao = 0, vbo = 0, ibo = 0;
-    glGenVertexArrays(1, &vao);
+    Transform transform = {};
+    transform.origin = z::vec2{0.5, 0.0};
+    z::affine2 worldToNormalize = GetProjectionMatrix(RenderMode_World, gameState) *
+                                  GetTransformMatrix(RenderMode_World, &transform);
 
-    glBindVertexArray(vao);
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(Vertex),
-                 mesh->vertices.data(), GL_STATIC_DRAW);
+    for (uint32 effectIdx = 0; effectIdx < snapshot->nbSkillEffects; ++effectIdx)
+    {
+        const SnapshotSkillEffect* effect = snapshot->skillEffects + effectIdx;
+        z::vec2 normalizePos = worldToNormalize * effect->position;
+        RenderText(effect->text,
+                   normalizePos * z::vec2{0.5, 0.5} + z::vec2{0.5, 0.5},
+                   effect->color,
+                   gameState,
+                   ObjectType::ObjectType_UI);
+    }
+}
 
-    GLint64 ptr = 0;
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)ptr);
-    glEnableVertexAttribArray(0);
-    ptr += 2 * sizeof(GLfloat);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)ptr);
-    glEnableVertexAttribArray(1);
+// NOTE(Charly): Meshes of the entities, built in parallel. Each job gets a slice of the sprites
+//               and fills its own bucket, big enough for the patterns of its slice. Everything
+//               a job writes is in the frame memory of the render thread: the workers reset
+//               theirs on the simulation's schedule.
+struct EntityMeshes
+{
+    const RenderSnapshot* snapshot;
+    uint32* firstMesh;
+    uint32 firstOrder;
+    Mesh* meshes;
+};
+
+// NOTE(Charly): Data of one job
+struct EntityMeshBucket
+{
+    const EntityMeshes* submission;
+    RenderBucket bucket;
+};
 
-    glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(GLuint),
-                 mesh->indices.data(), GL_STATIC_DRAW);
+#define MIN_ENTITIES_PER_MESH_JOB 32
+#define MAX_ENTITY_MESH_JOBS MAX_RENDER_BUCKETS
 
-    glDisable(GL_DEPTH_TEST);
+internal uint32 GetSpriteMaxMeshCount(const SnapshotSprite* sprite)
+{
+    uint32 result = sprite->pattern->patternType == RenderingPattern_Fill ? GetFillPatternMaxMeshCount(sprite->size) : 1;
+    return result;
+}
+
+internal void MakeEntityMeshes(void* data, uint32 begin, uint32 end)
+{
+    EntityMeshBucket* job = (EntityMeshBucket*)data;
+    const EntityMeshes* submission = job->submission;
+    RenderBucket* bucket = &job->bucket;
+    bucket->meshes = submission->meshes + submission->firstMesh[begin];
+    bucket->nbMeshes = 0;
 
-    glUseProgram(mesh->program);
-    glBindTexture(GL_TEXTURE_2D, mesh->texture);
-    glActiveTexture(GL_TEXTURE0);
+    for (uint32 spriteIdx = begin; spriteIdx < end; ++spriteIdx)
+    {
+        const SnapshotSprite* sprite = submission->snapshot->sprites + spriteIdx;
+        Mesh* meshes = bucket->meshes + bucket->nbMeshes;
+        Transform transform = sprite->transform;
 
-    glUniform1i(glGetUniformLocation(mesh->program, "u_tex"), 0);
-    glUniform4fv(glGetUniformLocation(mesh->program, "u_color"), 1, mesh->color.data);
+        uint32 nbMeshes = 0;
+        if (sprite->pattern->patternType == RenderingPattern_Fill)
+        {
+            nbMeshes = MakeFillPatternMeshes(sprite->pattern, &transform, sprite->size, meshes);
+        }
+        else if (sprite->bitmap)
+        {
+            meshes[nbMeshes++] = MakeBitmapMesh(sprite->bitmap, RenderMode_World, &transform);
+        }
+        else
+        {
+            // Unknown render pattern type
+            Assert(!"Wrong code path");
+        }
 
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, (GLuint)mesh->indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glEnable(GL_DEPTH_TEST);
+        // NOTE(Charly): Orders follow the sprites, the same as a single loop would give
+        uint32 firstOrder = submission->firstOrder + submission->firstMesh[spriteIdx];
+        for (uint32 meshIdx = 0; meshIdx < nbMeshes; ++meshIdx)
+        {
+            meshes[meshIdx].order = firstOrder + meshIdx;
+        }
+        bucket->nbMeshes += nbMeshes;
+    }
 
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ibo);
-    glDeleteVertexArrays(1, &vao);
+    std::sort(bucket->meshes, bucket->meshes + bucket->nbMeshes, MeshLess);
 }
 
-z::mat3 GetTransformMatrix(RenderMode renderMode, Transform* transform)
+internal void RenderEntities(const RenderSnapshot* snapshot)
 {
-#if 1
-    // TODO(Charly): origin or -origin ?
-    z::mat3 O = z::Translation(-transform->origin);
-    z::mat3 S = z::Scale(transform->size);
-    z::mat3 R = z::Rotation(transform->rotation);
-    z::mat3 T = z::Translation(transform->position);
+    TIMED_FUNCTION();
 
-    if (transform->orientation < 0)
+    MemoryArena* arena = GetFrameArena();
+    uint32 nbSprites = snapshot->nbSprites;
+    if (nbSprites == 0)
     {
-        S[0][0] *= -1;
+        return;
     }
 
-    // NOTE(Charly): Not sure if this is a hack or not ...
-    if (renderMode == RenderMode_World)
+    EntityMeshes submission;
+    submission.snapshot = snapshot;
+    submission.firstMesh = PushArray(arena, nbSprites, uint32);
+    if (!submission.firstMesh)
     {
-        S[1][1] *= -1;
+        return;
     }
 
-    // TODO(Charly): Check multiplication order
-    z::mat3 result = T * R * S * O;
-#else
-    z::mat3 result;
-    real32 angle = -transform->rotation;
-    real32 cosine = z::Cos(angle);
-    real32 sine = z::Sin(angle);
-    real32 sxc = transform->size.x * cosine;
-    real32 syc = transform->size.y * cosine;
-    real32 sxs = transform->size.x * sine;
-    real32 sys = transform->size.y * sine;
-    real32 tx = -transform->origin.x * sxc - transform->origin.y * sys + transform->position.x;
-    real32 ty = transform->origin.x * sxs - transform->origin.y * syc + transform->position.y;
-
-    result[0][0] = sxc;
-    result[0][1] = sys;
-    result[0][2] = tx;
-    result[1][0] = -sxs;
-    result[1][1] = syc;
-    result[1][2] = ty;
-    result[2][0] = 0;
-    result[2][1] = 0;
-    result[2][2] = 1;
+    uint32 maxMeshes = 0;
+    for (uint32 spriteIdx = 0; spriteIdx < nbSprites; ++spriteIdx)
+    {
+        submission.firstMesh[spriteIdx] = maxMeshes;
+        maxMeshes += GetSpriteMaxMeshCount(snapshot->sprites + spriteIdx);
+    }
 
-#endif
-    return result;
+    // NOTE(Charly): A few buckets per worker, so that stealing can balance uneven slices
+    uint32 nbJobs = (nbSprites + MIN_ENTITIES_PER_MESH_JOB - 1) / MIN_ENTITIES_PER_MESH_JOB;
+    uint32 maxJobs = GetJobWorkerCount() * 4;
+    maxJobs = maxJobs < MAX_ENTITY_MESH_JOBS ? maxJobs : MAX_ENTITY_MESH_JOBS;
+    nbJobs = nbJobs < maxJobs ? nbJobs : maxJobs;
+
+    submission.firstOrder = ReserveRenderOrders(&g_defaultRenderQueue, maxMeshes);
+    submission.meshes = PushArray(arena, maxMeshes, Mesh);
+    EntityMeshBucket* buckets = PushArray(arena, nbJobs, EntityMeshBucket);
+    Job* jobs = PushArray(arena, nbJobs, Job);
+    if (!submission.meshes || !buckets || !jobs)
+    {
+        return;
+    }
+
+    for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+    {
+        buckets[jobIdx].submission = &submission;
+        jobs[jobIdx].function = MakeEntityMeshes;
+        jobs[jobIdx].data = buckets + jobIdx;
+        jobs[jobIdx].begin = (uint32)((uint64)nbSprites * jobIdx / nbJobs);
+        jobs[jobIdx].end = (uint32)((uint64)nbSprites * (jobIdx + 1) / nbJobs);
+    }
+
+    JobCounter counter = {};
+    RunJobs(jobs, nbJobs, &counter);
+    WaitForCounter(&counter);
+
+    for (uint32 jobIdx = 0; jobIdx < nbJobs; ++jobIdx)
+    {
+        PushRenderBucket(&g_defaultRenderQueue, buckets[jobIdx].bucket);
+    }
 }
 
-z::mat3 GetProjectionMatrix(RenderMode renderMode, GameState* gameState)
+// NOTE(Charly): One column per profiled thread, each block of the last frames with its
+//               min/avg/max in milliseconds, indented under its parent
+internal void RenderProfiler(GameState* gameState)
 {
-    z::mat3 result(1);
+    TIMED_FUNCTION();
+
+    // NOTE(Charly): The font is baked at 32 pixels
+    real32 lineHeight = 32.f / gameState->viewportSize.y;
 
-    switch (renderMode)
+    for (uint32 threadIdx = 0; threadIdx < GetProfilerThreadCount(); ++threadIdx)
     {
-        case RenderMode_ScreenAbsolute:
+        z::vec2 position = z::Vec2(0.01f + 0.5f * threadIdx, 0.3f);
+
+        ProfilerReport* report = PushStruct(GetFrameArena(), ProfilerReport);
+        if (!report)
         {
-            result[0][0] = 2 / gameState->viewportSize.x;
-            result[0][2] = -1;
-            result[1][1] = -2 / gameState->viewportSize.y;
-            result[1][2] = 1;
-        } break;
+            return;
+        }
 
-        case RenderMode_ScreenRelative:
+        GetProfilerReport(threadIdx, report);
+        if (report->nbFrames == 0)
         {
-            result[0][0] = 2;
-            result[0][2] = -1;
-            result[1][1] = -2;
-            result[1][2] = 1;
-        } break;
+            continue;
+        }
+
+        char line[256];
+        snprintf(line, 256, "%s: %.2f / %.2f / %.2f ms",
+                 report->threadName, report->frameMin, report->frameAvg, report->frameMax);
+        RenderText(line, position, z::Vec4(1, 1, 0, 1), gameState, ObjectType_Debug);
+        position.y += lineHeight;
 
-        case RenderMode_World:
+        for (uint32 nodeIdx = 0; nodeIdx < report->nbNodes; ++nodeIdx)
         {
-            result[0][0] = 2 / gameState->worldSize.x;
-            result[1][1] = 2 / gameState->worldSize.y;
-        } break;
+            const ProfileNode* node = report->nodes + nodeIdx;
+            snprintf(line, 256, "%*s%s x%.0f: %.2f / %.2f / %.2f",
+                     (int)(2 * node->depth + 2), "",
+                     node->name, node->calls, node->min, node->avg, node->max);
+            RenderText(line, position, z::Vec4(1, 1, 1, 1), gameState, ObjectType_Debug);
+            position.y += lineHeight;
+        }
+    }
+}
+
+// NOTE(Charly): Stats of the previous frame, the current one is not flushed yet
+internal void RenderRenderStats(GameState* gameState)
+{
+    RenderStats stats;
+    GetRenderStats(&stats);
+
+    real32 lineHeight = 32.f / gameState->viewportSize.y;
+    z::vec2 position = z::Vec2(0.7f, 0.05f);
+
+    // NOTE(Charly): GPU times only come back every now and then, keep showing the last ones
+    local_persist RenderStats gpuStats;
+    if (stats.gpuFrame >= 0)
+    {
+        gpuStats = stats;
+    }
+
+    char lines[7][128];
+    snprintf(lines[0], 128, "Meshes: %u / %u / %u",
+             stats.queuedMeshes[ObjectType_Default],
+             stats.queuedMeshes[ObjectType_UI],
+             stats.queuedMeshes[ObjectType_Debug]);
+    snprintf(lines[1], 128, "Batches: %u, draw calls: %u", stats.batches, stats.drawCalls);
+    snprintf(lines[2], 128, "Programs: %u, textures: %u, blend: %u",
+             stats.programChanges, stats.textureChanges, stats.blendChanges);
+    snprintf(lines[3], 128, "Vertices: %u, indices: %u", stats.vertices, stats.indices);
+    snprintf(lines[4], 128, "Uploaded: %.1f KB", stats.bytesUploaded / 1024.0);
+    snprintf(lines[5], 128, "Particles: %u", stats.particles);
+    snprintf(lines[6], 128, "GPU ms: %.2f / %.2f / %.2f / %.2f",
+             gpuStats.gpuPassMs[RenderPass_Default],
+             gpuStats.gpuPassMs[RenderPass_Particles],
+             gpuStats.gpuPassMs[RenderPass_UI],
+             gpuStats.gpuPassMs[RenderPass_Debug]);
+
+    for (uint32 lineIdx = 0; lineIdx < 7; ++lineIdx)
+    {
+        RenderText(lines[lineIdx], position, z::Vec4(1, 1, 0, 1), gameState, ObjectType_Debug);
+        position.y += lineHeight;
+    }
+}
+
+// NOTE(Charly): Percentiles of every stage, then the present histogram in 2 ms columns
+internal void RenderLatency(GameState* gameState)
+{
+    real32 lineHeight = 32.f / gameState->viewportSize.y;
+    z::vec2 position = z::Vec2(0.7f, 0.4f);
+
+    char line[128];
+    for (uint32 stage = 0; stage < LatencyStage_Count; ++stage)
+    {
+        const LatencyHistogram* histogram = GetLatencyHistogram((LatencyStage)stage);
+        snprintf(line, 128, "Jump to %s: %.1f / %.1f / %.1f ms (%u)",
+                 GetLatencyStageName((LatencyStage)stage),
+                 GetLatencyPercentile(histogram, 0.5),
+                 GetLatencyPercentile(histogram, 0.95),
+                 GetLatencyPercentile(histogram, 0.99),
+                 histogram->count);
+        RenderText(line, position, z::Vec4(0, 1, 1, 1), gameState, ObjectType_Debug);
+        position.y += lineHeight;
+    }
+
+    const uint32 bucketsPerColumn = 2000 / LATENCY_BUCKET_US;
+    const uint32 nbColumns = NB_LATENCY_BUCKETS / bucketsPerColumn;
+    const char levels[] = " .:-=+*#";
+
+    const LatencyHistogram* present = GetLatencyHistogram(LatencyStage_Present);
+    uint32 columns[NB_LATENCY_BUCKETS];
+    uint32 maxColumn = 0;
+    uint32 lastColumn = 0;
+    for (uint32 column = 0; column < nbColumns; ++column)
+    {
+        columns[column] = 0;
+        for (uint32 bucket = 0; bucket < bucketsPerColumn; ++bucket)
+        {
+            columns[column] += present->buckets[column * bucketsPerColumn + bucket];
+        }
+
+        maxColumn = std::max(maxColumn, columns[column]);
+        if (columns[column] > 0)
+        {
+            lastColumn = column;
+        }
+    }
+
+    if (maxColumn > 0)
+    {
+        uint32 length = 0;
+        for (uint32 column = 0; column <= lastColumn; ++column)
+        {
+            line[length++] = levels[(columns[column] * 7 + maxColumn - 1) / maxColumn];
+        }
+        snprintf(line + length, 128 - length, "| %u ms", (lastColumn + 1) * 2);
+        RenderText(line, position, z::Vec4(0, 1, 1, 1), gameState, ObjectType_Debug);
+    }
+}
+
+void RenderGame(GameState* gameState, const RenderSnapshot* snapshot, real32 dt)
+{
+    TIMED_FUNCTION();
+
+    switch (snapshot->mode)
+    {
+        case GameMode_Game:
+        {
+            RenderEntities(snapshot);
+
+            RenderSkillEffects(gameState, snapshot);
+            RenderHUD(gameState, snapshot);
+            RenderText("Hello, World",
+                       z::Vec2(0.0, 0.0),
+                       z::Vec4(1, 0, 0, 1),
+                       gameState,
+                       ObjectType_Debug);
+            RenderText("I am another test text !",
+                       z::Vec2(0.0, 0.1),
+                       z::Vec4(0, 1, 0, 1),
+                       gameState,
+                       ObjectType_Debug);
+            RenderText("abcdefghijklmnopqrstuvwxyz 0123456789",
+                       z::Vec2(0.0, 0.2),
+                       z::Vec4(0, 0, 1, 1),
+                       gameState,
+                       ObjectType_Debug);
+
+            char fps[128];
+            snprintf(fps, 128, "dt: %.3f, fps: %.3f", dt, 1 / dt);
+            RenderText(fps, z::Vec2(0.8, 0), z::Vec4(0, 0, 0, 1), gameState, ObjectType_Debug);
+
+            if (snapshot->showProfiler)
+            {
+                RenderProfiler(gameState);
+            }
+
+            if (snapshot->showRenderStats)
+            {
+                RenderRenderStats(gameState);
+            }
+
+            if (snapshot->showLatency)
+            {
+                RenderLatency(gameState);
+            }
+
+            FlushRenderQueue(gameState, snapshot);
+        }
+        break;
+
+        case GameMode_Editor:
+        {
+            RenderEditor(gameState, snapshot);
+        }
+        break;
 
         default:
         {
             Assert(!"Wrong code path");
         }
     }
+}
 
-    return result;
+void RenderHUD(GameState* gameState, const RenderSnapshot* snapshot)
+{
+    real32 ratio = gameState->viewportSize.x / gameState->viewportSize.y;
+
+    Transform transform;
+
+    z::vec2 onScreenPos = z::Vec2(0.04, 0.04);
+    for (uint32 i = 0; i < snapshot->nbPlayers && i < MAX_HUD_PLAYERS; ++i)
+    {
+        const SnapshotPlayer* player = snapshot->players + i;
+
+        transform.size = z::Vec2(0.0625, 0.0625 * ratio);
+
+        // Avatar
+        transform.position = onScreenPos;
+        RenderBitmap(player->avatar, RenderMode_ScreenRelative, &transform);
+
+        // Health
+        transform.size    = z::Vec2(0.025f, 0.025f * ratio);
+        z::vec2 healthPos = onScreenPos + z::Vec2(0.075f, 0.f);
+        for (uint32 hp = 0; hp < player->maxHealth; hp += 2)
+        {
+            transform.position = healthPos;
+            if (hp < player->health)
+            {
+                if (hp + 1 < player->health)
+                {
+                    RenderBitmap(&gameState->hudHealth[0], RenderMode_ScreenRelative, &transform);
+                }
+                else
+                {
+                    RenderBitmap(&gameState->hudHealth[1], RenderMode_ScreenRelative, &transform);
+                }
+            }
+            else
+            {
+                RenderBitmap(&gameState->hudHealth[2], RenderMode_ScreenRelative, &transform);
+            }
+
+            healthPos.x += 0.0255f;
+        }
+
+        // Mana
+        z::vec2 manaPos = onScreenPos + z::Vec2(0.075f, 0.0375f * ratio);
+        for (uint32 mp = 0; mp < player->maxMana; ++mp)
+        {
+            transform.position = manaPos;
+            if (mp < player->mana)
+            {
+                RenderBitmap(&gameState->hudMana[0], RenderMode_ScreenRelative, &transform);
+            }
+            else
+            {
+                RenderBitmap(&gameState->hudMana[1], RenderMode_ScreenRelative, &transform);
+            }
+            manaPos.x += 0.0255f;
+        }
+
+        onScreenPos.x += 0.24;
+    }
 }
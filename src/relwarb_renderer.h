@@ -5,12 +5,10 @@
 #include "relwarb_entity.h"
 #include "relwarb_opengl.h"
 
-// TODO(Charly): Remove this
-#include <vector>
-
 struct Bitmap;
 struct GameState;
 struct Entity;
+struct RenderSnapshot;
 
 enum SpriteType
 {
@@ -97,6 +95,8 @@ enum ObjectType
     ObjectType_Default,
     ObjectType_Debug,
     ObjectType_UI,
+
+    ObjectType_Count,
 };
 
 struct Vertex
@@ -111,16 +111,66 @@ struct Mesh
     GLuint program;
     GLuint texture;
 
-    std::vector<Vertex> vertices;
-    std::vector<GLuint> indices;
+    // NOTE(Charly): Geometry lives in frame memory (or static storage), a mesh
+    //               is only valid until the end of the frame it was queued in.
+    const Vertex* vertices;
+    uint32 nbVertices;
+    const GLuint* indices;
+    uint32 nbIndices;
 
-    z::mat3 worldTransform;
+    z::affine2 worldTransform;
     z::vec4 color;
+
+    // NOTE(Charly): Submission index in its queue, breaks ties when sorting so that the draw
+    //               order does not depend on the sort implementation
+    uint32 order;
+};
+
+// NOTE(Charly): Passes of FlushRenderQueue, timed on the GPU
+enum RenderPass
+{
+    RenderPass_Default,
+    RenderPass_Particles,
+    RenderPass_UI,
+    RenderPass_Debug,
+
+    RenderPass_Count,
+};
+
+// NOTE(Charly): What the renderer did for a frame. State changes only count binds that change
+//               the bound value, redundant binds are not state changes.
+struct RenderStats
+{
+    uint32 frame;
+
+    uint32 queuedMeshes[ObjectType_Count]; // NOTE(Charly): Per queue, before batching
+    uint32 batches;
+    uint32 drawCalls;
+
+    uint32 programChanges;
+    uint32 textureChanges;
+    uint32 blendChanges;
+
+    uint32 vertices;
+    uint32 indices;
+    uint64 bytesUploaded; // NOTE(Charly): Buffers and textures
+
+    uint32 particles;
+
+    // NOTE(Charly): GPU times are read back a few frames late not to stall on the GPU, they
+    //               belong to gpuFrame. -1 when no times came back during this frame.
+    int32 gpuFrame;
+    real32 gpuPassMs[RenderPass_Count];
 };
 
+// NOTE(Charly): Creates the GL objects, or only the ids of the programs when the backend records
+//               (see relwarb_render_commands.h)
 void InitializeRenderer(GameState* gameState);
 void ResizeRenderer(GameState* gameState);
-void FlushRenderQueue(GameState* gameState);
+void FlushRenderQueue(GameState* gameState, const RenderSnapshot* snapshot);
+
+// NOTE(Charly): Compiles the programs, indexed by RenderProgram
+void LoadRenderPrograms(GLuint* programs);
 
 Sprite* CreateStillSprite(GameState* gameState, Bitmap* bitmap);
 
@@ -151,15 +201,22 @@ void RenderPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size
 void RenderFillPattern(RenderingPattern* pattern, Transform* transform, z::vec2 size);
 
 void RenderBitmap(Bitmap* bitmap, RenderMode mode, Transform* transform, z::vec4 color = z::Vec4(1));
-void RenderParticles(GameState* gameState);
+void RenderParticles(GameState* gameState, const RenderSnapshot* snapshot);
 
 void LoadTexture(Bitmap* bitmap);
 // NOTE(Charly): Cleanup GPU memory
 void ReleaseTexture(Bitmap* bitmap);
 
 void RenderText(const char* text, z::vec2 pos, z::vec4 color, GameState* state, ObjectType type);
-void RenderMesh(const Mesh* mesh, z::mat3 projectionMatrix);
+void RenderMesh(const Mesh* mesh, z::affine2 projectionMatrix);
+
+z::affine2 GetTransformMatrix(RenderMode renderMode, Transform* transform);
+z::affine2 GetProjectionMatrix(RenderMode renderMode, GameState* gameState);
+
+// NOTE(Charly): Stats of the last rendered frame, from any thread
+void GetRenderStats(RenderStats* stats);
 
-z::mat3 GetTransformMatrix(RenderMode renderMode, Transform* transform);
-z::mat3 GetProjectionMatrix(RenderMode renderMode, GameState* gameState);
+// NOTE(Charly): Writes the stats of every rendered frame as a line of a CSV file
+bool32 BeginRenderStatsCapture(const char* filename);
+void EndRenderStatsCapture();
 #endif // RELWARB_RENDERER_H
@@ -0,0 +1,294 @@
+#include "relwarb_replay.h"
+
+#include <string.h>
+
+#include "relwarb.h"
+#include "relwarb_debug.h"
+
+#define REPLAY_MAGIC 0x50525752 // 'RWRP'
+#define REPLAY_VERSION 1
+
+// NOTE(Charly): Every record starts with a tag byte
+//               - 0: the previous frame is repeated, followed by the number of frames (uint32)
+//               - Otherwise a combination of the flags below, followed by the dt (real32) then
+//               the input runs. A run is the number of unchanged words to skip (uint8), the number
+//               of changed words (uint8), then the changed words xor the previous ones.
+enum ReplayRecordFlag
+{
+	ReplayRecord_Dt    = 1 << 0,
+	ReplayRecord_Input = 1 << 1,
+};
+
+#define NB_INPUT_WORDS (sizeof(InputState) / sizeof(uint32))
+static_assert(sizeof(InputState) % sizeof(uint32) == 0, "InputState is encoded as 32 bits words");
+
+internal void FlushRepeats(InputRecorder* recorder)
+{
+	if (recorder->nbPendingRepeats > 0)
+	{
+		uint8 tag = 0;
+		fwrite(&tag, sizeof(tag), 1, recorder->file);
+		fwrite(&recorder->nbPendingRepeats, sizeof(uint32), 1, recorder->file);
+
+		recorder->nbPendingRepeats = 0;
+	}
+}
+
+bool32 BeginInputRecording(InputRecorder* recorder, const char* filename, GameState* gameState)
+{
+	*recorder      = {};
+	recorder->file = fopen(filename, "wb");
+	if (!recorder->file)
+	{
+		Log(Log_Error, "Could not open %s for recording", filename);
+		return false;
+	}
+
+	recorder->header.magic         = REPLAY_MAGIC;
+	recorder->header.version       = REPLAY_VERSION;
+	recorder->header.seed          = gameState->seed;
+	recorder->header.deterministic = gameState->deterministic;
+	recorder->header.fixedDt       = gameState->fixedDt;
+
+	// NOTE(Charly): The frame count is patched when the recording ends
+	fwrite(&recorder->header, sizeof(ReplayHeader), 1, recorder->file);
+
+	return true;
+}
+
+void RecordInputFrame(InputRecorder* recorder, const InputState* input, real32 dt)
+{
+	if (!recorder->file)
+	{
+		return;
+	}
+
+	const uint32* words     = (const uint32*)input;
+	const uint32* lastWords = (const uint32*)&recorder->lastInput;
+
+	uint32 delta[NB_INPUT_WORDS];
+	bool32 inputChanged = false;
+	for (uint32 wordIdx = 0; wordIdx < NB_INPUT_WORDS; ++wordIdx)
+	{
+		delta[wordIdx] = words[wordIdx] ^ lastWords[wordIdx];
+		inputChanged |= delta[wordIdx] != 0;
+	}
+	bool32 dtChanged = dt != recorder->lastDt;
+
+	++recorder->header.nbFrames;
+
+	if (!inputChanged && !dtChanged && recorder->header.nbFrames > 1)
+	{
+		++recorder->nbPendingRepeats;
+		return;
+	}
+
+	FlushRepeats(recorder);
+
+	// NOTE(Charly): Worst case is one run per changed word
+	uint8  record[1 + sizeof(real32) + 1 + NB_INPUT_WORDS * (2 + sizeof(uint32))];
+	uint8* cursor = record;
+
+	uint8 tag = (dtChanged ? ReplayRecord_Dt : 0) | (inputChanged ? ReplayRecord_Input : 0);
+	if (!tag)
+	{
+		// NOTE(Charly): First frame with a null input and dt, still needs a record
+		tag = ReplayRecord_Dt;
+	}
+	*cursor++ = tag;
+
+	if (tag & ReplayRecord_Dt)
+	{
+		memcpy(cursor, &dt, sizeof(real32));
+		cursor += sizeof(real32);
+	}
+
+	if (tag & ReplayRecord_Input)
+	{
+		uint8* nbRuns = cursor++;
+		*nbRuns       = 0;
+
+		uint32 wordIdx = 0;
+		while (true)
+		{
+			uint32 skip = 0;
+			while (wordIdx < NB_INPUT_WORDS && delta[wordIdx] == 0 && skip < 255)
+			{
+				++skip;
+				++wordIdx;
+			}
+
+			if (wordIdx == NB_INPUT_WORDS)
+			{
+				break;
+			}
+
+			uint32 count = 0;
+			while (wordIdx + count < NB_INPUT_WORDS && delta[wordIdx + count] != 0 && count < 255)
+			{
+				++count;
+			}
+
+			*cursor++ = (uint8)skip;
+			*cursor++ = (uint8)count;
+			memcpy(cursor, delta + wordIdx, count * sizeof(uint32));
+			cursor += count * sizeof(uint32);
+
+			wordIdx += count;
+			++*nbRuns;
+		}
+	}
+
+	fwrite(record, 1, cursor - record, recorder->file);
+
+	recorder->lastInput = *input;
+	recorder->lastDt    = dt;
+}
+
+void EndInputRecording(InputRecorder* recorder)
+{
+	if (!recorder->file)
+	{
+		return;
+	}
+
+	FlushRepeats(recorder);
+
+	fseek(recorder->file, 0, SEEK_SET);
+	fwrite(&recorder->header, sizeof(ReplayHeader), 1, recorder->file);
+	fclose(recorder->file);
+
+	Log(Log_Info, "Recorded %u frames", recorder->header.nbFrames);
+
+	recorder->file = nullptr;
+}
+
+bool32 BeginInputPlayback(InputPlayback* playback, const char* filename, GameState* gameState)
+{
+	*playback      = {};
+	playback->file = fopen(filename, "rb");
+	if (!playback->file)
+	{
+		Log(Log_Error, "Could not open replay %s", filename);
+		return false;
+	}
+
+	if (fread(&playback->header, sizeof(ReplayHeader), 1, playback->file) != 1 ||
+	    playback->header.magic != REPLAY_MAGIC || playback->header.version != REPLAY_VERSION)
+	{
+		Log(Log_Error, "%s is not a replay file (or an outdated one)", filename);
+		fclose(playback->file);
+		playback->file = nullptr;
+		return false;
+	}
+
+	gameState->seed          = playback->header.seed;
+	gameState->seeded        = true;
+	gameState->deterministic = playback->header.deterministic;
+	gameState->fixedDt       = playback->header.fixedDt;
+
+	return true;
+}
+
+internal bool32 ReadRecord(InputPlayback* playback)
+{
+	FILE* file = playback->file;
+
+	uint8 tag;
+	if (fread(&tag, sizeof(tag), 1, file) != 1)
+	{
+		return false;
+	}
+
+	if (tag == 0)
+	{
+		uint32 nbFrames;
+		if (fread(&nbFrames, sizeof(uint32), 1, file) != 1 || nbFrames == 0)
+		{
+			return false;
+		}
+
+		playback->nbPendingRepeats = nbFrames - 1;
+		return true;
+	}
+
+	if (tag & ReplayRecord_Dt)
+	{
+		if (fread(&playback->dt, sizeof(real32), 1, file) != 1)
+		{
+			return false;
+		}
+	}
+
+	if (tag & ReplayRecord_Input)
+	{
+		uint8 nbRuns;
+		if (fread(&nbRuns, sizeof(nbRuns), 1, file) != 1)
+		{
+			return false;
+		}
+
+		uint32* words   = (uint32*)&playback->input;
+		uint32  wordIdx = 0;
+		for (uint32 runIdx = 0; runIdx < nbRuns; ++runIdx)
+		{
+			uint8 run[2];
+			if (fread(run, sizeof(run), 1, file) != 1)
+			{
+				return false;
+			}
+
+			wordIdx += run[0];
+			if (wordIdx + run[1] > NB_INPUT_WORDS)
+			{
+				return false;
+			}
+
+			uint32 delta[255];
+			if (fread(delta, sizeof(uint32), run[1], file) != run[1])
+			{
+				return false;
+			}
+
+			for (uint32 deltaIdx = 0; deltaIdx < run[1]; ++deltaIdx)
+			{
+				words[wordIdx++] ^= delta[deltaIdx];
+			}
+		}
+	}
+
+	return true;
+}
+
+bool32 PlaybackInputFrame(InputPlayback* playback, InputState* input, real32* dt)
+{
+	if (!playback->file || playback->frame >= playback->header.nbFrames)
+	{
+		return false;
+	}
+
+	if (playback->nbPendingRepeats > 0)
+	{
+		--playback->nbPendingRepeats;
+	}
+	else if (!ReadRecord(playback))
+	{
+		Log(Log_Error, "Replay is corrupted at frame %u", playback->frame);
+		return false;
+	}
+
+	*input = playback->input;
+	*dt    = playback->dt;
+	++playback->frame;
+
+	return true;
+}
+
+void EndInputPlayback(InputPlayback* playback)
+{
+	if (playback->file)
+	{
+		fclose(playback->file);
+		playback->file = nullptr;
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef RELWARB_REPLAY_H
+#define RELWARB_REPLAY_H
+
+#include <stdio.h>
+
+#include "relwarb_defines.h"
+#include "relwarb_input.h"
+
+struct GameState;
+
+// NOTE(Charly): What is needed to start the same session again
+struct ReplayHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 nbFrames;
+
+	uint32 seed;
+	bool32 deterministic;
+	real32 fixedDt;
+};
+
+// NOTE(Charly): Records the input and dt fed to StepGame every frame. Each frame is stored as the
+//               xor with the previous one, with runs of unchanged words skipped, and runs of
+//               identical frames collapsed in a single record.
+struct InputRecorder
+{
+	FILE*        file;
+	ReplayHeader header;
+
+	InputState lastInput;
+	real32     lastDt;
+	uint32     nbPendingRepeats;
+};
+
+struct InputPlayback
+{
+	FILE*        file;
+	ReplayHeader header;
+	uint32       frame;
+
+	InputState input;
+	real32     dt;
+	uint32     nbPendingRepeats;
+};
+
+// NOTE(Charly): Must be called after InitGame, the seed and the clock settings are taken from
+//               the game state.
+bool32 BeginInputRecording(InputRecorder* recorder, const char* filename, GameState* gameState);
+void   RecordInputFrame(InputRecorder* recorder, const InputState* input, real32 dt);
+void   EndInputRecording(InputRecorder* recorder);
+
+// NOTE(Charly): Must be called before InitGame, since it sets the seed and clock settings of the
+//               recorded session in the game state.
+bool32 BeginInputPlayback(InputPlayback* playback, const char* filename, GameState* gameState);
+// NOTE(Charly): Returns false once all the frames have been played
+bool32 PlaybackInputFrame(InputPlayback* playback, InputState* input, real32* dt);
+void   EndInputPlayback(InputPlayback* playback);
+
+#endif // RELWARB_REPLAY_H
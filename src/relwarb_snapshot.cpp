@@ -0,0 +1,329 @@
+#include "relwarb_snapshot.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <chrono>
+
+#include "relwarb.h"
+#include "relwarb_entity.h"
+#include "relwarb_debug.h"
+
+// NOTE(Charly): Layout of a snapshot:
+//               - SnapshotHeader
+//               - Entities, rigid bodies, shapes, sprites (used part of the arrays only)
+//               - For each particle system that is alive or still has particles:
+//                 its index, the system itself, then its particles
+struct SnapshotHeader
+{
+	uint32 nbEntities;
+	uint32 nbRigidBodies;
+	uint32 nbShapes;
+	uint32 nbSprites;
+	uint32 nbPlayers;
+	uint32 nbParticleSystems;
+
+	Entity*  players[MAX_PLAYERS];
+	z::vec2  gravity;
+	GameMode mode;
+	bool32   slowDownTime;
+
+	InputState inputState;
+	InputState lastInputState;
+
+	z::RandomSeries rng;
+	uint32          tick;
+};
+
+typedef std::chrono::steady_clock SnapshotClock;
+
+internal real32 GetElapsedMicroseconds(SnapshotClock::time_point start)
+{
+	std::chrono::duration<real32, std::micro> elapsed = SnapshotClock::now() - start;
+	return elapsed.count();
+}
+
+internal bool32 IsParticleSystemSaved(const ParticleSystem* system)
+{
+	bool32 result = system->alive || system->nbParticles > 0;
+	return result;
+}
+
+internal uint8* WriteBytes(uint8* cursor, const void* src, size_t size)
+{
+	memcpy(cursor, src, size);
+	return cursor + size;
+}
+
+internal const uint8* ReadBytes(const uint8* cursor, void* dst, size_t size)
+{
+	memcpy(dst, cursor, size);
+	return cursor + size;
+}
+
+size_t GetSnapshotSize(GameState* gameState)
+{
+	size_t result = sizeof(SnapshotHeader);
+	result += gameState->nbEntities * sizeof(Entity);
+	result += gameState->nbRigidBodies * sizeof(RigidBody);
+	result += gameState->nbShapes * sizeof(Shape);
+	result += gameState->nbSprites * sizeof(Sprite);
+
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		const ParticleSystem* system = gameState->particleSystems + systemIdx;
+		if (IsParticleSystemSaved(system))
+		{
+			result += sizeof(uint32) + sizeof(ParticleSystem);
+			result += system->nbParticles * sizeof(Particle);
+		}
+	}
+
+	return result;
+}
+
+internal void WriteSnapshot(GameState* gameState, WorldSnapshot* snapshot)
+{
+	SnapshotHeader header    = {};
+	header.nbEntities        = gameState->nbEntities;
+	header.nbRigidBodies     = gameState->nbRigidBodies;
+	header.nbShapes          = gameState->nbShapes;
+	header.nbSprites         = gameState->nbSprites;
+	header.nbPlayers         = gameState->nbPlayers;
+	header.nbParticleSystems = 0;
+	header.gravity           = gameState->gravity;
+	header.mode              = gameState->mode;
+	header.slowDownTime      = gameState->slowDownTime;
+	header.inputState        = gameState->inputState;
+	header.lastInputState    = gameState->lastInputState;
+	header.rng               = gameState->rng;
+	header.tick              = gameState->tick;
+	memcpy(header.players, gameState->players, sizeof(header.players));
+
+	uint8* cursor = snapshot->data + sizeof(SnapshotHeader);
+	cursor        = WriteBytes(cursor, gameState->entities, header.nbEntities * sizeof(Entity));
+	cursor = WriteBytes(cursor, gameState->rigidBodies, header.nbRigidBodies * sizeof(RigidBody));
+	cursor = WriteBytes(cursor, gameState->shapes, header.nbShapes * sizeof(Shape));
+	cursor = WriteBytes(cursor, gameState->sprites, header.nbSprites * sizeof(Sprite));
+
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		const ParticleSystem* system = gameState->particleSystems + systemIdx;
+		if (IsParticleSystemSaved(system))
+		{
+			cursor = WriteBytes(cursor, &systemIdx, sizeof(uint32));
+			cursor = WriteBytes(cursor, system, sizeof(ParticleSystem));
+			cursor = WriteBytes(cursor, system->particles, system->nbParticles * sizeof(Particle));
+			++header.nbParticleSystems;
+		}
+	}
+
+	WriteBytes(snapshot->data, &header, sizeof(SnapshotHeader));
+	snapshot->size = cursor - snapshot->data;
+}
+
+internal void ReadSnapshot(GameState* gameState, const WorldSnapshot* snapshot)
+{
+	SnapshotHeader header;
+	const uint8*   cursor = ReadBytes(snapshot->data, &header, sizeof(SnapshotHeader));
+
+	gameState->nbEntities     = header.nbEntities;
+	gameState->nbRigidBodies  = header.nbRigidBodies;
+	gameState->nbShapes       = header.nbShapes;
+	gameState->nbSprites      = header.nbSprites;
+	gameState->nbPlayers      = header.nbPlayers;
+	gameState->gravity        = header.gravity;
+	gameState->mode           = header.mode;
+	gameState->slowDownTime   = header.slowDownTime;
+	gameState->inputState     = header.inputState;
+	gameState->lastInputState = header.lastInputState;
+	gameState->rng            = header.rng;
+	gameState->tick           = header.tick;
+	memcpy(gameState->players, header.players, sizeof(header.players));
+
+	cursor = ReadBytes(cursor, gameState->entities, header.nbEntities * sizeof(Entity));
+	cursor = ReadBytes(cursor, gameState->rigidBodies, header.nbRigidBodies * sizeof(RigidBody));
+	cursor = ReadBytes(cursor, gameState->shapes, header.nbShapes * sizeof(Shape));
+	cursor = ReadBytes(cursor, gameState->sprites, header.nbSprites * sizeof(Sprite));
+
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		ParticleSystem* system = gameState->particleSystems + systemIdx;
+		system->alive          = false;
+		system->nbParticles    = 0;
+	}
+
+	for (uint32 savedIdx = 0; savedIdx < header.nbParticleSystems; ++savedIdx)
+	{
+		uint32 systemIdx;
+		cursor = ReadBytes(cursor, &systemIdx, sizeof(uint32));
+		Assert(systemIdx < MAX_PARTICLE_SYSTEMS);
+
+		// NOTE(Charly): Pools only ever grow, so the current one is at least as big as the saved
+		//               one. Keep it, otherwise we would leak world memory on every restore.
+		ParticleSystem* system       = gameState->particleSystems + systemIdx;
+		Particle*       particles    = system->particles;
+		uint32          maxParticles = system->maxParticles;
+
+		cursor               = ReadBytes(cursor, system, sizeof(ParticleSystem));
+		system->particles    = particles;
+		system->maxParticles = maxParticles;
+		Assert(system->nbParticles <= system->maxParticles);
+
+		cursor = ReadBytes(cursor, system->particles, system->nbParticles * sizeof(Particle));
+	}
+
+	Assert((size_t)(cursor - snapshot->data) == snapshot->size);
+}
+
+void InitSnapshotRing(SnapshotRing* ring, void* memory, size_t size, uint32 nbSnapshots)
+{
+	Assert(nbSnapshots > 0);
+
+	// NOTE(Charly): Slot descriptors first, then the slots, 64 bytes aligned
+	size_t descriptorsSize = (nbSnapshots * sizeof(WorldSnapshot) + 63) & ~(size_t)63;
+	Assert(descriptorsSize < size);
+
+	ring->nbSnapshots      = nbSnapshots;
+	ring->snapshotCapacity = ((size - descriptorsSize) / nbSnapshots) & ~(size_t)63;
+	ring->snapshots        = (WorldSnapshot*)memory;
+	ring->lastSaveTime     = 0.f;
+	ring->lastRestoreTime  = 0.f;
+
+	uint8* slots = (uint8*)memory + descriptorsSize;
+	for (uint32 snapshotIdx = 0; snapshotIdx < nbSnapshots; ++snapshotIdx)
+	{
+		WorldSnapshot* snapshot = ring->snapshots + snapshotIdx;
+		snapshot->frame         = 0;
+		snapshot->valid         = false;
+		snapshot->size          = 0;
+		snapshot->data          = slots + snapshotIdx * ring->snapshotCapacity;
+	}
+}
+
+WorldSnapshot* SaveSnapshot(SnapshotRing* ring, GameState* gameState, uint32 frame)
+{
+	SnapshotClock::time_point start = SnapshotClock::now();
+
+	WorldSnapshot* result = ring->snapshots + (frame % ring->nbSnapshots);
+	result->valid         = false;
+
+	size_t size = GetSnapshotSize(gameState);
+	if (size > ring->snapshotCapacity)
+	{
+		Log(Log_Error, "World snapshot too big (%zu / %zu bytes)", size, ring->snapshotCapacity);
+		return nullptr;
+	}
+
+	WriteSnapshot(gameState, result);
+	Assert(result->size == size);
+	result->frame = frame;
+	result->valid = true;
+
+	ring->lastSaveTime = GetElapsedMicroseconds(start);
+
+	return result;
+}
+
+bool32 RestoreSnapshot(SnapshotRing* ring, GameState* gameState, uint32 frame)
+{
+	SnapshotClock::time_point start = SnapshotClock::now();
+
+	const WorldSnapshot* snapshot = ring->snapshots + (frame % ring->nbSnapshots);
+	if (!snapshot->valid || snapshot->frame != frame)
+	{
+		return false;
+	}
+
+	ReadSnapshot(gameState, snapshot);
+
+	ring->lastRestoreTime = GetElapsedMicroseconds(start);
+
+	return true;
+}
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+internal uint64 HashBytes(uint64 hash, const void* data, size_t size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+	{
+		hash ^= bytes[byteIdx];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+// NOTE(Charly): Hash the [first, last] members of a struct, which must be contiguous and
+//               padding free
+#define HashMembers(hash, object, type, first, last)                                             \
+	HashBytes(hash,                                                                               \
+	          (const uint8*)(object) + offsetof(type, first),                                     \
+	          offsetof(type, last) + sizeof((object)->last) - offsetof(type, first))
+
+// NOTE(Charly): Padding holds garbage and would make the checksum differ between identical runs.
+//               The ranges hashed below are the sum of their members, update both together.
+#define HashedSize(type, first, last) (offsetof(type, last) + sizeof(((type*)0)->last) - offsetof(type, first))
+
+static_assert(HashedSize(Entity, entityType, status) ==
+                  sizeof(EntityType) + sizeof(uint32) + 3 * sizeof(z::vec2) + sizeof(int32) + 5 * sizeof(uint32),
+              "Entity [entityType, status] is hashed raw, it must be padding free");
+static_assert(HashedSize(Entity, playerSpeed, controllerId) ==
+                  7 * sizeof(real32) + 3 * sizeof(bool32) + sizeof(int) + sizeof(int32),
+              "Entity [playerSpeed, controllerId] is hashed raw, it must be padding free");
+static_assert(sizeof(Skill) - offsetof(Skill, isActive) == sizeof(bool32) + sizeof(Skill::dash),
+              "Skills are hashed raw from isActive, dash must be the largest data and the end padding free");
+static_assert(sizeof(RigidBody) == sizeof(z::vec2) + sizeof(real32), "RigidBody is hashed raw, it must be padding free");
+static_assert(sizeof(Shape) == 2 * sizeof(z::vec2), "Shape is hashed raw, it must be padding free");
+
+uint64 ComputeSimulationChecksum(GameState* gameState)
+{
+	uint64 result = FNV_OFFSET_BASIS;
+
+	for (uint32 entityIdx = 0; entityIdx < gameState->nbEntities; ++entityIdx)
+	{
+		const Entity* entity = gameState->entities + entityIdx;
+		result               = HashMembers(result, entity, Entity, entityType, status);
+		result               = HashMembers(result, entity, Entity, playerSpeed, controllerId);
+
+		for (uint32 skillIdx = 0; skillIdx < NB_SKILLS; ++skillIdx)
+		{
+			// NOTE(Charly): Skips the handles, hashes the active flag and the data union
+			const Skill* skill = entity->skills + skillIdx;
+			result             = HashBytes(result,
+                               &skill->isActive,
+                               sizeof(Skill) - offsetof(Skill, isActive));
+		}
+	}
+
+	result = HashBytes(result, gameState->rigidBodies, gameState->nbRigidBodies * sizeof(RigidBody));
+	result = HashBytes(result, gameState->shapes, gameState->nbShapes * sizeof(Shape));
+
+	for (uint32 spriteIdx = 0; spriteIdx < gameState->nbSprites; ++spriteIdx)
+	{
+		const Sprite* sprite = gameState->sprites + spriteIdx;
+		if (sprite->spriteType == SpriteType_Timed)
+		{
+			result = HashBytes(result, &sprite->currentStep, sizeof(sprite->currentStep));
+			result = HashBytes(result, &sprite->elapsed, sizeof(sprite->elapsed));
+		}
+	}
+
+	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
+	{
+		const ParticleSystem* system = gameState->particleSystems + systemIdx;
+		if (IsParticleSystemSaved(system))
+		{
+			result = HashBytes(result, &systemIdx, sizeof(uint32));
+			result = HashBytes(result, &system->systemLife, sizeof(system->systemLife));
+			result = HashBytes(result, &system->nbParticles, sizeof(system->nbParticles));
+			result = HashBytes(result, system->particles, system->nbParticles * sizeof(Particle));
+		}
+	}
+
+	result = HashBytes(result, &gameState->rng.state, sizeof(gameState->rng.state));
+
+	return result;
+}
@@ -0,0 +1,51 @@
+#ifndef RELWARB_SNAPSHOT_H
+#define RELWARB_SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "relwarb_defines.h"
+
+struct GameState;
+
+// NOTE(Charly): A snapshot holds the simulation state only (entities, bodies, shapes, sprites
+//               animation, particles, inputs...), not the assets. It can only be restored in
+//               the GameState it was taken from: pointers are saved as is.
+struct WorldSnapshot
+{
+	uint32 frame;
+	bool32 valid;
+
+	size_t size;
+	uint8* data;
+};
+
+// NOTE(Charly): Preallocated ring of snapshots, indexed by frame number
+struct SnapshotRing
+{
+	uint32         nbSnapshots;
+	size_t         snapshotCapacity;
+	WorldSnapshot* snapshots;
+
+	// NOTE(Charly): Cost of the last operations, in microseconds
+	real32 lastSaveTime;
+	real32 lastRestoreTime;
+};
+
+// NOTE(Charly): Split memory in nbSnapshots slots of equal size
+void InitSnapshotRing(SnapshotRing* ring, void* memory, size_t size, uint32 nbSnapshots);
+
+// NOTE(Charly): Number of bytes a snapshot of the current world takes
+size_t GetSnapshotSize(GameState* gameState);
+
+// NOTE(Charly): Overwrites the snapshot of frame - nbSnapshots. Returns nullptr if the world
+//               does not fit in a slot.
+WorldSnapshot* SaveSnapshot(SnapshotRing* ring, GameState* gameState, uint32 frame);
+
+// NOTE(Charly): Fails if the frame is not in the ring anymore (or never was)
+bool32 RestoreSnapshot(SnapshotRing* ring, GameState* gameState, uint32 frame);
+
+// NOTE(Charly): FNV-1a hash of the simulation state. Only values are hashed, never pointers, so
+//               two runs (or two machines) with the same seed and inputs must agree tick by tick.
+uint64 ComputeSimulationChecksum(GameState* gameState);
+
+#endif // RELWARB_SNAPSHOT_H
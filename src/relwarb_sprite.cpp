@@ -0,0 +1,114 @@
+#include "relwarb_renderer.h"
+
+#include <string.h>
+
+#include "relwarb.h"
+#include "relwarb_debug.h"
+#include "relwarb_memory.h"
+
+// NOTE(Charly): Sprites and rendering patterns are plain data owned by the game state. They are
+//               kept away from the GL code so that the simulation can be built without it.
+
+Sprite* CreateStillSprite(GameState* gameState, Bitmap* bitmap)
+{
+    ComponentID id = gameState->nbSprites++;
+    Assert(id < WORLD_SIZE);
+
+    Sprite* result = &gameState->sprites[id];
+    result->spriteType = SpriteType_Still;
+    result->stillSprite = bitmap;
+
+    return result;
+}
+
+Sprite* CreateTimeSprite(GameState* gameState, uint32 nbBitmaps, Bitmap** bitmaps, real32 stepTime, bool32 active)
+{
+    ComponentID id = gameState->nbSprites++;
+    Assert(id < WORLD_SIZE);
+
+    Sprite* result = &gameState->sprites[id];
+    result->spriteType = SpriteType_Timed;
+    result->nbSteps = nbBitmaps;
+    result->steps = PushArray(&gameState->worldArena, nbBitmaps, Bitmap*);
+    memcpy(result->steps, bitmaps, nbBitmaps * sizeof(Bitmap*));
+    result->currentStep = 0;
+    result->stepTime = stepTime;
+    result->active = active;
+
+    return result;
+}
+
+Bitmap* GetSpriteBitmap(const Sprite* sprite)
+{
+    switch (sprite->spriteType)
+    {
+        case SpriteType_Still:
+        {
+            return sprite->stillSprite;
+        } break;
+        case SpriteType_Timed:
+        {
+            return sprite->steps[sprite->currentStep];
+        } break;
+        default:
+            Assert(false);
+            return nullptr;
+    }
+}
+
+RenderingPattern* CreateUniqueRenderingPattern( GameState* gameState,
+                                                Sprite* sprite)
+{
+    ComponentID id = gameState->nbPatterns++;
+    Assert(id < WORLD_SIZE);
+
+    RenderingPattern* result = &gameState->patterns[id];
+    result->patternType = RenderingPattern_Unique;
+    result->unique = sprite;
+
+    return result;
+}
+
+void UpdateSpriteTime(Sprite* sprite, real32 dt)
+{
+    if (sprite->spriteType == SpriteType_Timed && sprite->active)
+    {
+        sprite->elapsed += dt;
+        if (sprite->elapsed > sprite->stepTime)
+        {
+            sprite->currentStep++;
+            sprite->elapsed -= sprite->stepTime;
+            if (sprite->currentStep >= sprite->nbSteps)
+
+            {
+                sprite->currentStep = 0;
+            }
+        }
+    }
+}
+
+RenderingPattern* CreateFillRenderingPattern(GameState* gameState,
+                                             z::vec2 size,
+                                             uint8* pattern,
+                                             uint8 nbBitmaps,
+                                             Bitmap** bitmaps)
+{
+    ComponentID id = gameState->nbPatterns++;
+    Assert(id < WORLD_SIZE);
+
+    RenderingPattern* result = &gameState->patterns[id];
+    result->size = size;
+    result->patternType = RenderingPattern_Fill;
+    result->pattern = PushArray(&gameState->worldArena, (int32)(size.x * size.y), uint8);
+    memcpy(result->pattern, pattern, size.x * size.y * sizeof(uint8));
+    result->tiles = PushArray(&gameState->worldArena, nbBitmaps, Bitmap*);
+    memcpy(result->tiles, bitmaps, nbBitmaps * sizeof(Bitmap*));
+
+    return result;
+}
+
+void AddRenderingPatternToEntity(Entity* entity, RenderingPattern* pattern)
+{
+    entity->pattern = pattern;
+    SetEntityComponent(entity, ComponentFlag_Renderable);
+}
@@ -0,0 +1,180 @@
+#include "relwarb_stress_scene.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "relwarb.h"
+#include "relwarb_debug.h"
+#include "relwarb_entity.h"
+#include "relwarb_math.h"
+#include "relwarb_renderer.h"
+#include "relwarb_world_sim.h"
+
+// NOTE(Charly): Every platform gets a cell, and stays 2 units away from the cell borders on the
+//               right and on the top, so that players fit between platforms
+#define STRESS_CELL_WIDTH 10.f
+#define STRESS_CELL_HEIGHT 5.f
+#define STRESS_MAX_PLATFORM_WIDTH 8
+#define STRESS_MAX_PLATFORM_HEIGHT 2
+
+// NOTE(Charly): Right above the ceiling of the base map
+#define STRESS_ARENA_BOTTOM 13.f
+
+// NOTE(Charly): Every system takes its particle pool in the world arena
+#define MAX_STRESS_PARTICLE_SYSTEMS 256
+
+// NOTE(Charly): Tiles of the base map platforms, the bitmaps are loaded in the order of
+//               config/base_map.ini
+global_variable uint8 stressPlatformPattern[]  = {1, 2, 3, 4, 5, 6};
+global_variable uint8 stressPlatformBitmaps[] = {6, 7, 8, 1, 2, 3};
+
+internal Entity* CreateStressWall(GameState* gameState, z::vec2 p, z::vec2 size, RenderingPattern* pattern)
+{
+	Shape*  shape  = CreateShape(gameState, size);
+	Entity* result = CreateWallEntity(gameState, p, pattern, shape);
+	return result;
+}
+
+bool32 GenerateStressScene(GameState* gameState, const StressSceneParams* params)
+{
+	bool32 result = true;
+
+	z::RandomSeries series = z::SeedRandomSeries(params->seed ^ 0x57e55u);
+
+	// NOTE(Charly): Platforms, floor and side walls each take an entity and a shape
+	uint32 nbPlatforms = params->nbPlatforms;
+	uint32 nbFree      = WORLD_SIZE - (gameState->nbEntities > gameState->nbShapes ? gameState->nbEntities
+	                                                                                 : gameState->nbShapes);
+	if (nbPlatforms + 3 + params->nbBots > nbFree)
+	{
+		Log(Log_Warning, "Stress scene: %u platforms do not fit in the world", nbPlatforms);
+		nbPlatforms = nbFree > 3 + params->nbBots ? nbFree - 3 - params->nbBots : 0;
+		result      = false;
+	}
+
+	Bitmap* tiles[sizeof(stressPlatformBitmaps)];
+	for (uint32 tileIdx = 0; tileIdx < sizeof(stressPlatformBitmaps); ++tileIdx)
+	{
+		tiles[tileIdx] = gameState->bitmaps + stressPlatformBitmaps[tileIdx] - 1;
+	}
+	RenderingPattern* pattern = CreateFillRenderingPattern(gameState,
+	                                                       z::Vec2(3, 2),
+	                                                       stressPlatformPattern,
+	                                                       sizeof(stressPlatformBitmaps),
+	                                                       tiles);
+
+	// NOTE(Charly): About twice as wide as high
+	uint32 nbColumns = 1;
+	while (nbColumns * nbColumns < 2 * nbPlatforms)
+	{
+		++nbColumns;
+	}
+	uint32 nbRows = (nbPlatforms + nbColumns - 1) / nbColumns;
+
+	real32 arenaWidth  = nbColumns * STRESS_CELL_WIDTH;
+	real32 arenaHeight = (nbRows + 1) * STRESS_CELL_HEIGHT;
+	real32 arenaLeft   = -0.5f * arenaWidth;
+	real32 arenaFloor  = STRESS_ARENA_BOTTOM + 1.f;
+
+	CreateStressWall(gameState,
+	                 z::Vec2(0.f, STRESS_ARENA_BOTTOM + 0.5f),
+	                 z::Vec2(arenaWidth + 2.f, 1.f),
+	                 pattern);
+
+	// NOTE(Charly): Half a unit above the floor, touching walls would collide
+	real32 wallHeight = arenaHeight;
+	real32 wallY      = arenaFloor + 0.5f + 0.5f * wallHeight;
+	CreateStressWall(gameState, z::Vec2(arenaLeft - 0.5f, wallY), z::Vec2(1.f, wallHeight), pattern);
+	CreateStressWall(gameState, z::Vec2(-arenaLeft + 0.5f, wallY), z::Vec2(1.f, wallHeight), pattern);
+
+	uint32 firstPlatform = gameState->nbEntities;
+	for (uint32 platformIdx = 0; platformIdx < nbPlatforms; ++platformIdx)
+	{
+		real32 cellLeft   = arenaLeft + (platformIdx % nbColumns) * STRESS_CELL_WIDTH;
+		real32 cellBottom = arenaFloor + 2.f + (platformIdx / nbColumns) * STRESS_CELL_HEIGHT;
+
+		z::vec2 size = z::Vec2((real32)(2 + z::NextRandom(&series) % (STRESS_MAX_PLATFORM_WIDTH - 1)),
+		                       (real32)(1 + z::NextRandom(&series) % STRESS_MAX_PLATFORM_HEIGHT));
+
+		real32  slackX = STRESS_CELL_WIDTH - 2.f - size.x;
+		real32  slackY = STRESS_CELL_HEIGHT - 2.f - size.y;
+		z::vec2 p      = z::Vec2(cellLeft + 0.5f * size.x + z::GenerateRandBetween(&series, 0.f, slackX),
+                                 cellBottom + 0.5f * size.y + z::GenerateRandBetween(&series, 0.f, slackY));
+
+		CreateStressWall(gameState, p, size, pattern);
+	}
+
+	// NOTE(Charly): Bots look like the first player, and land on a random platform
+	uint32 nbBots = params->nbBots;
+	if (gameState->nbPlayers == 0)
+	{
+		nbBots = 0;
+	}
+	else if (gameState->nbPlayers + nbBots > MAX_PLAYERS)
+	{
+		Log(Log_Warning, "Stress scene: only %u bots fit", MAX_PLAYERS - gameState->nbPlayers);
+		nbBots = MAX_PLAYERS - gameState->nbPlayers;
+		result = false;
+	}
+
+	const Entity* model = gameState->players[0];
+	for (uint32 botIdx = 0; botIdx < nbBots; ++botIdx)
+	{
+		z::vec2 p = z::Vec2(z::GenerateRandBetween(&series, arenaLeft + 1.f, -arenaLeft - 1.f), arenaFloor + 1.f);
+		if (nbPlatforms > 0)
+		{
+			const Entity* platform = gameState->entities + firstPlatform + z::NextRandom(&series) % nbPlatforms;
+			p = platform->p + z::Vec2(0.f, 0.5f * platform->shape->size.y + 1.f);
+		}
+
+		// NOTE(Charly): Game logic reads the controller of a player at the player's index
+		int32 controllerId = (int32)gameState->nbPlayers;
+		ConfigureBotController(gameState, controllerId, params->botBehavior, params->seed * 7919u + botIdx);
+		CreatePlayerEntity(gameState, p, model->pattern, model->shape, controllerId);
+	}
+
+	uint32 nbSystems = params->nbParticleSystems;
+	if (nbSystems > MAX_STRESS_PARTICLE_SYSTEMS)
+	{
+		Log(Log_Warning, "Stress scene: only %u particle systems fit", MAX_STRESS_PARTICLE_SYSTEMS);
+		nbSystems = MAX_STRESS_PARTICLE_SYSTEMS;
+		result    = false;
+	}
+
+	for (uint32 systemIdx = 0; systemIdx < nbSystems; ++systemIdx)
+	{
+		z::vec2 p = z::Vec2(z::GenerateRandBetween(&series, arenaLeft, -arenaLeft),
+		                    z::GenerateRandBetween(&series, arenaFloor, arenaFloor + arenaHeight));
+
+		// NOTE(Charly): The pool is sized at spawn, the system only keeps on recycling it
+		ParticleSystem* system = SpawnParticleSystem(gameState, p);
+		system->systemLife     = 1e9f;
+	}
+
+	return result;
+}
+
+bool32 ParseStressSceneParams(const char* string, StressSceneParams* params)
+{
+	uint32* counts[] = {&params->nbPlatforms, &params->nbBots, &params->nbParticleSystems};
+	for (uint32 countIdx = 0; countIdx < 3; ++countIdx)
+	{
+		*counts[countIdx] = 0;
+	}
+
+	const char* c = string;
+	for (uint32 countIdx = 0; countIdx < 3 && *c; ++countIdx)
+	{
+		char* end         = nullptr;
+		*counts[countIdx] = (uint32)strtoul(c, &end, 10);
+		if (end == c)
+		{
+			return false;
+		}
+
+		c = *end == ',' ? end + 1 : end;
+	}
+
+	bool32 result = *c == '\0';
+	return result;
+}
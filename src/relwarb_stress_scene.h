@@ -0,0 +1,32 @@
+#ifndef RELWARB_STRESS_SCENE_H
+#define RELWARB_STRESS_SCENE_H
+
+#include "relwarb_defines.h"
+#include "relwarb_controller.h"
+
+struct GameState;
+
+// NOTE(Charly): Synthetic worlds for scaling tests. A stress scene is built on top of the
+//               loaded base map, in an arena above its ceiling: a floor, two side walls, and
+//               platforms of random sizes laid out on a grid so that no two walls ever overlap.
+//               Bots (players on bot controllers) are dropped above random platforms and
+//               particle systems that never die are spread over the arena.
+//
+//               The same parameters always give the same scene, whatever the platform.
+
+struct StressSceneParams
+{
+	uint32      seed;
+	uint32      nbPlatforms;
+	uint32      nbBots;            // NOTE(Charly): Clamped to the free player slots
+	uint32      nbParticleSystems; // NOTE(Charly): Clamped to 256, every system has its own pool
+	BotBehavior botBehavior;
+};
+
+// NOTE(Charly): Call after InitGame. Returns false (and builds what fits) when the world is full.
+bool32 GenerateStressScene(GameState* gameState, const StressSceneParams* params);
+
+// NOTE(Charly): Command line form, "platforms,bots,systems" (missing counts are 0)
+bool32 ParseStressSceneParams(const char* string, StressSceneParams* params);
+
+#endif // RELWARB_STRESS_SCENE_H
@@ -0,0 +1,333 @@
+#include "relwarb_trace.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "relwarb_debug.h"
+#include "relwarb_memory.h"
+#include "relwarb_platform.h"
+
+#define TRACE_QUEUE_SIZE 256
+#define TRACE_WRITE_BUFFER_SIZE Megabytes(1)
+#define MAX_TRACE_FILENAME 256
+
+struct TraceFrame
+{
+	uint32        threadIdx;
+	const char*   threadName;
+	ProfilerFrame frame;
+};
+
+struct TraceCapture
+{
+	// NOTE(Charly): Serializes Begin / End, the capture may be ended from any thread
+	std::mutex          controlMutex;
+	std::atomic<bool32> running;
+
+	char   filename[MAX_TRACE_FILENAME];
+	uint64 startTicks;
+	uint32 countingThread;
+	uint32 nbFramesLeft;
+
+	// NOTE(Charly): Producers copy frames in at writeIdx, the writer reads them at readIdx and
+	//               only gives a slot back once it is written out
+	std::mutex              queueMutex;
+	std::condition_variable wakeUp;
+	TraceFrame*             queue;
+	uint32                  readIdx;
+	uint32                  writeIdx;
+	bool32                  accepting;
+	uint32                  nbDropped;
+
+	// NOTE(Charly): Owns the queue until joined, which is left to the next Begin or to End
+	std::thread         writer;
+	std::atomic<bool32> writerDone;
+};
+
+global_variable TraceCapture g_trace;
+
+// NOTE(Charly): Names come from the code, but an operator name or a template could still hold
+//               characters JSON does not like
+internal void WriteTraceString(FILE* file, const char* string)
+{
+	fputc('"', file);
+	for (const char* c = string; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+		}
+		fputc((uint8)*c >= 32 ? *c : ' ', file);
+	}
+	fputc('"', file);
+}
+
+internal void WriteTraceFrame(FILE* file, const TraceFrame* traceFrame, bool32* threadNamed)
+{
+	const ProfilerFrame* frame      = &traceFrame->frame;
+	uint32               tid        = traceFrame->threadIdx + 1;
+	real64               ticksPerUs = GetProfilerTicksPerMs() / 1000.0;
+
+	if (traceFrame->threadIdx < MAX_PROFILER_THREADS && !threadNamed[traceFrame->threadIdx])
+	{
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", tid);
+		WriteTraceString(file, traceFrame->threadName);
+		fprintf(file, "}}");
+		threadNamed[traceFrame->threadIdx] = true;
+	}
+
+	real64 frameBegin = (frame->begin - g_trace.startTicks) / ticksPerUs;
+	real64 frameEnd   = (frame->end - g_trace.startTicks) / ticksPerUs;
+	fprintf(file,
+	        ",\n{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+	        "\"dur\":%.3f,\"args\":{\"index\":%u}}",
+	        tid,
+	        frameBegin,
+	        frameEnd - frameBegin,
+	        frame->index);
+
+	for (uint32 blockIdx = 0; blockIdx < frame->nbBlocks; ++blockIdx)
+	{
+		const ProfileBlock* block = frame->blocks + blockIdx;
+		fprintf(file, ",\n{\"name\":");
+		WriteTraceString(file, block->name);
+		fprintf(file,
+		        ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+		        tid,
+		        (block->begin - g_trace.startTicks) / ticksPerUs,
+		        (block->end - block->begin) / ticksPerUs);
+	}
+
+	for (uint32 counterIdx = 0; counterIdx < frame->nbCounters; ++counterIdx)
+	{
+		const ProfileCounter* counter = frame->counters + counterIdx;
+		fprintf(file, ",\n{\"name\":");
+		WriteTraceString(file, counter->name);
+		fprintf(file,
+		        ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+		        tid,
+		        frameEnd,
+		        counter->value);
+	}
+}
+
+internal void RunTraceWriter()
+{
+	// NOTE(Charly): Opened here, the thread asking for the capture should not wait on the disk
+	FILE* file = fopen(g_trace.filename, "wb");
+	if (file)
+	{
+		setvbuf(file, nullptr, _IOFBF, TRACE_WRITE_BUFFER_SIZE);
+		fprintf(file,
+		        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"relwarb\"}}");
+	}
+	else
+	{
+		Log(Log_Error, "Trace: could not open %s", g_trace.filename);
+	}
+
+	bool32 threadNamed[MAX_PROFILER_THREADS] = {};
+	uint32 nbWritten                         = 0;
+
+	std::unique_lock<std::mutex> lock(g_trace.queueMutex);
+	for (;;)
+	{
+		while (g_trace.readIdx == g_trace.writeIdx && g_trace.accepting)
+		{
+			g_trace.wakeUp.wait(lock);
+		}
+
+		if (g_trace.readIdx == g_trace.writeIdx)
+		{
+			break;
+		}
+
+		const TraceFrame* traceFrame = g_trace.queue + g_trace.readIdx % TRACE_QUEUE_SIZE;
+		lock.unlock();
+
+		if (file)
+		{
+			WriteTraceFrame(file, traceFrame, threadNamed);
+			++nbWritten;
+		}
+
+		lock.lock();
+		++g_trace.readIdx;
+	}
+	lock.unlock();
+
+	if (file)
+	{
+		fprintf(file, "\n]}\n");
+		fclose(file);
+
+		Log(Log_Info,
+		    "Trace: %u frames written to %s, %u dropped",
+		    nbWritten,
+		    g_trace.filename,
+		    g_trace.nbDropped);
+	}
+
+	g_trace.writerDone.store(true, std::memory_order_release);
+}
+
+// NOTE(Charly): Both with controlMutex held. Stopping only tells the writer to finish, producers
+//               then never touch the queue again and the writer drains it on its own.
+internal void StopTraceCapture()
+{
+	if (!g_trace.running.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	g_trace.running.store(false, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(g_trace.queueMutex);
+		g_trace.accepting = false;
+	}
+	g_trace.wakeUp.notify_one();
+}
+
+internal void JoinTraceWriter()
+{
+	if (!g_trace.writer.joinable())
+	{
+		return;
+	}
+
+	g_trace.writer.join();
+
+	PlatformFreeMemory(g_trace.queue, TRACE_QUEUE_SIZE * sizeof(TraceFrame));
+	g_trace.queue = nullptr;
+}
+
+bool32 BeginTraceCapture(const char* filename, uint32 nbFrames)
+{
+	std::lock_guard<std::mutex> control(g_trace.controlMutex);
+	if (g_trace.running.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	// NOTE(Charly): The writer of the previous capture, only joined once done: Begin may be called
+	//               from a frame (see ToggleTraceCapture)
+	if (g_trace.writer.joinable() && !g_trace.writerDone.load(std::memory_order_acquire))
+	{
+		Log(Log_Warning, "Trace: %s is still being written, try again later", g_trace.filename);
+		return false;
+	}
+	JoinTraceWriter();
+
+	g_trace.queue = (TraceFrame*)PlatformAllocateMemory(TRACE_QUEUE_SIZE * sizeof(TraceFrame));
+	if (!g_trace.queue)
+	{
+		return false;
+	}
+
+	snprintf(g_trace.filename, MAX_TRACE_FILENAME, "%s", filename);
+
+	// NOTE(Charly): A producer that saw the previous capture running may still be around
+	{
+		std::lock_guard<std::mutex> lock(g_trace.queueMutex);
+
+		uint32 threadIdx       = GetProfilerThreadIndex();
+		g_trace.countingThread = threadIdx != NOT_A_PROFILE_BLOCK ? threadIdx : 0;
+		g_trace.nbFramesLeft   = nbFrames;
+		g_trace.startTicks     = GetProfilerTicks();
+
+		g_trace.readIdx   = 0;
+		g_trace.writeIdx  = 0;
+		g_trace.nbDropped = 0;
+		g_trace.accepting = true;
+	}
+
+	// NOTE(Charly): Starting a thread hits the heap
+	AllowFrameHeapAllocations();
+	g_trace.writerDone.store(false, std::memory_order_relaxed);
+	g_trace.writer = std::thread(RunTraceWriter);
+
+	g_trace.running.store(true, std::memory_order_release);
+
+	Log(Log_Info, "Trace: capturing to %s", filename);
+
+	return true;
+}
+
+void EndTraceCapture()
+{
+	std::lock_guard<std::mutex> control(g_trace.controlMutex);
+	StopTraceCapture();
+	JoinTraceWriter();
+}
+
+bool32 IsTraceCaptureRunning()
+{
+	bool32 result = g_trace.running.load(std::memory_order_relaxed);
+	return result;
+}
+
+void ToggleTraceCapture()
+{
+	if (IsTraceCaptureRunning())
+	{
+		std::lock_guard<std::mutex> control(g_trace.controlMutex);
+		StopTraceCapture();
+	}
+	else
+	{
+		char filename[64];
+		snprintf(filename, 64, "trace_%u.json", (uint32)time(nullptr));
+		BeginTraceCapture(filename);
+	}
+}
+
+void SubmitTraceFrame(uint32 threadIdx, const char* threadName, const ProfilerFrame* frame)
+{
+	if (!g_trace.running.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	bool32 captureDone = false;
+	{
+		std::lock_guard<std::mutex> lock(g_trace.queueMutex);
+
+		// NOTE(Charly): Frames started before the capture would show up half empty
+		if (!g_trace.accepting || frame->begin < g_trace.startTicks)
+		{
+			return;
+		}
+
+		if (g_trace.writeIdx - g_trace.readIdx < TRACE_QUEUE_SIZE)
+		{
+			TraceFrame* traceFrame = g_trace.queue + g_trace.writeIdx % TRACE_QUEUE_SIZE;
+			traceFrame->threadIdx  = threadIdx;
+			traceFrame->threadName = threadName;
+			CopyProfilerFrame(&traceFrame->frame, frame);
+			++g_trace.writeIdx;
+		}
+		else
+		{
+			++g_trace.nbDropped;
+		}
+
+		if (threadIdx == g_trace.countingThread && g_trace.nbFramesLeft > 0)
+		{
+			captureDone = --g_trace.nbFramesLeft == 0;
+		}
+	}
+	g_trace.wakeUp.notify_one();
+
+	// NOTE(Charly): On the frame path, the writer is not waited for
+	if (captureDone)
+	{
+		std::lock_guard<std::mutex> control(g_trace.controlMutex);
+		StopTraceCapture();
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef RELWARB_TRACE_H
+#define RELWARB_TRACE_H
+
+#include "relwarb_defines.h"
+#include "relwarb_profiler.h"
+
+// NOTE(Charly): Timeline capture of the profiled frames, written as Chrome trace events (open it
+//               in chrome://tracing or ui.perfetto.dev). While a capture runs, every frame ended
+//               by a profiled thread is queued with its blocks and counters, and a background
+//               thread formats them and streams them to disk: the profiled threads only pay a
+//               copy of the frame.
+//
+//               Frames that do not fit in the queue are dropped (and counted), never waited for.
+
+// NOTE(Charly): With nbFrames = 0, captures until EndTraceCapture. Otherwise the capture ends by
+//               itself after nbFrames frames of the calling thread, or of the first profiled
+//               thread when the caller is not profiled. Fails, without waiting, while the file
+//               of the previous capture is still being written.
+bool32 BeginTraceCapture(const char* filename, uint32 nbFrames = 0);
+// NOTE(Charly): Waits for the file to be complete, call it at shutdown even when the capture
+//               already ended by itself
+void   EndTraceCapture();
+bool32 IsTraceCaptureRunning();
+
+// NOTE(Charly): For hotkeys, starts a capture in trace_<time>.json or ends the current one
+//               (without waiting for the file)
+void ToggleTraceCapture();
+
+// NOTE(Charly): Called by EndProfilerFrame
+void SubmitTraceFrame(uint32 threadIdx, const char* threadName, const ProfilerFrame* frame);
+
+#endif // RELWARB_TRACE_H
@@ -27,3 +27,40 @@ uint32 StrLength(const char* str)
 
     return result;
 }
+
+PercentileRank GetPercentileRank(uint32 nbSamples, real64 percentile)
+{
+    PercentileRank result = {};
+    if (nbSamples == 0)
+    {
+        return result;
+    }
+
+    real64 position = percentile * (nbSamples - 1);
+    if (position < 0.0)
+    {
+        position = 0.0;
+    }
+    else if (position > nbSamples - 1)
+    {
+        position = nbSamples - 1;
+    }
+
+    result.below = (uint32)position;
+    result.above = result.below + 1 < nbSamples ? result.below + 1 : result.below;
+    result.t     = position - result.below;
+    return result;
+}
+
+real64 GetPercentile(const real64* sortedSamples, uint32 nbSamples, real64 percentile)
+{
+    real64 result = 0.0;
+    if (nbSamples == 0)
+    {
+        return result;
+    }
+
+    PercentileRank rank = GetPercentileRank(nbSamples, percentile);
+    result = sortedSamples[rank.below] * (1.0 - rank.t) + sortedSamples[rank.above] * rank.t;
+    return result;
+}
@@ -12,4 +12,17 @@ bool32 StrEqual(const char* str1, const char* str2, int length);
 
 uint32 StrLength(const char* str);
 
+// NOTE(Charly): Percentile in [0, 1] of nbSamples sorted samples, at position percentile * (nbSamples - 1)
+//               and interpolated between the two samples around it. The bench, the frame times and
+//               the latency histograms all go through it so their numbers can be compared.
+struct PercentileRank
+{
+    uint32 below;
+    uint32 above;
+    real64 t; // NOTE(Charly): Weight of above
+};
+
+PercentileRank GetPercentileRank(uint32 nbSamples, real64 percentile);
+real64 GetPercentile(const real64* sortedSamples, uint32 nbSamples, real64 percentile);
+
 #endif // RELWARB_UTILS_H
\ No newline at end of file
@@ -1,121 +1,288 @@
 #include "relwarb_world_sim.h"
 
-#include <utility>
-#include <vector>
+#include <string.h>
 #include <algorithm>
 
 #include "relwarb_defines.h"
 #include "relwarb_utils.h"
 #include "relwarb_entity.h"
 #include "relwarb_debug.h"
+#include "relwarb_memory.h"
+#include "relwarb_jobs.h"
+#include "relwarb_profiler.h"
+#include "relwarb_input_events.h"
 #include "relwarb.h"
 
-void UpdateWorld(GameState* gameState, real32 dt)
+// NOTE(Charly): Shared by the parallel parts of UpdateWorld
+struct WorldUpdate
+{
+	GameState* gameState;
+	real32     dt;
+};
+
+struct CollisionPair
 {
+	Entity* first;
+	Entity* second;
+};
+
+// NOTE(Charly): Broadphase output of a range of first entities
+struct BroadphaseRange
+{
+	GameState*     gameState;
+	CollisionPair* pairs;
+	uint32         nbPairs;
+};
+
+#define MIN_ENTITIES_PER_INTEGRATION_JOB 64
+#define MIN_SYSTEMS_PER_PARTICLE_JOB 16
+#define MIN_ENTITIES_FOR_PARALLEL_BROADPHASE 128
+#define MAX_BROADPHASE_RANGES 64
+
+// NOTE(Charly): Only touches the player itself, players are integrated in parallel
+internal void IntegratePlayer(GameState* gameState, Entity* entity, real32 dt)
+{
+	// NOTE(Charly): We are updating a player, so we need to :
+	//  - Change x velocity based on left / right inputs
+	//  - If jump is pressed:
+	//      - Is it the start of a new jump ?
+	//          - Y: start jumping, compute gravity and velocity
+	//          based on current state and wished jump height,
+	//          keep track of the number of total jumps (gd related)
+	//          - N: update jumping elapsed time
+	//  - Else:
+	//      - Did we begin a jump and stopped early ?
+	//          - Change the gravity momentarily and track time
+
+	int32 controllerId = entity->controllerId;
+
+#define MAX_JUMP_TIME 0.25f
+#define MAX_STOP_TIME 0.05f
+#define MAX_NB_JUMPS 2
+
+	real32 oldX = entity->p.x;
+
+	z::vec2 acc  = z::Vec2(0, entity->gravity);
+	entity->dp.x = 0.0;
+
+	if (!(entity->status & (EntityStatus_Rooted | EntityStatus_Stunned)))
+	{
+		if (IsActionPressed(gameState, controllerId, Action_Left))
+		{
+			entity->dp.x += -10.0;
+		}
+
+		if (IsActionPressed(gameState, controllerId, Action_Right))
+		{
+			entity->dp.x += 10.0;
+		}
+
+		if (IsActionPressed(gameState, controllerId, Action_Jump))
+		{
+			if (IsActionRisingEdge(gameState, controllerId, Action_Jump) &&
+			    (!entity->alreadyJumping ||
+			     (entity->newJump && entity->nbJumps < MAX_NB_JUMPS)))
+			{
+				// Start jumping
+				entity->dp.y           = entity->initialJumpVelocity;
+				entity->alreadyJumping = true;
+				entity->newJump        = false;
+				++entity->nbJumps;
+				WentAirborne(entity);
+			}
+			else
+			{
+				entity->jumpTime += dt;
+			}
+		}
+		else
+		{
+			entity->newJump = true;
+
+			if (entity->alreadyJumping)
+			{
+				if (!entity->quickFall && entity->jumpTime < MAX_JUMP_TIME)
+				{
+					entity->quickFall     = true;
+					entity->quickFallTime = 0;
+				}
+
+				if (entity->quickFall && entity->quickFallTime < MAX_STOP_TIME)
+				{
+					entity->quickFallTime += dt;
+					acc.y *= 5;
+				}
+			}
+		}
+	}
+
+	entity->p += dt * entity->dp + (0.5 * dt * dt * acc);
+	entity->dp += dt * acc;
+
+	// NOTE(Thomas): I don't like that it's handle in a physic resolution function while
+	// it's "game logic" related (or graphic related)
+	if (z::OppositeSign(entity->p.x - oldX, entity->orientation))
+	{
+		entity->orientation *= -1.f;
+	}
+}
+
+internal void IntegrateEntities(void* data, uint32 begin, uint32 end)
+{
+	WorldUpdate* update = (WorldUpdate*)data;
+
 	// NOTE(Charly): I have removed generic integration stuff for now.
 	//               This function might actually be scripted, or call
 	//               scripted entity update functions.
-	for (uint32 entityIdx = 0; entityIdx < gameState->nbEntities; ++entityIdx)
+	for (uint32 entityIdx = begin; entityIdx < end; ++entityIdx)
 	{
-		Entity* entity = &gameState->entities[entityIdx];
+		Entity* entity = &update->gameState->entities[entityIdx];
 
 		switch (entity->entityType)
 		{
 			case EntityType_Player:
 			{
-				// NOTE(Charly): We are updating a player, so we need to :
-				//  - Change x velocity based on left / right inputs
-				//  - If jump is pressed:
-				//      - Is it the start of a new jump ?
-				//          - Y: start jumping, compute gravity and velocity
-				//          based on current state and wished jump height,
-				//          keep track of the number of total jumps (gd related)
-				//          - N: update jumping elapsed time
-				//  - Else:
-				//      - Did we begin a jump and stopped early ?
-				//          - Change the gravity momentarily and track time
-
-				int32 controllerId = entity->controllerId;
+				IntegratePlayer(update->gameState, entity, update->dt);
+			}
+			break;
+
+			default:
+			{
+			}
+		}
+	}
+}
 
-#define MAX_JUMP_TIME 0.25f
-#define MAX_STOP_TIME 0.05f
-#define MAX_NB_JUMPS 2
+internal void StepParticleSystems(void* data, uint32 begin, uint32 end)
+{
+	WorldUpdate* update = (WorldUpdate*)data;
+	real32       dt     = update->dt;
 
-				real32 oldX = entity->p.x;
+	for (uint32 systemIdx = begin; systemIdx < end; ++systemIdx)
+	{
+		ParticleSystem* system = update->gameState->particleSystems + systemIdx;
 
-				z::vec2 acc  = z::Vec2(0, entity->gravity);
-				entity->dp.x = 0.0;
+		if (system->nbParticles > 0)
+		{
+			// Step particles simulation for the current system
+			for (uint32 particleIdx = 0; particleIdx < system->nbParticles; ++particleIdx)
+			{
+				Particle& particle = system->particles[particleIdx];
+
+				particle.dp += system->gravity * dt;
+				particle.p += particle.dp * dt;
+
+				real t         = (particle.totalLife - particle.life) / (particle.totalLife);
+				particle.color = Lerp(system->startColor, system->endColor, t);
+
+				// Update particle lifetime
+				particle.life -= dt;
+			}
 
-				if (!(entity->status & (EntityStatus_Rooted | EntityStatus_Stunned)))
+			uint32 before = system->nbParticles;
+
+			// NOTE(Charly): Swap dead particles with the last one, order does not matter
+			for (uint32 i = 0; i < system->nbParticles;)
+			{
+				if (system->particles[i].life <= 0.f)
 				{
-					if (IsActionPressed(gameState, controllerId, Action_Left))
-					{
-						entity->dp.x += -10.0;
-					}
+					system->particles[i] = system->particles[--system->nbParticles];
+				}
+				else
+				{
+					++i;
+				}
+			}
 
-					if (IsActionPressed(gameState, controllerId, Action_Right))
-					{
-						entity->dp.x += 10.0;
-					}
+			uint32 after = system->nbParticles;
+			// Log(Log_Debug, "System #%i: %zu %zu", systemIdx, before, after);
+		}
+	}
+}
+
+// NOTE(Charly): Pairs are pushed one by one in the frame arena of the worker, nothing else is
+//               pushed there in the meantime so they end up contiguous.
+internal void FindCollisionPairs(void* data, uint32 begin, uint32 end)
+{
+	BroadphaseRange* range     = (BroadphaseRange*)data;
+	GameState*       gameState = range->gameState;
+	MemoryArena*     arena     = GetFrameArena();
 
-					if (IsActionPressed(gameState, controllerId, Action_Jump))
+	range->pairs   = nullptr;
+	range->nbPairs = 0;
+
+	for (uint32 firstIdx = begin; firstIdx < end; ++firstIdx)
+	{
+		Entity* firstEntity = &gameState->entities[firstIdx];
+		if (EntityHasComponent(firstEntity, ComponentFlag_Collidable))
+		{
+			for (uint32 secondIdx = firstIdx + 1; secondIdx < gameState->nbEntities; ++secondIdx)
+			{
+				Entity* secondEntity = &gameState->entities[secondIdx];
+				if (EntityHasComponent(secondEntity, ComponentFlag_Collidable))
+				{
+					if (Intersect(firstEntity, secondEntity))
 					{
-						if (IsActionRisingEdge(gameState, controllerId, Action_Jump) &&
-						    (!entity->alreadyJumping ||
-						     (entity->newJump && entity->nbJumps < MAX_NB_JUMPS)))
-						{
-							// Start jumping
-							entity->dp.y           = entity->initialJumpVelocity;
-							entity->alreadyJumping = true;
-							entity->newJump        = false;
-							++entity->nbJumps;
-							WentAirborne(entity);
-						}
-						else
+						CollisionPair* pair = PushStruct(arena, CollisionPair);
+						if (!pair)
 						{
-							entity->jumpTime += dt;
+							return;
 						}
-					}
-					else
-					{
-						entity->newJump = true;
 
-						if (entity->alreadyJumping)
+						pair->first  = firstEntity;
+						pair->second = secondEntity;
+						if (!range->pairs)
 						{
-							if (!entity->quickFall && entity->jumpTime < MAX_JUMP_TIME)
-							{
-								entity->quickFall     = true;
-								entity->quickFallTime = 0;
-							}
-
-							if (entity->quickFall && entity->quickFallTime < MAX_STOP_TIME)
-							{
-								entity->quickFallTime += dt;
-								acc.y *= 5;
-							}
+							range->pairs = pair;
 						}
+						++range->nbPairs;
 					}
 				}
+			}
+		}
+	}
+}
 
-				entity->p += dt * entity->dp + (0.5 * dt * dt * acc);
-				entity->dp += dt * acc;
+// NOTE(Charly): The players integrate in parallel, the jump is looked for once they are done
+internal void StampJumpLatency(GameState* gameState)
+{
+	for (uint32 entityIdx = 0; entityIdx < gameState->nbEntities; ++entityIdx)
+	{
+		const Entity* entity = gameState->entities + entityIdx;
+		if (entity->entityType != EntityType_Player ||
+		    !IsActionRisingEdge(gameState, entity->controllerId, Action_Jump))
+		{
+			continue;
+		}
 
-				// NOTE(Thomas): I don't like that it's handle in a physic resolution function while
-				// it's "game logic" related (or graphic related)
-				if (z::OppositeSign(entity->p.x - oldX, entity->orientation))
-				{
-					entity->orientation *= -1.f;
-				}
-			}
+		// NOTE(Charly): 0 for bots and replays, and when the press was applied on an earlier step
+		int64 pressTime = GetActionPressTime(gameState, entity->controllerId, Action_Jump);
+		if (pressTime != 0)
+		{
+			gameState->jumpLatency                           = {};
+			gameState->jumpLatency.input                     = pressTime;
+			gameState->jumpLatency.stages[LatencyStage_Tick] = GetInputEventTime();
 			break;
-
-			default:
-			{
-			}
 		}
 	}
+}
+
+void UpdateWorld(GameState* gameState, real32 dt)
+{
+	TIMED_FUNCTION();
+
+	WorldUpdate update = {gameState, dt};
+
+	BEGIN_TIMED_BLOCK(Integrate);
+	ParallelFor(gameState->nbEntities, MIN_ENTITIES_PER_INTEGRATION_JOB, IntegrateEntities, &update);
+	END_TIMED_BLOCK(Integrate);
+
+	StampJumpLatency(gameState);
 
 	// Update particle systems
+	// NOTE(Charly): Spawning draws from the world generator, it stays serial so that the draws
+	//               happen in the same order whatever the number of workers.
+	BEGIN_TIMED_BLOCK(SpawnParticles);
 	for (uint32 systemIdx = 0; systemIdx < MAX_PARTICLE_SYSTEMS; ++systemIdx)
 	{
 		ParticleSystem* system = gameState->particleSystems + systemIdx;
@@ -127,18 +294,26 @@ void UpdateWorld(GameState* gameState, real32 dt)
 			// Log(Log_Debug, "system %i should spawn %i particles", systemIdx, newParticlesCount);
 			for (int particleIdx = 0; particleIdx < newParticlesCount; ++particleIdx)
 			{
-				real angle = z::GenerateRandBetween(system->minAngle, system->maxAngle);
-				real vel   = z::GenerateRandBetween(system->minVelocity, system->maxVelocity);
+				real angle = z::GenerateRandBetween(&gameState->rng,
+				                                    system->minAngle,
+				                                    system->maxAngle);
+				real vel   = z::GenerateRandBetween(&gameState->rng,
+                                                  system->minVelocity,
+                                                  system->maxVelocity);
 
 				Particle particle;
 				particle.p         = system->pos;
 				particle.dp        = z::Vec2(vel * z::Cos(angle), vel * z::Sin(angle));
 				particle.color     = system->startColor;
-				particle.life      = z::GenerateRandNormal(system->particleLife,
+				particle.life      = z::GenerateRandNormal(&gameState->rng,
+                                                      system->particleLife,
                                                       system->particleLifeDelta);
 				particle.totalLife = particle.life;
 
-				system->particles.push_back(particle);
+				if (system->nbParticles < system->maxParticles)
+				{
+					system->particles[system->nbParticles++] = particle;
+				}
 			}
 			// Update system lifetime
 			system->systemLife -= dt;
@@ -147,49 +322,13 @@ void UpdateWorld(GameState* gameState, real32 dt)
 				system->alive = false;
 			}
 		}
+	}
 
-		if (!system->particles.empty())
-		{
-			// Step particles simulation for the current system
-			for (auto& particle : system->particles)
-			{
-				particle.dp += system->gravity * dt;
-				particle.p += particle.dp * dt;
-
-				real t         = (particle.totalLife - particle.life) / (particle.totalLife);
-				particle.color = Lerp(system->startColor, system->endColor, t);
-
-				// Update particle lifetime
-				particle.life -= dt;
-			}
-
-			size_t before = system->particles.size();
-
-			std::vector<size_t> toBeRemoved;
-			size_t              particleCount = system->particles.size();
-			for (size_t i = 0; i < particleCount; ++i)
-			{
-				if (system->particles[i].life <= 0.f)
-				{
-					toBeRemoved.push_back(i);
-				}
-			}
-
-			for (size_t i = 0; i < toBeRemoved.size(); ++i)
-			{
-				std::swap(system->particles[toBeRemoved[i]],
-				          system->particles[particleCount - i - 1]);
-			}
-
-			for (size_t i = 0; i < toBeRemoved.size(); ++i)
-			{
-				system->particles.pop_back();
-			}
+	END_TIMED_BLOCK(SpawnParticles);
 
-			size_t after = system->particles.size();
-			// Log(Log_Debug, "System #%i: %zu %zu", systemIdx, before, after);
-		}
-	}
+	BEGIN_TIMED_BLOCK(StepParticles);
+	ParallelFor(MAX_PARTICLE_SYSTEMS, MIN_SYSTEMS_PER_PARTICLE_JOB, StepParticleSystems, &update);
+	END_TIMED_BLOCK(StepParticles);
 
 	// 2. Collision detection
 	// Depending on the types of shapes we want collision for (I think I won't
@@ -199,27 +338,62 @@ void UpdateWorld(GameState* gameState, real32 dt)
 	// (Depending on the shapes, GJK might be the best tool)
 
 	// TODO(Thomas): Do something smart.
-	std::vector<std::pair<Entity*, Entity*>> collisions;
+	// NOTE(Charly): The first entities are split in ranges holding about the same number of tests
+	//               (row i tests n - i - 1 pairs), each range is a job. Ranges are concatenated
+	//               in order, so pairs come out exactly as with a single loop.
+	BEGIN_TIMED_BLOCK(Broadphase);
+	uint32 nbEntities = gameState->nbEntities;
+	uint32 nbRanges   = 1;
+	if (nbEntities >= MIN_ENTITIES_FOR_PARALLEL_BROADPHASE)
+	{
+		nbRanges = GetJobWorkerCount() * 4;
+		nbRanges = nbRanges < MAX_BROADPHASE_RANGES ? nbRanges : MAX_BROADPHASE_RANGES;
+	}
 
-	for (uint32 firstIdx = 0; firstIdx < (gameState->nbEntities - 1); ++firstIdx)
+	BroadphaseRange ranges[MAX_BROADPHASE_RANGES];
+	Job             jobs[MAX_BROADPHASE_RANGES];
+	for (uint32 rangeIdx = 0; rangeIdx < nbRanges; ++rangeIdx)
 	{
-		Entity* firstEntity = &gameState->entities[firstIdx];
-		if (EntityHasComponent(firstEntity, ComponentFlag_Collidable))
+		ranges[rangeIdx].gameState = gameState;
+
+		jobs[rangeIdx].function = FindCollisionPairs;
+		jobs[rangeIdx].data     = ranges + rangeIdx;
+		jobs[rangeIdx].begin    = rangeIdx == 0 ? 0 : jobs[rangeIdx - 1].end;
+		jobs[rangeIdx].end      = nbEntities;
+		if (rangeIdx + 1 < nbRanges)
 		{
-			for (uint32 secondIdx = firstIdx + 1; secondIdx < gameState->nbEntities; ++secondIdx)
-			{
-				Entity* secondEntity = &gameState->entities[secondIdx];
-				if (EntityHasComponent(secondEntity, ComponentFlag_Collidable))
-				{
-					if (Intersect(firstEntity, secondEntity))
-					{
-						collisions.push_back(
-						    std::pair<Entity*, Entity*>(firstEntity, secondEntity));
-					}
-				}
-			}
+			real32 remaining   = 1.f - (real32)(rangeIdx + 1) / nbRanges;
+			uint32 end         = nbEntities - (uint32)(nbEntities * z::Sqrt(remaining));
+			jobs[rangeIdx].end = end > jobs[rangeIdx].begin ? end : jobs[rangeIdx].begin;
+		}
+	}
+
+	JobCounter counter = {};
+	RunJobs(jobs, nbRanges, &counter);
+	WaitForCounter(&counter);
+
+	uint32 nbCollisions = 0;
+	for (uint32 rangeIdx = 0; rangeIdx < nbRanges; ++rangeIdx)
+	{
+		nbCollisions += ranges[rangeIdx].nbPairs;
+	}
+
+	CollisionPair* collisions  = PushArray(GetFrameArena(), nbCollisions, CollisionPair);
+	CollisionPair* destination = collisions;
+	for (uint32 rangeIdx = 0; rangeIdx < nbRanges && collisions; ++rangeIdx)
+	{
+		BroadphaseRange* range = ranges + rangeIdx;
+		if (range->nbPairs > 0)
+		{
+			memcpy(destination, range->pairs, range->nbPairs * sizeof(CollisionPair));
+			destination += range->nbPairs;
 		}
 	}
+	if (!collisions)
+	{
+		nbCollisions = 0;
+	}
+	END_TIMED_BLOCK(Broadphase);
 
 	//
 	// 3. Collision solving
@@ -250,8 +424,13 @@ void UpdateWorld(GameState* gameState, real32 dt)
 	//          have an infinite mass / null inverse mass)
 	//      }
 
-	for (auto it : collisions)
+	// NOTE(Charly): Pairs are generated in (first index, second index) order, and solved in that
+	//               order. Deterministic mode relies on it, keep it that way when adding a
+	//               broadphase.
+	TIMED_BLOCK("SolveCollisions");
+	for (uint32 collisionIdx = 0; collisionIdx < nbCollisions; ++collisionIdx)
 	{
+		CollisionPair it = collisions[collisionIdx];
 		z::vec2 overlap = Overlap(it.first, it.second);
 		if (CollisionCallback(it.first, it.second, &overlap))
 		{
@@ -347,7 +526,7 @@ ParticleSystem* SpawnParticleSystem(GameState* gameState, z::vec2 pos)
 
 	ParticleSystem* result = &gameState->particleSystems[idx];
 
-	Log(Log_Info, "Hello @ %.3f %.3f", pos.x, pos.y);
+	Log(Log_Debug, "Hello @ %.3f %.3f", pos.x, pos.y);
 
 	result->pos                = pos;
 	result->systemLife         = 2;
@@ -364,6 +543,24 @@ ParticleSystem* SpawnParticleSystem(GameState* gameState, z::vec2 pos)
 	result->maxVelocity        = 17;
 	result->gravity            = z::Vec2(0, -20);
 
+	// NOTE(Charly): A system can not spawn more than that. If a bigger system reuses the slot,
+	//               the old storage is lost until the world arena goes away. Particles of the
+	//               previous system that are still alive are kept.
+	uint32 maxParticles = (uint32)(result->particlesPerSecond * (result->systemLife + 1));
+	if (result->maxParticles < maxParticles)
+	{
+		Particle* particles = PushArray(&gameState->worldArena, maxParticles, Particle);
+		if (particles)
+		{
+			if (result->nbParticles > 0)
+			{
+				memcpy(particles, result->particles, result->nbParticles * sizeof(Particle));
+			}
+			result->particles    = particles;
+			result->maxParticles = maxParticles;
+		}
+	}
+
 	return result;
 }
 
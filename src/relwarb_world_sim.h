@@ -1,8 +1,6 @@
 #ifndef RELWARB_WORLD_SIM_H
 #define RELWARB_WORLD_SIM_H
 
-#include <vector>
-
 #include "relwarb_math.h"
 #include "relwarb_defines.h"
 
@@ -60,7 +58,11 @@ struct ParticleSystem
 
     // TODO(Charly): Collision related stuff
 
-    std::vector<Particle> particles;
+    // NOTE(Charly): Allocated in the world arena the first time the slot is used,
+    //               and kept when the slot is reused.
+    Particle* particles;
+    uint32    nbParticles;
+    uint32    maxParticles;
 };
 
 // NOTE(Charly): Create a rigid body